@@ -1,5 +1,19 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
+#include <random>
+#include <string>
+#include <thread>
 #include <tuple>
+#include "include/batch.hpp"
+#include "include/gcd.hpp"
+#include "../include/benchmark.hpp"
+#include "../include/taskpool.hpp"
+
+// Number of GCDs in each timed sample, as one GCD of 64-bit integers is too short to time alone
+const int GCD_OPS_PER_SAMPLE = 10000;
 
 /*
  * @brief Parse argument to extract user long integer value
@@ -32,6 +46,99 @@ long get_long_param(char *param) {
     return long_param;
 }
 
+/*
+ * @brief Parse argument to extract user number of repeats
+ *
+ * @param[in]  param  argv element corresponding to array size
+ * @return  (int)repeat_count  parsed repeat count, casted to int
+ * */
+int get_repeat_count(char *param) {
+    char *endptr;
+    long repeat_count;
+
+    errno = 0;
+    repeat_count = std::strtol(param, &endptr, 10);
+
+    if (errno != 0) {
+        perror("strtol");
+        exit(EXIT_FAILURE);
+    }
+
+    if (endptr == param) {
+        std::cerr << "could not parse repeat_count as an integer" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    if (repeat_count < 1) {
+        std::cerr << "repeat_count parameter must be >= 1" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    return (int) repeat_count;
+}
+
+/*
+ * @brief Parse argument to extract user number of threads
+ *
+ * @param[in]  param  argv element corresponding to thread count
+ * @return  (int)thread_count  parsed thread count, casted to int
+ * */
+int get_thread_count(char *param) {
+    char *endptr;
+    long thread_count;
+
+    errno = 0;
+    thread_count = std::strtol(param, &endptr, 10);
+
+    if (errno != 0) {
+        perror("strtol");
+        exit(EXIT_FAILURE);
+    }
+
+    if (endptr == param) {
+        std::cerr << "could not parse thread_count as an integer" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    if (thread_count < 1) {
+        std::cerr << "thread_count parameter must be >= 1" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    return (int) thread_count;
+}
+
+/*
+ * @brief Parse argument to extract user number of records
+ *
+ * @param[in]  param  argv element corresponding to record count
+ * @return  (long long)record_count  parsed record count
+ * */
+long long get_record_count(char *param) {
+    char *endptr;
+    long long record_count;
+
+    errno = 0;
+    record_count = std::strtoll(param, &endptr, 10);
+
+    if (errno != 0) {
+        perror("strtoll");
+        exit(EXIT_FAILURE);
+    }
+
+    if (endptr == param) {
+        std::cerr << "could not parse record_count as an integer" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    if (record_count < 0) {
+        std::cerr << "record_count parameter must be >= 0" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    return record_count;
+}
+
 /*
  * @brief Compute the greatest common divisor (g) of two integers (a, b)
  *
@@ -49,19 +156,138 @@ std::tuple<long, long, long> euclid(long a, long b) {
     return {g, i, j};
 }
 
+/*
+ * @brief Write random (a, b) pairs of non-negative 63-bit integers to a batch file
+ *
+ * @param[in]  output_path  path of file for pairs, or "-" for stdout
+ * @param[in]  count  number of pairs
+ * */
+void generate_batch(std::string const &output_path, long long count) {
+    std::random_device rd;
+    std::mt19937_64 generator(rd());
+
+    write_records(output_path, sizeof(EuclidPair), count, [&generator](void *record) {
+        *static_cast<EuclidPair *>(record) = EuclidPair{(int64_t) (generator() >> 1), (int64_t) (generator() >> 1)};
+    });
+}
+
+/*
+ * @brief Compute the GCD of each pair of a batch file, writing each result as three int64_t {g, i, j}
+ *
+ * @param[in]  input_path  path of file of pairs, or "-" for stdin
+ * @param[in]  output_path  path of file for results, or "-" for stdout
+ * @param[in]  threads  number of threads
+ * */
+void run_batch(std::string const &input_path, std::string const &output_path, int threads) {
+    TaskPool pool(threads);
+    double compute_seconds;
+
+    auto t1 = std::chrono::steady_clock::now();
+    long long records = process_batch<EuclidPair, EuclidResult>(input_path, output_path, pool, extended_gcd_batch,
+                                                                compute_seconds);
+    auto t2 = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(t2 - t1).count();
+
+    // Results may be on stdout, so report on stderr
+    std::cerr << "Computed " << records << " GCDs on " << pool.size() << " threads" << std::endl;
+    std::cerr << "Time to process batch: " << seconds << " s, " << (records / std::max(seconds, 1e-9)) << " ops/s ("
+              << (records / std::max(compute_seconds, 1e-9)) << " ops/s excluding I/O)" << std::endl;
+}
+
 int main(int argc, char *argv[]) {
+    BenchmarkOptions options = parse_benchmark_options(argc, argv);
+
+    // Batch file modes (e.g. 'euclid generate pairs.bin 1000000', then 'euclid batch pairs.bin results.bin')
+    if (argc >= 2 && std::strcmp(argv[1], "generate") == 0) {
+        if (argc != 4) {
+            std::cerr << "Usage: " << argv[0] << " generate [output_path] [record_count]" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        generate_batch(argv[2], get_record_count(argv[3]));
+        exit(EXIT_SUCCESS);
+    }
+
+    if (argc >= 2 && std::strcmp(argv[1], "batch") == 0) {
+        if (argc != 4 && argc != 5) {
+            std::cerr << "Usage: " << argv[0] << " batch [input_path] [output_path] [thread_count (optional)]"
+                      << std::endl;
+            std::cerr << "Input is 64-bit (a, b) pairs and output 64-bit {g, i, j} results, in native byte order, "
+                      << "where a path of - is stdin or stdout" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        int threads = (argc == 5) ? get_thread_count(argv[4]) : std::max((int) std::thread::hardware_concurrency(), 1);
+        run_batch(argv[2], argv[3], threads);
+        exit(EXIT_SUCCESS);
+    }
+
     // Check correct usage (e.g. 'euclid 30 18')
-    if (argc != 3) {
-        std::cerr << "Usage: " << argv[0] << " [integer_a] [integer_b]" << std::endl;
+    if (argc != 3 && argc != 4) {
+        std::cerr << "Usage: " << argv[0] << " [integer_a] [integer_b] [repeat_count (optional)]"
+                  << " [--warmup=N] [--samples=N] [--format=text|csv|json] [--output=path] [--filter=name]"
+                  << " [--counters]"
+                  << std::endl;
+        std::cerr << "       " << argv[0] << " batch [input_path] [output_path] [thread_count (optional)]" << std::endl;
+        std::cerr << "       " << argv[0] << " generate [output_path] [record_count]" << std::endl;
         exit(EXIT_FAILURE);
     }
 
     long integer_a = get_long_param(argv[1]);
     long integer_b = get_long_param(argv[2]);
+    int repeats = (argc == 4) ? get_repeat_count(argv[3]) : 1;
+
+    Benchmark bench("euclid", options, repeats);
 
     auto [gcd, i, j] = euclid(integer_a, integer_b);
 
-    std::cout << "gcd: " << gcd << " i: " << i << " j: " << j << std::endl;
+    bench.log() << "gcd: " << gcd << " i: " << i << " j: " << j << std::endl;
+
+    // The iterative version gives the same coefficients, and the binary versions other coefficients for the same gcd
+    if (euclid_iterative(integer_a, integer_b) != std::make_tuple(gcd, i, j)) {
+        std::cerr << "Iterative result does not match recursive result" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    auto [gcd_binary, i_binary, j_binary] = binary_euclid(integer_a, integer_b);
+    bench.log() << "gcd (binary): " << gcd_binary << " i: " << i_binary << " j: " << j_binary << std::endl;
+
+    auto [gcd_constant, i_constant, j_constant] = binary_euclid_constant_time(integer_a, integer_b);
+    bench.log() << "gcd (binary, constant time): " << gcd_constant << " i: " << i_constant << " j: " << j_constant
+                << std::endl;
+
+    if (gcd_binary != gcd || gcd_constant != gcd) {
+        std::cerr << "Binary results do not match recursive result" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // Each sample repeats the same GCD, with the integers hidden from the compiler, so no call is hoisted
+    auto repeat = [&](auto gcd_function) {
+        return [&, gcd_function]() {
+            for (int k = 0; k < GCD_OPS_PER_SAMPLE; k++) {
+                long a = integer_a;
+                long b = integer_b;
+                do_not_optimize(a);
+                do_not_optimize(b);
+                do_not_optimize(gcd_function(a, b));
+            }
+        };
+    };
+
+    long long bits = 64 - __builtin_clzll(std::max(integer_a, integer_b) | 1);
+    bench.set_ops(GCD_OPS_PER_SAMPLE);
+    double recursive_median = bench.run("Extended GCD (recursive)", bits, repeat(euclid));
+    double median = bench.run("Extended GCD (iterative)", bits, repeat(euclid_iterative));
+    if (median > 0 && recursive_median > 0) {
+        bench.metric("x speedup vs recursive", recursive_median / median);
+    }
+    median = bench.run("Extended GCD (binary)", bits, repeat(binary_euclid));
+    if (median > 0 && recursive_median > 0) {
+        bench.metric("x speedup vs recursive", recursive_median / median);
+    }
+    median = bench.run("Extended GCD (binary, constant time)", bits, repeat(binary_euclid_constant_time));
+    if (median > 0 && recursive_median > 0) {
+        bench.metric("x speedup vs recursive", recursive_median / median);
+    }
 
+    bench.report();
     exit(EXIT_SUCCESS);
 }
@@ -0,0 +1,109 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "batch.hpp"
+
+/*
+ * @brief Supporting function to open a file for binary reading or writing, where "-" is stdin or stdout
+ * */
+static std::FILE *open_records(std::string const &path, bool write) {
+    if (path == "-") {
+        return write ? stdout : stdin;
+    }
+
+    std::FILE *file = std::fopen(path.c_str(), write ? "wb" : "rb");
+    if (file == nullptr) {
+        perror("fopen");
+        exit(EXIT_FAILURE);
+    }
+    return file;
+}
+
+/*
+ * @brief Supporting function to close a file opened by open_records, flushing it if it was written (fflush of an
+ * input stream is undefined)
+ * */
+static void close_records(std::FILE *file, bool write) {
+    if (write && (std::fflush(file) != 0 || std::ferror(file))) {
+        perror("fflush");
+        exit(EXIT_FAILURE);
+    }
+    if (file != stdin && file != stdout) {
+        std::fclose(file);
+    }
+}
+
+long long process_batch(std::string const &input_path, std::string const &output_path, std::size_t input_size,
+                        std::size_t output_size, TaskPool &pool, BatchKernel const &kernel, double &compute_seconds) {
+    std::FILE *input = open_records(input_path, false);
+    std::FILE *output = open_records(output_path, true);
+
+    std::vector<unsigned char> input_block(BATCH_BLOCK_RECORDS * input_size);
+    std::vector<unsigned char> output_block(BATCH_BLOCK_RECORDS * output_size);
+    long long records = 0;
+    compute_seconds = 0;
+
+    while (true) {
+        // fread only stops short of a full block at the end of the input
+        std::size_t bytes = std::fread(input_block.data(), 1, input_block.size(), input);
+        if (bytes % input_size != 0) {
+            std::cerr << "Error: input size is not a multiple of the " << input_size << " byte record size"
+                      << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        std::size_t count = bytes / input_size;
+        if (count == 0) {
+            break;
+        }
+
+        auto t1 = std::chrono::steady_clock::now();
+        int task_count = (count + BATCH_GRAIN_RECORDS - 1) / BATCH_GRAIN_RECORDS;
+        pool.parallel_for(0, task_count, 1, [&](int lo, int hi) {
+            for (int task = lo; task < hi; task++) {
+                std::size_t first = (std::size_t) task * BATCH_GRAIN_RECORDS;
+                int n = std::min<std::size_t>(BATCH_GRAIN_RECORDS, count - first);
+                kernel(input_block.data() + first * input_size, output_block.data() + first * output_size, n);
+            }
+        });
+        auto t2 = std::chrono::steady_clock::now();
+        compute_seconds += std::chrono::duration<double>(t2 - t1).count();
+
+        if (std::fwrite(output_block.data(), output_size, count, output) != count) {
+            perror("fwrite");
+            exit(EXIT_FAILURE);
+        }
+        records += count;
+    }
+
+    if (std::ferror(input)) {
+        perror("fread");
+        exit(EXIT_FAILURE);
+    }
+
+    close_records(input, false);
+    close_records(output, true);
+    return records;
+}
+
+void write_records(std::string const &output_path, std::size_t record_size, long long count,
+                   std::function<void(void *)> const &generate) {
+    std::FILE *output = open_records(output_path, true);
+    std::vector<unsigned char> block(BATCH_BLOCK_RECORDS * record_size);
+
+    for (long long first = 0; first < count; first += BATCH_BLOCK_RECORDS) {
+        std::size_t n = std::min<long long>(BATCH_BLOCK_RECORDS, count - first);
+        for (std::size_t k = 0; k < n; k++) {
+            generate(block.data() + k * record_size);
+        }
+        if (std::fwrite(block.data(), record_size, n, output) != n) {
+            perror("fwrite");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    close_records(output, true);
+}
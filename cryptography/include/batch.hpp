@@ -0,0 +1,59 @@
+#ifndef CRYPTOGRAPHY_BATCH_HPP
+#define CRYPTOGRAPHY_BATCH_HPP
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include "../../include/taskpool.hpp"
+
+// Number of records read from the input at a time, and computed in parallel
+const int BATCH_BLOCK_RECORDS = 1 << 16;
+
+// Number of records computed by each task
+const int BATCH_GRAIN_RECORDS = 1024;
+
+// Computes count output records from count input records
+using BatchKernel = std::function<void(void const *input, void *output, int count)>;
+
+/*
+ * @brief Stream fixed size binary records from a file through a kernel, writing fixed size result records to a file
+ *
+ * Records are read and written with one fread and fwrite per block of BATCH_BLOCK_RECORDS, in the native byte
+ * order, and each block is split into tasks of BATCH_GRAIN_RECORDS for the pool, so the cost per record is only
+ * the kernel itself. The input may be a pipe, as it is only read once from start to end.
+ * @param[in]  input_path  path of file of input records, or "-" for stdin
+ * @param[in]  output_path  path of file for output records, or "-" for stdout
+ * @param[in]  input_size  size of an input record in bytes
+ * @param[in]  output_size  size of an output record in bytes
+ * @param[in]  pool  thread pool to compute the records on
+ * @param[in]  kernel  computes the output records of a range of input records
+ * @param[out]  compute_seconds  time spent in the kernel, excluding reading and writing
+ * @return  number of records processed
+ * */
+long long process_batch(std::string const &input_path, std::string const &output_path, std::size_t input_size,
+                        std::size_t output_size, TaskPool &pool, BatchKernel const &kernel, double &compute_seconds);
+
+/*
+ * @brief Typed wrapper of process_batch, for kernels taking arrays of In and Out records
+ * */
+template <typename In, typename Out, typename Kernel>
+long long process_batch(std::string const &input_path, std::string const &output_path, TaskPool &pool,
+                        Kernel kernel, double &compute_seconds) {
+    return process_batch(input_path, output_path, sizeof(In), sizeof(Out), pool,
+                         [&kernel](void const *input, void *output, int count) {
+                             kernel(static_cast<In const *>(input), static_cast<Out *>(output), count);
+                         }, compute_seconds);
+}
+
+/*
+ * @brief Write count records, each filled in by a generator, to a file in blocks of BATCH_BLOCK_RECORDS
+ *
+ * @param[in]  output_path  path of file for records, or "-" for stdout
+ * @param[in]  record_size  size of a record in bytes
+ * @param[in]  count  number of records
+ * @param[in]  generate  fills in the record at the pointer
+ * */
+void write_records(std::string const &output_path, std::size_t record_size, long long count,
+                   std::function<void(void *)> const &generate);
+
+#endif //CRYPTOGRAPHY_BATCH_HPP
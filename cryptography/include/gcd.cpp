@@ -0,0 +1,197 @@
+#include <utility>
+#include "gcd.hpp"
+
+std::tuple<long, long, long> euclid_iterative(long a, long b) {
+    // a = a0 * i0 + b0 * j0 and b = a0 * i1 + b0 * j1, for the original a0 and b0
+    long i0 = 1, j0 = 0;
+    long i1 = 0, j1 = 1;
+
+    while (b != 0) {
+        long q = a / b;
+        long r = a - q * b;
+        a = b;
+        b = r;
+
+        long i = i0 - q * i1;
+        long j = j0 - q * j1;
+        i0 = i1;
+        j0 = j1;
+        i1 = i;
+        j1 = j;
+    }
+
+    return {a, i0, j0};
+}
+
+/*
+ * @brief Supporting function to compute the inverse of an odd integer y mod 2^64
+ *
+ * Newton's iteration doubles the number of correct low bits of the inverse each step, starting from y, which is
+ * its own inverse mod 2^3.
+ * */
+static inline unsigned long inverse_mod_2_64(unsigned long y) {
+    unsigned long inverse = y;
+    for (int k = 0; k < 5; k++) {
+        inverse *= 2 - y * inverse;
+    }
+    return inverse;
+}
+
+std::tuple<long, long, long> binary_euclid(long a, long b) {
+    if (a == 0) {
+        return {b, 0, 1};
+    }
+    if (b == 0) {
+        return {a, 1, 0};
+    }
+
+    // Remove the common power of two, then make y the odd one of the two
+    int shift = __builtin_ctzl(a | b);
+    unsigned long x = a >> shift;
+    unsigned long y = b >> shift;
+    bool swapped = (y % 2 == 0);
+    if (swapped) {
+        std::swap(x, y);
+    }
+    unsigned long y_inverse = inverse_mod_2_64(y);
+
+    // u = xA (mod y) and v = xC (mod y), with 0 <= A, C <= y, and v is always odd
+    unsigned long u = x, v = y;
+    unsigned long A = 1, C = 0;
+
+    while (u != 0) {
+        // Divide A by 2^zeros mod y, adding the multiple of y that makes the low bits zero
+        int zeros = __builtin_ctzl(u);
+        u >>= zeros;
+        unsigned long t = (0 - A * y_inverse) & ((1UL << zeros) - 1);
+        A = ((unsigned __int128) t * y + A) >> zeros;
+
+        // Subtract the smaller of the two odd remainders from the larger, keeping the odd one in v
+        if (u >= v) {
+            u -= v;
+            A = (A >= C) ? A - C : A + y - C;
+        } else {
+            unsigned long difference = v - u;
+            unsigned long A_difference = (C >= A) ? C - A : C + y - A;
+            v = u;
+            C = A;
+            u = difference;
+            A = A_difference;
+        }
+    }
+
+    // v = xC + yD exactly, and y is odd, so D is an exact division by y, which is a multiplication mod 2^64
+    long i = C;
+    long j = (v - C * x) * y_inverse;
+    long g = v << shift;
+
+    if (swapped) {
+        return {g, j, i};
+    }
+    return {g, i, j};
+}
+
+/*
+ * @brief Supporting function for one step of the constant time binary GCD
+ *
+ * If u is odd, the smaller of u and v is subtracted from the larger, keeping the smaller in v, which leaves u even,
+ * then u is halved, along with its coefficient A mod y. Each step removes at least one bit from u or v, until u is
+ * 0. Every choice is made with masks, so the same instructions run for any values.
+ * */
+static inline void constant_time_gcd_step(unsigned long &u, unsigned long &v, unsigned long &A, unsigned long &C,
+                                          unsigned long y) {
+    unsigned long u_odd = 0 - (u & 1);
+    unsigned long swap = u_odd & (0 - (unsigned long) (u < v));
+
+    unsigned long t = (u ^ v) & swap;
+    u ^= t;
+    v ^= t;
+    t = (A ^ C) & swap;
+    A ^= t;
+    C ^= t;
+
+    u -= v & u_odd;
+    unsigned long C_odd = C & u_odd;
+    unsigned long borrow = 0 - (unsigned long) (A < C_odd);
+    A = A - C_odd + (y & borrow);
+
+    // A <= y < 2^63, so A + y cannot overflow
+    u >>= 1;
+    A = (A + (y & (0 - (A & 1)))) >> 1;
+}
+
+/*
+ * @brief Supporting function to set up the constant time binary GCD of a and b
+ *
+ * Removes the common power of two (with a count of trailing zeros, which takes the same time for any value), and
+ * swaps the integers with masks if needed so that y is odd.
+ * */
+static inline void constant_time_gcd_setup(long a, long b, int &shift, unsigned long &x, unsigned long &y,
+                                           unsigned long &swapped) {
+    // The top bit stops the count at 63 when a and b are both 0
+    shift = __builtin_ctzl((unsigned long) (a | b) | (1UL << 63));
+    x = (unsigned long) a >> shift;
+    y = (unsigned long) b >> shift;
+
+    swapped = (y & 1) - 1; // all ones if y is even
+    unsigned long t = (x ^ y) & swapped;
+    x ^= t;
+    y ^= t;
+}
+
+/*
+ * @brief Supporting function to form the result of the constant time binary GCD from the final state
+ * */
+static inline EuclidResult constant_time_gcd_result(int shift, unsigned long x, unsigned long y,
+                                                    unsigned long swapped, unsigned long v, unsigned long C) {
+    unsigned long i = C;
+    unsigned long j = (v - C * x) * inverse_mod_2_64(y);
+    unsigned long t = (i ^ j) & swapped;
+    return EuclidResult{(long) (v << shift), (long) (i ^ t), (long) (j ^ t)};
+}
+
+std::tuple<long, long, long> binary_euclid_constant_time(long a, long b) {
+    int shift;
+    unsigned long x, y, swapped;
+    constant_time_gcd_setup(a, b, shift, x, y, swapped);
+
+    unsigned long u = x, v = y;
+    unsigned long A = 1, C = 0;
+    for (int k = 0; k < CONSTANT_TIME_GCD_ITERATIONS; k++) {
+        constant_time_gcd_step(u, v, A, C, y);
+    }
+
+    auto result = constant_time_gcd_result(shift, x, y, swapped, v, C);
+    return {result.g, result.i, result.j};
+}
+
+void binary_euclid_lanes(EuclidPair const *pairs, EuclidResult *results, int count) {
+    const int L = GCD_LANES;
+
+    for (int first = 0; first < count; first += L) {
+        int n = (count - first < L) ? count - first : L;
+        int shift[L];
+        unsigned long x[L], y[L], swapped[L], u[L], v[L], A[L], C[L];
+
+        // Pad the last group with trivial lanes (gcd of 0 and 0)
+        for (int k = 0; k < L; k++) {
+            long a = (k < n) ? pairs[first + k].a : 0;
+            long b = (k < n) ? pairs[first + k].b : 0;
+            constant_time_gcd_setup(a, b, shift[k], x[k], y[k], swapped[k]);
+            u[k] = x[k];
+            v[k] = y[k];
+            A[k] = 1;
+            C[k] = 0;
+        }
+
+        for (int step = 0; step < CONSTANT_TIME_GCD_ITERATIONS; step++) {
+            for (int k = 0; k < L; k++) {
+                constant_time_gcd_step(u[k], v[k], A[k], C[k], y[k]);
+            }
+        }
+
+        for (int k = 0; k < n; k++) {
+            results[first + k] = constant_time_gcd_result(shift[k], x[k], y[k], swapped[k], v[k], C[k]);
+        }
+    }
+}
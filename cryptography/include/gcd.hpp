@@ -0,0 +1,111 @@
+#ifndef CRYPTOGRAPHY_GCD_HPP
+#define CRYPTOGRAPHY_GCD_HPP
+
+#include <cstdint>
+#include <tuple>
+
+// Number of independent GCDs interleaved by binary_euclid_lanes
+const int GCD_LANES = 8;
+
+// Iterations of the constant time binary GCD loop, enough for any pair of 63-bit integers
+const int CONSTANT_TIME_GCD_ITERATIONS = 2 * 63;
+
+// Integers a and b of one GCD, as stored in batch files
+struct EuclidPair {
+    int64_t a;
+    int64_t b;
+};
+
+// Result {g, i, j} of one GCD, as stored in batch files
+struct EuclidResult {
+    int64_t g;
+    int64_t i;
+    int64_t j;
+};
+
+/*
+ * @brief Compute the greatest common divisor (g) of two integers (a, b), iteratively
+ *
+ * Keeps the coefficients of both remainders of the recursion in euclid, updating them on the way down rather than
+ * on the way back up, so gives the same {g, i, j} with no call stack.
+ * @param[in]  a  integer >= 0
+ * @param[in]  b  integer >= 0
+ * @return  tuple of {g, i, j}, where g = ai + bj
+ * */
+std::tuple<long, long, long> euclid_iterative(long a, long b);
+
+/*
+ * @brief Compute the greatest common divisor (g) of two integers (a, b), by the binary (Stein) method
+ *
+ * The common power of two is removed with one count of trailing zeros, then the remainders u and v are only ever
+ * shifted right (by the count of trailing zeros) or subtracted, with no division. Only the coefficient of a is
+ * kept, modulo b (with a and b swapped if needed so that b is odd), and is divided by the same power of two as u
+ * by adding a multiple of b. The coefficient of b is recovered at the end as an exact division by b, which is a
+ * multiplication by the inverse of b mod 2^64. The coefficients are not in general the same as those of euclid.
+ * @param[in]  a  integer >= 0
+ * @param[in]  b  integer >= 0
+ * @return  tuple of {g, i, j}, where g = ai + bj
+ * */
+std::tuple<long, long, long> binary_euclid(long a, long b);
+
+/*
+ * @brief Compute the greatest common divisor (g) of two integers (a, b), by the binary method in constant time
+ *
+ * As binary_euclid, but runs a fixed CONSTANT_TIME_GCD_ITERATIONS steps, each of which subtracts the smaller
+ * remainder from the larger if both are odd, then halves the even one, with every choice made by masks rather than
+ * branches, so the running time does not depend on the values of a and b (such as key material).
+ * @param[in]  a  integer >= 0
+ * @param[in]  b  integer >= 0
+ * @return  tuple of {g, i, j}, where g = ai + bj
+ * */
+std::tuple<long, long, long> binary_euclid_constant_time(long a, long b);
+
+/*
+ * @brief Compute the GCD of each of count independent pairs, by the constant time binary method
+ *
+ * The pairs are taken GCD_LANES at a time through the steps of binary_euclid_constant_time in lockstep, which
+ * needs no branches, so the compiler can vectorize the lanes, and the running time does not depend on the values.
+ * @param[in]  pairs  array of pairs of integers >= 0
+ * @param[in]  results  array of results
+ * @param[in]  count  number of pairs
+ * */
+void binary_euclid_lanes(EuclidPair const *pairs, EuclidResult *results, int count);
+
+/*
+ * @brief Compute the greatest common divisor (g) of two integers (a, b), by the method for the build
+ *
+ * Builds with EUCLID_CONSTANT_TIME defined (the euclid_ct binary) use binary_euclid_constant_time, for key
+ * material. Other builds use euclid_iterative, as a hardware divide of 64-bit integers now costs less than the
+ * extra steps of the binary method.
+ * @param[in]  a  integer >= 0
+ * @param[in]  b  integer >= 0
+ * @return  tuple of {g, i, j}, where g = ai + bj
+ * */
+inline std::tuple<long, long, long> extended_gcd(long a, long b) {
+#ifdef EUCLID_CONSTANT_TIME
+    return binary_euclid_constant_time(a, b);
+#else
+    return euclid_iterative(a, b);
+#endif
+}
+
+/*
+ * @brief Compute the GCD of each of count independent pairs, by the method for the build
+ *
+ * Builds with EUCLID_CONSTANT_TIME defined use binary_euclid_lanes, and other builds extended_gcd for each pair.
+ * @param[in]  pairs  array of pairs of integers >= 0
+ * @param[in]  results  array of results
+ * @param[in]  count  number of pairs
+ * */
+inline void extended_gcd_batch(EuclidPair const *pairs, EuclidResult *results, int count) {
+#ifdef EUCLID_CONSTANT_TIME
+    binary_euclid_lanes(pairs, results, count);
+#else
+    for (int k = 0; k < count; k++) {
+        auto [g, i, j] = extended_gcd(pairs[k].a, pairs[k].b);
+        results[k] = EuclidResult{g, i, j};
+    }
+#endif
+}
+
+#endif //CRYPTOGRAPHY_GCD_HPP
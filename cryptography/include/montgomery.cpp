@@ -0,0 +1,254 @@
+#include <cstdlib>
+#include <iostream>
+#include "montgomery.hpp"
+
+Montgomery64::Montgomery64(uint64_t modulus) : n(modulus) {
+    // Newton's iteration doubles the number of correct low bits of the inverse each step (n is its own inverse mod
+    // 2^3, as n is odd)
+    n_inverse = n;
+    for (int i = 0; i < 5; i++) {
+        n_inverse *= 2 - n * n_inverse;
+    }
+
+    // R mod n = (2^64 - n) mod n
+    uint64_t r = (0 - n) % n;
+    r2 = ((unsigned __int128) r * r) % n;
+}
+
+uint64_t modular_exponentiation_64(uint64_t x, uint64_t d, uint64_t n) {
+    if (n % 2 == 1) {
+        return sliding_window_exponentiation(Montgomery64(n), x, &d, 1);
+    } else {
+        return sliding_window_exponentiation(Modular64(n), x, &d, 1);
+    }
+}
+
+/*
+ * @brief Supporting function to exponentiate MODEXP_LANES odd moduli in lockstep
+ *
+ * @param[in]  triples  array of MODEXP_LANES triples, with odd moduli
+ * @param[in]  z  array of MODEXP_LANES results
+ * */
+static void modular_exponentiation_64_group(ModexpTriple const *triples, uint64_t *z) {
+    const int L = MODEXP_LANES;
+    const int W = MODEXP_LANE_WINDOW;
+
+    Montgomery64 lanes[L];
+    uint64_t powers[L][1 << W];
+    uint64_t z_mont[L];
+    int bits = 0;
+
+    for (int k = 0; k < L; k++) {
+        lanes[k] = Montgomery64(triples[k].n);
+        powers[k][0] = lanes[k].one();
+        powers[k][1] = lanes[k].to_montgomery(triples[k].x);
+        z_mont[k] = powers[k][0];
+        bits = std::max(bits, 64 - (triples[k].d ? __builtin_clzll(triples[k].d) : 64));
+    }
+    for (int j = 2; j < (1 << W); j++) {
+        for (int k = 0; k < L; k++) {
+            powers[k][j] = lanes[k].multiply(powers[k][j - 1], powers[k][1]);
+        }
+    }
+
+    for (int window = (bits + W - 1) / W - 1; window >= 0; window--) {
+        for (int s = 0; s < W; s++) {
+            for (int k = 0; k < L; k++) {
+                z_mont[k] = lanes[k].multiply(z_mont[k], z_mont[k]);
+            }
+        }
+        for (int k = 0; k < L; k++) {
+            z_mont[k] = lanes[k].multiply(z_mont[k], powers[k][(triples[k].d >> (window * W)) & ((1 << W) - 1)]);
+        }
+    }
+
+    for (int k = 0; k < L; k++) {
+        z[k] = lanes[k].from_montgomery(z_mont[k]);
+    }
+}
+
+void modular_exponentiation_64_lanes(ModexpTriple const *triples, uint64_t *z, int count) {
+    ModexpTriple group[MODEXP_LANES];
+    int group_index[MODEXP_LANES];
+    uint64_t group_z[MODEXP_LANES];
+    int group_size = 0;
+
+    for (int k = 0; k < count; k++) {
+        if (triples[k].n == 0) {
+            z[k] = 0;
+        } else if (triples[k].n % 2 == 0) {
+            z[k] = modular_exponentiation_64(triples[k].x, triples[k].d, triples[k].n);
+        } else {
+            group[group_size] = triples[k];
+            group_index[group_size++] = k;
+        }
+
+        // Pad the last group with trivial lanes (mod 1)
+        bool last = (k == count - 1);
+        if (last && group_size > 0) {
+            while (group_size < MODEXP_LANES) {
+                group_index[group_size] = -1;
+                group[group_size++] = ModexpTriple{0, 0, 1};
+            }
+        }
+
+        if (group_size == MODEXP_LANES) {
+            modular_exponentiation_64_group(group, group_z);
+            for (int g = 0; g < MODEXP_LANES; g++) {
+                if (group_index[g] >= 0) {
+                    z[group_index[g]] = group_z[g];
+                }
+            }
+            group_size = 0;
+        }
+    }
+}
+
+/*
+ * @brief Supporting function to compute (x^d) mod n with L-limb integers
+ *
+ * @param[in]  x  base, of at most L limbs
+ * @param[in]  d  exponent
+ * @param[in]  n  odd modulus, of at most L limbs
+ * @return  (x^d) mod n, as L limbs
+ * */
+template <int L>
+std::vector<uint64_t> modular_exponentiation_fixed(std::vector<uint64_t> const &x, std::vector<uint64_t> const &d,
+                                                   std::vector<uint64_t> const &n) {
+    BigUInt<L> x_fixed{}, n_fixed{};
+    std::copy(x.begin(), x.end(), x_fixed.limb);
+    std::copy(n.begin(), n.end(), n_fixed.limb);
+
+    auto z = sliding_window_exponentiation(MontgomeryN<L>(n_fixed), x_fixed, d.data(), d.size());
+    return std::vector<uint64_t>(z.limb, z.limb + L);
+}
+
+/*
+ * @brief Supporting function to drop the high zero limbs of an integer
+ * */
+static std::vector<uint64_t> trim(std::vector<uint64_t> limbs) {
+    while (!limbs.empty() && limbs.back() == 0) {
+        limbs.pop_back();
+    }
+    return limbs;
+}
+
+std::vector<uint64_t> modular_exponentiation_big(std::vector<uint64_t> const &x, std::vector<uint64_t> const &d,
+                                                 std::vector<uint64_t> const &n) {
+    std::vector<uint64_t> x_trimmed = trim(x);
+    std::vector<uint64_t> n_trimmed = trim(n);
+
+    if (n_trimmed.empty()) {
+        std::cerr << "Error: modulus must be > 0" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    if (n_trimmed.size() == 1) {
+        // Reduce a wide base mod n a limb at a time, from the most significant
+        uint64_t x_mod = 0;
+        for (auto it = x_trimmed.rbegin(); it != x_trimmed.rend(); ++it) {
+            x_mod = (((unsigned __int128) x_mod << 64) | *it) % n_trimmed[0];
+        }
+
+        std::vector<uint64_t> d_trimmed = trim(d);
+        uint64_t z = (n_trimmed[0] % 2 == 1)
+                     ? sliding_window_exponentiation(Montgomery64(n_trimmed[0]), x_mod, d_trimmed.data(),
+                                                     d_trimmed.size())
+                     : sliding_window_exponentiation(Modular64(n_trimmed[0]), x_mod, d_trimmed.data(),
+                                                     d_trimmed.size());
+        return trim({z});
+    }
+
+    if (n_trimmed[0] % 2 == 0) {
+        std::cerr << "Error: moduli wider than 64 bits must be odd" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    std::size_t width = std::max(x_trimmed.size(), n_trimmed.size());
+    if (width > (std::size_t) MAX_MODULUS_LIMBS) {
+        std::cerr << "Error: integers must be <= " << 64 * MAX_MODULUS_LIMBS << " bits" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    std::vector<uint64_t> z;
+    if (width <= 2) {
+        z = modular_exponentiation_fixed<2>(x_trimmed, d, n_trimmed);
+    } else if (width <= 4) {
+        z = modular_exponentiation_fixed<4>(x_trimmed, d, n_trimmed);
+    } else if (width <= 8) {
+        z = modular_exponentiation_fixed<8>(x_trimmed, d, n_trimmed);
+    } else if (width <= 16) {
+        z = modular_exponentiation_fixed<16>(x_trimmed, d, n_trimmed);
+    } else if (width <= 32) {
+        z = modular_exponentiation_fixed<32>(x_trimmed, d, n_trimmed);
+    } else {
+        z = modular_exponentiation_fixed<64>(x_trimmed, d, n_trimmed);
+    }
+    return trim(z);
+}
+
+std::vector<uint64_t> parse_big_integer(std::string const &digits) {
+    bool hex = digits.size() > 2 && digits[0] == '0' && (digits[1] == 'x' || digits[1] == 'X');
+    uint64_t base = hex ? 16 : 10;
+    std::vector<uint64_t> limbs;
+
+    if (digits.empty() || digits == "0x" || digits == "0X") {
+        std::cerr << "could not parse \"" << digits << "\" as an integer" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    for (std::size_t k = hex ? 2 : 0; k < digits.size(); k++) {
+        char c = digits[k];
+        uint64_t digit;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        } else if (hex && c >= 'a' && c <= 'f') {
+            digit = c - 'a' + 10;
+        } else if (hex && c >= 'A' && c <= 'F') {
+            digit = c - 'A' + 10;
+        } else {
+            std::cerr << "could not parse \"" << digits << "\" as a non-negative integer" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        // limbs = limbs * base + digit
+        uint64_t carry = digit;
+        for (auto &limb: limbs) {
+            unsigned __int128 p = (unsigned __int128) limb * base + carry;
+            limb = (uint64_t) p;
+            carry = p >> 64;
+        }
+        if (carry) {
+            limbs.push_back(carry);
+        }
+    }
+
+    return limbs;
+}
+
+std::string format_big_integer(std::vector<uint64_t> const &limbs) {
+    // Divide by 10^19 (the largest power of ten in a limb) repeatedly, taking 19 digits from each remainder
+    const uint64_t CHUNK = 10000000000000000000ULL;
+    std::vector<uint64_t> quotient = trim(limbs);
+    std::string digits;
+
+    while (!quotient.empty()) {
+        uint64_t remainder = 0;
+        for (auto it = quotient.rbegin(); it != quotient.rend(); ++it) {
+            unsigned __int128 value = ((unsigned __int128) remainder << 64) | *it;
+            *it = value / CHUNK;
+            remainder = value % CHUNK;
+        }
+        quotient = trim(quotient);
+
+        for (int k = 0; k < 19 && (remainder > 0 || !quotient.empty()); k++) {
+            digits.push_back('0' + remainder % 10);
+            remainder /= 10;
+        }
+    }
+
+    if (digits.empty()) {
+        return "0";
+    }
+    return std::string(digits.rbegin(), digits.rend());
+}
@@ -0,0 +1,358 @@
+#ifndef CRYPTOGRAPHY_MONTGOMERY_HPP
+#define CRYPTOGRAPHY_MONTGOMERY_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Width (in 64-bit limbs) of the widest fixed-width multi-limb path, for moduli of up to 4096 bits
+const int MAX_MODULUS_LIMBS = 64;
+
+/*
+ * @brief Montgomery arithmetic modulo an odd 64-bit modulus n, with R = 2^64
+ *
+ * Values are held in Montgomery form (a * R mod n), where a product can be reduced with two multiplications and no
+ * division. Products are formed in unsigned __int128, and reduced by subtracting (rather than adding) m * n, so the
+ * intermediate result never overflows, even for n >= 2^63.
+ * */
+struct Montgomery64 {
+    using Value = uint64_t;
+
+    uint64_t n;
+    uint64_t n_inverse; // n^-1 mod 2^64
+    uint64_t r2; // R^2 mod n
+
+    Montgomery64() = default;
+    explicit Montgomery64(uint64_t modulus);
+
+    // Reduce t < n * R to t * R^-1 mod n
+    uint64_t reduce(unsigned __int128 t) const {
+        uint64_t m = (uint64_t) t * n_inverse;
+        uint64_t t_high = t >> 64;
+        uint64_t mn_high = ((unsigned __int128) m * n) >> 64;
+
+        // The low words of t and m * n are equal, so only the high words need to be subtracted
+        uint64_t result = t_high - mn_high;
+        return (t_high < mn_high) ? result + n : result;
+    }
+
+    uint64_t multiply(uint64_t a, uint64_t b) const {
+        return reduce((unsigned __int128) a * b);
+    }
+
+    uint64_t to_montgomery(uint64_t a) const {
+        return multiply(a % n, r2);
+    }
+
+    uint64_t from_montgomery(uint64_t a) const {
+        return reduce(a);
+    }
+
+    // 1 in Montgomery form
+    uint64_t one() const {
+        return to_montgomery(1);
+    }
+};
+
+/*
+ * @brief Plain arithmetic modulo any 64-bit modulus n, with a hardware divide per product
+ *
+ * Used for even moduli, which have no Montgomery form. Has the same interface as Montgomery64.
+ * */
+struct Modular64 {
+    using Value = uint64_t;
+
+    uint64_t n;
+
+    explicit Modular64(uint64_t modulus) : n(modulus) {}
+
+    uint64_t multiply(uint64_t a, uint64_t b) const {
+        return ((unsigned __int128) a * b) % n;
+    }
+
+    uint64_t to_montgomery(uint64_t a) const {
+        return a % n;
+    }
+
+    uint64_t from_montgomery(uint64_t a) const {
+        return a;
+    }
+
+    uint64_t one() const {
+        return 1 % n;
+    }
+};
+
+/*
+ * @brief Fixed-width unsigned integer of L 64-bit limbs, least significant limb first
+ * */
+template <int L>
+struct BigUInt {
+    uint64_t limb[L];
+};
+
+/*
+ * @brief Montgomery arithmetic modulo an odd L-limb modulus n, with R = 2^(64 L)
+ *
+ * Products are formed and reduced together, one limb of the multiplier at a time, by the Coarsely Integrated
+ * Operand Scanning (CIOS) method, so the working value never grows beyond L + 2 limbs.
+ * */
+template <int L>
+struct MontgomeryN {
+    using Value = BigUInt<L>;
+
+    BigUInt<L> n;
+    uint64_t n_prime; // -n^-1 mod 2^64
+    BigUInt<L> r2; // R^2 mod n
+
+    explicit MontgomeryN(BigUInt<L> const &modulus) : n(modulus) {
+        // Newton's iteration doubles the number of correct low bits of the inverse each step (n is its own inverse
+        // mod 2^3, as n is odd)
+        uint64_t inverse = n.limb[0];
+        for (int i = 0; i < 5; i++) {
+            inverse *= 2 - n.limb[0] * inverse;
+        }
+        n_prime = -inverse;
+
+        // R^2 mod n, by doubling 1 modulo n 2 * 64 L times
+        BigUInt<L> r{};
+        r.limb[0] = 1;
+        for (int i = 0; i < 2 * 64 * L; i++) {
+            uint64_t carry = r.limb[L - 1] >> 63;
+            for (int j = L - 1; j > 0; j--) {
+                r.limb[j] = (r.limb[j] << 1) | (r.limb[j - 1] >> 63);
+            }
+            r.limb[0] <<= 1;
+            if (carry || !less(r, n)) {
+                subtract_n(r);
+            }
+        }
+        r2 = r;
+    }
+
+    // True if a < b
+    static bool less(BigUInt<L> const &a, BigUInt<L> const &b) {
+        for (int j = L - 1; j >= 0; j--) {
+            if (a.limb[j] != b.limb[j]) {
+                return a.limb[j] < b.limb[j];
+            }
+        }
+        return false;
+    }
+
+    // Subtract n from a in place, wrapping modulo R
+    void subtract_n(BigUInt<L> &a) const {
+        uint64_t borrow = 0;
+        for (int j = 0; j < L; j++) {
+            unsigned __int128 d = (unsigned __int128) a.limb[j] - n.limb[j] - borrow;
+            a.limb[j] = (uint64_t) d;
+            borrow = (d >> 64) ? 1 : 0;
+        }
+    }
+
+    // a * b * R^-1 mod n, for a < R and b < n
+    BigUInt<L> multiply(BigUInt<L> const &a, BigUInt<L> const &b) const {
+        uint64_t t[L + 2] = {};
+
+        for (int i = 0; i < L; i++) {
+            // t += a * b[i]
+            uint64_t carry = 0;
+            for (int j = 0; j < L; j++) {
+                unsigned __int128 p = (unsigned __int128) a.limb[j] * b.limb[i] + t[j] + carry;
+                t[j] = (uint64_t) p;
+                carry = p >> 64;
+            }
+            unsigned __int128 s = (unsigned __int128) t[L] + carry;
+            t[L] = (uint64_t) s;
+            t[L + 1] = s >> 64;
+
+            // t = (t + m * n) / 2^64, where m is chosen so that the low limb is zero
+            uint64_t m = t[0] * n_prime;
+            unsigned __int128 p = (unsigned __int128) m * n.limb[0] + t[0];
+            carry = p >> 64;
+            for (int j = 1; j < L; j++) {
+                p = (unsigned __int128) m * n.limb[j] + t[j] + carry;
+                t[j - 1] = (uint64_t) p;
+                carry = p >> 64;
+            }
+            s = (unsigned __int128) t[L] + carry;
+            t[L - 1] = (uint64_t) s;
+            t[L] = t[L + 1] + (uint64_t) (s >> 64);
+        }
+
+        // The result is < 2n, so at most one subtraction brings it into range
+        BigUInt<L> result;
+        for (int j = 0; j < L; j++) {
+            result.limb[j] = t[j];
+        }
+        if (t[L] || !less(result, n)) {
+            subtract_n(result);
+        }
+        return result;
+    }
+
+    BigUInt<L> to_montgomery(BigUInt<L> const &a) const {
+        return multiply(a, r2);
+    }
+
+    BigUInt<L> from_montgomery(BigUInt<L> const &a) const {
+        BigUInt<L> unit{};
+        unit.limb[0] = 1;
+        return multiply(a, unit);
+    }
+
+    // 1 in Montgomery form
+    BigUInt<L> one() const {
+        BigUInt<L> unit{};
+        unit.limb[0] = 1;
+        return to_montgomery(unit);
+    }
+};
+
+/*
+ * @brief Supporting function to choose the sliding window width for an exponent of a given bit length
+ *
+ * Wider windows need fewer multiplications during the scan of the exponent, but 2^(w - 1) precomputed odd powers.
+ * */
+inline int sliding_window_width(int bits) {
+    if (bits <= 24) return 1;
+    if (bits <= 80) return 3;
+    if (bits <= 240) return 4;
+    if (bits <= 672) return 5;
+    return 6;
+}
+
+/*
+ * @brief Compute (x^d) mod n by left-to-right sliding window exponentiation
+ *
+ * The exponent is scanned from its most significant bit, squaring once per bit, and multiplying by one of the
+ * precomputed odd powers x, x^3, ..., x^(2^w - 1) once per window of up to w bits that starts and ends with a 1.
+ * @param[in]  arithmetic  modular arithmetic (Montgomery64, Modular64 or MontgomeryN) for the modulus n
+ * @param[in]  x  base, in ordinary form
+ * @param[in]  d  pointer to the limbs of the exponent, least significant first
+ * @param[in]  d_size  number of limbs of the exponent
+ * @return  (x^d) mod n, in ordinary form
+ * */
+template <typename Arithmetic>
+typename Arithmetic::Value sliding_window_exponentiation(Arithmetic const &arithmetic,
+                                                         typename Arithmetic::Value const &x,
+                                                         uint64_t const *d, int d_size) {
+    using Value = typename Arithmetic::Value;
+
+    int bits = 64 * d_size;
+    while (bits > 0 && !((d[(bits - 1) / 64] >> ((bits - 1) % 64)) & 1)) {
+        bits--;
+    }
+    if (bits == 0) {
+        return arithmetic.from_montgomery(arithmetic.one());
+    }
+
+    auto bit = [d](int i) { return (d[i / 64] >> (i % 64)) & 1; };
+
+    // Odd powers of x, where powers[k] = x^(2k + 1)
+    int w = sliding_window_width(bits);
+    std::vector<Value> powers(1 << (w - 1));
+    powers[0] = arithmetic.to_montgomery(x);
+    Value x2 = arithmetic.multiply(powers[0], powers[0]);
+    for (std::size_t k = 1; k < powers.size(); k++) {
+        powers[k] = arithmetic.multiply(powers[k - 1], x2);
+    }
+
+    Value z = arithmetic.one();
+    bool started = false;
+    int i = bits - 1;
+
+    while (i >= 0) {
+        if (!bit(i)) {
+            z = arithmetic.multiply(z, z);
+            i--;
+            continue;
+        }
+
+        // Longest window [l, i] of at most w bits that ends with a 1
+        int l = std::max(i - w + 1, 0);
+        while (!bit(l)) {
+            l++;
+        }
+
+        int window = 0;
+        for (int k = i; k >= l; k--) {
+            window = (window << 1) | bit(k);
+        }
+
+        if (started) {
+            for (int k = i; k >= l; k--) {
+                z = arithmetic.multiply(z, z);
+            }
+            z = arithmetic.multiply(z, powers[window >> 1]);
+        } else {
+            // Squaring 1 is a no-op, so the first window just loads its power
+            z = powers[window >> 1];
+            started = true;
+        }
+        i = l - 1;
+    }
+
+    return arithmetic.from_montgomery(z);
+}
+
+/*
+ * @brief Compute value of (x^d) mod n, for 64-bit integers
+ *
+ * Odd moduli use Montgomery multiplication, and even moduli plain 128-bit products with a divide.
+ * @param[in]  x  base
+ * @param[in]  d  exponent
+ * @param[in]  n  modulus, which must be > 0
+ * @return  (x^d) mod n
+ * */
+uint64_t modular_exponentiation_64(uint64_t x, uint64_t d, uint64_t n);
+
+// Number of independent exponentiations interleaved by modular_exponentiation_64_lanes
+const int MODEXP_LANES = 8;
+
+// Width in bits of the fixed window of modular_exponentiation_64_lanes
+const int MODEXP_LANE_WINDOW = 4;
+
+// Base x, exponent d and modulus n of one 64-bit exponentiation, as stored in batch files
+struct ModexpTriple {
+    uint64_t x;
+    uint64_t d;
+    uint64_t n;
+};
+
+/*
+ * @brief Compute z[k] = (x^d) mod n for each of count independent 64-bit triples
+ *
+ * The odd moduli are taken MODEXP_LANES at a time through a fixed window exponentiation in lockstep, so the long
+ * dependency chains of the Montgomery products of each lane overlap with those of the other lanes, rather than
+ * stalling on each other as in sliding_window_exponentiation. Each lane does the same sequence of products, up to
+ * the longest exponent in the group, so none of them branch on the exponent. Even moduli take the scalar path, and
+ * a zero modulus gives 0.
+ * @param[in]  triples  array of triples
+ * @param[in]  z  array of results
+ * @param[in]  count  number of triples
+ * */
+void modular_exponentiation_64_lanes(ModexpTriple const *triples, uint64_t *z, int count);
+
+/*
+ * @brief Compute value of (x^d) mod n, for integers of up to 4096 bits
+ *
+ * Integers are vectors of 64-bit limbs, least significant first. Moduli that fit in 64 bits take the 64-bit path,
+ * and larger moduli, which must be odd, the fixed-width multi-limb Montgomery path of the narrowest width (2, 4,
+ * ..., 64 limbs) that holds all three integers.
+ * @param[in]  x  base
+ * @param[in]  d  exponent
+ * @param[in]  n  modulus, which must be > 0
+ * @return  (x^d) mod n, with no high zero limbs
+ * */
+std::vector<uint64_t> modular_exponentiation_big(std::vector<uint64_t> const &x, std::vector<uint64_t> const &d,
+                                                 std::vector<uint64_t> const &n);
+
+// Parse a string of decimal digits (or hex digits after "0x") into limbs, least significant first
+std::vector<uint64_t> parse_big_integer(std::string const &digits);
+
+// Format limbs, least significant first, as a decimal string
+std::string format_big_integer(std::vector<uint64_t> const &limbs);
+
+#endif //CRYPTOGRAPHY_MONTGOMERY_HPP
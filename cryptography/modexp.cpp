@@ -1,17 +1,34 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "include/batch.hpp"
+#include "include/montgomery.hpp"
+#include "../include/benchmark.hpp"
+#include "../include/taskpool.hpp"
+
+// Largest modulus for which the book's recursion cannot overflow a long (z * z * x < 2^63)
+const long MAX_RECURSIVE_MODULUS = 1L << 21;
 
 /*
- * @brief Parse argument to extract user long integer value
+ * @brief Parse argument to extract user number of repeats
  *
- * @param[in]  param  argv element corresponding to integer
- * @return  param converted to long int
+ * @param[in]  param  argv element corresponding to array size
+ * @return  (int)repeat_count  parsed repeat count, casted to int
  * */
-long get_long_param(char *param) {
+int get_repeat_count(char *param) {
     char *endptr;
-    long long_param;
+    long repeat_count;
 
     errno = 0;
-    long_param = std::strtol(param, &endptr, 10);
+    repeat_count = std::strtol(param, &endptr, 10);
 
     if (errno != 0) {
         perror("strtol");
@@ -19,16 +36,78 @@ long get_long_param(char *param) {
     }
 
     if (endptr == param) {
-        std::cerr << "could not parse long_param as an integer" << std::endl;
+        std::cerr << "could not parse repeat_count as an integer" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    if (repeat_count < 1) {
+        std::cerr << "repeat_count parameter must be >= 1" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    return (int) repeat_count;
+}
+
+/*
+ * @brief Parse argument to extract user number of threads
+ *
+ * @param[in]  param  argv element corresponding to thread count
+ * @return  (int)thread_count  parsed thread count, casted to int
+ * */
+int get_thread_count(char *param) {
+    char *endptr;
+    long thread_count;
+
+    errno = 0;
+    thread_count = std::strtol(param, &endptr, 10);
+
+    if (errno != 0) {
+        perror("strtol");
+        exit(EXIT_FAILURE);
+    }
+
+    if (endptr == param) {
+        std::cerr << "could not parse thread_count as an integer" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    if (thread_count < 1) {
+        std::cerr << "thread_count parameter must be >= 1" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    return (int) thread_count;
+}
+
+/*
+ * @brief Parse argument to extract user number of records
+ *
+ * @param[in]  param  argv element corresponding to record count
+ * @return  (long long)record_count  parsed record count
+ * */
+long long get_record_count(char *param) {
+    char *endptr;
+    long long record_count;
+
+    errno = 0;
+    record_count = std::strtoll(param, &endptr, 10);
+
+    if (errno != 0) {
+        perror("strtoll");
+        exit(EXIT_FAILURE);
+    }
+
+    if (endptr == param) {
+        std::cerr << "could not parse record_count as an integer" << std::endl;
         exit(EXIT_FAILURE);
     }
 
-    if (long_param < 0) {
-        std::cerr << "integer parameters must be >= 0" << std::endl;
+    if (record_count < 0) {
+        std::cerr << "record_count parameter must be >= 0" << std::endl;
         exit(EXIT_FAILURE);
     }
 
-    return long_param;
+    return record_count;
 }
 
 /*
@@ -47,20 +126,131 @@ long modular_exponentiation(long x, long d, long n) {
     }
 }
 
+/*
+ * @brief Write random 64-bit (x, d, n) triples to a batch file, with n > 0
+ *
+ * @param[in]  output_path  path of file for triples, or "-" for stdout
+ * @param[in]  count  number of triples
+ * */
+void generate_batch(std::string const &output_path, long long count) {
+    std::random_device rd;
+    std::mt19937_64 generator(rd());
+
+    write_records(output_path, sizeof(ModexpTriple), count, [&generator](void *record) {
+        ModexpTriple triple{generator(), generator(), generator() | 1};
+        // Keep a share of even moduli, which take the scalar path
+        if (generator() % 8 == 0) {
+            triple.n &= ~(uint64_t) 1;
+            triple.n += (triple.n == 0) ? 2 : 0;
+        }
+        *static_cast<ModexpTriple *>(record) = triple;
+    });
+}
+
+/*
+ * @brief Compute (x^d) mod n for each triple of a batch file, writing each result as a uint64_t
+ *
+ * @param[in]  input_path  path of file of triples, or "-" for stdin
+ * @param[in]  output_path  path of file for results, or "-" for stdout
+ * @param[in]  threads  number of threads
+ * */
+void run_batch(std::string const &input_path, std::string const &output_path, int threads) {
+    TaskPool pool(threads);
+    double compute_seconds;
+
+    auto t1 = std::chrono::steady_clock::now();
+    long long records = process_batch<ModexpTriple, uint64_t>(input_path, output_path, pool,
+                                                               modular_exponentiation_64_lanes, compute_seconds);
+    auto t2 = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(t2 - t1).count();
+
+    // Results may be on stdout, so report on stderr
+    std::cerr << "Computed " << records << " modular exponentiations on " << pool.size() << " threads" << std::endl;
+    std::cerr << "Time to process batch: " << seconds << " s, " << (records / std::max(seconds, 1e-9)) << " ops/s ("
+              << (records / std::max(compute_seconds, 1e-9)) << " ops/s excluding I/O)" << std::endl;
+}
+
 int main(int argc, char *argv[]) {
+    BenchmarkOptions options = parse_benchmark_options(argc, argv);
+
+    // Batch file modes (e.g. 'modexp generate triples.bin 1000000', then 'modexp batch triples.bin results.bin')
+    if (argc >= 2 && std::strcmp(argv[1], "generate") == 0) {
+        if (argc != 4) {
+            std::cerr << "Usage: " << argv[0] << " generate [output_path] [record_count]" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        generate_batch(argv[2], get_record_count(argv[3]));
+        exit(EXIT_SUCCESS);
+    }
+
+    if (argc >= 2 && std::strcmp(argv[1], "batch") == 0) {
+        if (argc != 4 && argc != 5) {
+            std::cerr << "Usage: " << argv[0] << " batch [input_path] [output_path] [thread_count (optional)]"
+                      << std::endl;
+            std::cerr << "Input is 64-bit (x, d, n) triples and output 64-bit results, in native byte order, "
+                      << "where a path of - is stdin or stdout" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        int threads = (argc == 5) ? get_thread_count(argv[4]) : std::max((int) std::thread::hardware_concurrency(), 1);
+        run_batch(argv[2], argv[3], threads);
+        exit(EXIT_SUCCESS);
+    }
+
     // Check correct usage (e.g. 'modexp 259 269 493')
-    if (argc != 4) {
-        std::cerr << "Usage: " << argv[0] << " [integer_x] [integer_d] [integer_n]" << std::endl;
+    if (argc != 4 && argc != 5) {
+        std::cerr << "Usage: " << argv[0] << " [integer_x] [integer_d] [integer_n] [repeat_count (optional)]"
+                  << " [--warmup=N] [--samples=N] [--format=text|csv|json] [--output=path] [--filter=name]"
+                  << " [--counters]"
+                  << std::endl;
+        std::cerr << "       " << argv[0] << " batch [input_path] [output_path] [thread_count (optional)]" << std::endl;
+        std::cerr << "       " << argv[0] << " generate [output_path] [record_count]" << std::endl;
+        std::cerr << "Integers may be decimal, or hex with a 0x prefix, of up to " << 64 * MAX_MODULUS_LIMBS
+                  << " bits" << std::endl;
         exit(EXIT_FAILURE);
     }
 
-    long integer_x = get_long_param(argv[1]);
-    long integer_d = get_long_param(argv[2]);
-    long integer_n = get_long_param(argv[3]);
+    auto integer_x = parse_big_integer(argv[1]);
+    auto integer_d = parse_big_integer(argv[2]);
+    auto integer_n = parse_big_integer(argv[3]);
+    int repeats = (argc == 5) ? get_repeat_count(argv[4]) : 1;
+
+    Benchmark bench("modexp", options, repeats);
+    long long bits = 64 * integer_n.size();
+
+    std::vector<uint64_t> z = modular_exponentiation_big(integer_x, integer_d, integer_n);
+    bench.log() << "z: " << format_big_integer(z) << std::endl;
 
-    auto z = modular_exponentiation(integer_x, integer_d, integer_n);
+    // Check against (and compare with) the book's recursion for small enough integers
+    double book_median = 0;
+    if (integer_x.size() <= 1 && integer_d.size() <= 1 && integer_n.size() == 1) {
+        uint64_t x = integer_x.empty() ? 0 : integer_x[0];
+        uint64_t d = integer_d.empty() ? 0 : integer_d[0];
+        uint64_t n = integer_n[0];
 
-    std::cout << "z: " << z << std::endl;
+        if (x < n && d <= (uint64_t) std::numeric_limits<long>::max() && n <= (uint64_t) MAX_RECURSIVE_MODULUS) {
+            long z_book = modular_exponentiation(x, d, n) % n;
+            if (z_book != (long) (z.empty() ? 0 : z[0])) {
+                std::cerr << "Montgomery result does not match the book's recursion: " << z_book << std::endl;
+                exit(EXIT_FAILURE);
+            }
+
+            book_median = bench.run("Modular exponentiation (book recursion)", bits,
+                                    [&]() { do_not_optimize(modular_exponentiation(x, d, n)); });
+        }
+    }
+
+    std::vector<uint64_t> z_run;
+    double median = bench.run("Modular exponentiation", bits, []() {},
+                              [&]() { z_run = modular_exponentiation_big(integer_x, integer_d, integer_n); }, [&]() {
+        if (z_run != z) {
+            std::cerr << "Modular exponentiation results differ between runs" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    });
+    if (median > 0 && book_median > 0) {
+        bench.metric("x speedup vs book recursion", book_median / median);
+    }
 
+    bench.report();
     exit(EXIT_SUCCESS);
 }
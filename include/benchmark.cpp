@@ -0,0 +1,382 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include "benchmark.hpp"
+#include "perfcounters.hpp"
+
+/*
+ * @brief Supporting function to parse a flag value as an integer, exiting if it is not one
+ * */
+static long long parse_flag_integer(char const *flag, char const *value) {
+    char *endptr;
+    errno = 0;
+    long long result = std::strtoll(value, &endptr, 10);
+
+    if (errno != 0 || endptr == value || *endptr != '\0') {
+        std::cerr << "could not parse " << flag << " value \"" << value << "\" as an integer" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    return result;
+}
+
+/*
+ * @brief Supporting function to parse the sizes of a sweep, either a list or a geometric range
+ * */
+static std::vector<long long> parse_sweep(char const *value) {
+    std::string text(value);
+    std::vector<std::string> parts;
+    char separator = (text.find(':') != std::string::npos) ? ':' : ',';
+
+    std::stringstream stream(text);
+    std::string part;
+    while (std::getline(stream, part, separator)) {
+        parts.push_back(part);
+    }
+
+    std::vector<long long> sizes;
+    if (separator == ':') {
+        if (parts.size() != 3) {
+            std::cerr << "--sweep range must be lo:hi:factor" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        long long lo = parse_flag_integer("--sweep", parts[0].c_str());
+        long long hi = parse_flag_integer("--sweep", parts[1].c_str());
+        long long factor = parse_flag_integer("--sweep", parts[2].c_str());
+        if (lo < 1 || factor < 2) {
+            std::cerr << "--sweep range must have lo >= 1 and factor >= 2" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        for (long long size = lo; size <= hi; size *= factor) {
+            sizes.push_back(size);
+        }
+    } else {
+        for (auto const &size: parts) {
+            sizes.push_back(parse_flag_integer("--sweep", size.c_str()));
+        }
+    }
+
+    if (sizes.empty()) {
+        std::cerr << "--sweep must give at least one size" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    return sizes;
+}
+
+BenchmarkOptions parse_benchmark_options(int &argc, char *argv[]) {
+    BenchmarkOptions options;
+    int kept = 1;
+
+    for (int k = 1; k < argc; k++) {
+        char *arg = argv[k];
+        char *value = std::strchr(arg, '=');
+
+        if (std::strcmp(arg, "--counters") == 0) {
+            options.counters = true;
+            continue;
+        }
+
+        if (std::strncmp(arg, "--", 2) != 0 || value == nullptr) {
+            argv[kept++] = arg;
+            continue;
+        }
+
+        std::string flag(arg, value - arg);
+        value++;
+
+        if (flag == "--warmup") {
+            options.warmup = parse_flag_integer("--warmup", value);
+        } else if (flag == "--samples") {
+            options.samples = parse_flag_integer("--samples", value);
+        } else if (flag == "--format") {
+            options.format = value;
+            if (options.format != "text" && options.format != "csv" && options.format != "json") {
+                std::cerr << "--format must be text, csv or json" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+        } else if (flag == "--output") {
+            options.output = value;
+        } else if (flag == "--filter") {
+            options.filter = value;
+        } else if (flag == "--sweep") {
+            options.sweep = parse_sweep(value);
+        } else if (flag == "--seed") {
+            long long seed = parse_flag_integer("--seed", value);
+            if (seed < 0) {
+                std::cerr << "--seed must be >= 0" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            options.seed = seed;
+        } else if (flag == "--input") {
+            options.input = value;
+        } else {
+            std::cerr << "unknown flag " << flag << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (options.warmup < 0 || options.samples < 0) {
+        std::cerr << "--warmup and --samples must be >= 0" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    argc = kept;
+    argv[argc] = nullptr;
+    return options;
+}
+
+Benchmark::Benchmark(std::string program_name, BenchmarkOptions benchmark_options, int default_samples)
+        : program(std::move(program_name)), options(std::move(benchmark_options)) {
+    sample_count = (options.samples > 0) ? options.samples : std::max(default_samples, 1);
+
+    if (options.counters) {
+        perf = std::make_unique<PerfCounters>();
+        if (!perf->available()) {
+            log() << "Hardware counters unavailable: " << perf->error() << std::endl;
+            perf.reset();
+        } else if (!perf->error().empty()) {
+            log() << "Some hardware counters unavailable: " << perf->error() << std::endl;
+        }
+    }
+}
+
+/*
+ * @brief Supporting function to quote a field of a CSV report, doubling any embedded quote (RFC 4180)
+ * */
+static std::string csv_quote(std::string const &text) {
+    std::string quoted = "\"";
+    for (char c: text) {
+        if (c == '"') {
+            quoted += '"';
+        }
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+/*
+ * @brief Supporting function to quote a string of a JSON report, escaping quotes, backslashes and control chars
+ * */
+static std::string json_quote(std::string const &text) {
+    std::string quoted = "\"";
+    for (char c: text) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+            quoted += c;
+        } else if ((unsigned char) c < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned char) c);
+            quoted += escaped;
+        } else {
+            quoted += c;
+        }
+    }
+    return quoted + "\"";
+}
+
+Benchmark::~Benchmark() {
+    report();
+}
+
+void Benchmark::report() {
+    flush_text();
+    if (reported || options.format == "text") {
+        return;
+    }
+    reported = true;
+
+    std::ofstream file;
+    if (!options.output.empty()) {
+        file.open(options.output);
+        if (!file) {
+            std::cerr << "could not open " << options.output << " for the benchmark report" << std::endl;
+            return;
+        }
+    }
+    std::ostream &out = options.output.empty() ? std::cout : file;
+    out << std::setprecision(9);
+
+    if (options.format == "csv") {
+        out << "program,name,size,threads,ops,samples,min_s,median_s,p99_s,mean_s,metrics" << std::endl;
+        for (auto const &result: results) {
+            std::ostringstream metrics;
+            metrics << std::setprecision(9);
+            for (std::size_t k = 0; k < result.metrics.size(); k++) {
+                metrics << (k ? ";" : "") << result.metrics[k].first << "=" << result.metrics[k].second;
+            }
+            out << program << "," << csv_quote(result.name) << "," << result.size << "," << result.threads << ","
+                << result.ops << "," << result.samples << "," << result.min << "," << result.median << ","
+                << result.p99 << "," << result.mean << "," << csv_quote(metrics.str()) << std::endl;
+        }
+    } else {
+        out << "{\"program\": " << json_quote(program) << ", \"results\": [" << std::endl;
+        for (std::size_t r = 0; r < results.size(); r++) {
+            auto const &result = results[r];
+            out << "  {\"name\": " << json_quote(result.name) << ", \"size\": " << result.size << ", \"threads\": "
+                << result.threads << ", \"ops\": " << result.ops << ", \"samples\": " << result.samples
+                << ", \"min_s\": " << result.min << ", \"median_s\": " << result.median << ", \"p99_s\": "
+                << result.p99 << ", \"mean_s\": " << result.mean << ", \"metrics\": {";
+            for (std::size_t k = 0; k < result.metrics.size(); k++) {
+                out << (k ? ", " : "") << json_quote(result.metrics[k].first) << ": " << result.metrics[k].second;
+            }
+            out << "}}" << ((r + 1 < results.size()) ? "," : "") << std::endl;
+        }
+        out << "]}" << std::endl;
+    }
+}
+
+double Benchmark::run(std::string const &name, long long size, std::function<void()> const &setup,
+                      std::function<void()> const &fn, std::function<void()> const &check) {
+    if (!enabled(name)) {
+        return 0;
+    }
+
+    for (int k = 0; k < options.warmup; k++) {
+        setup();
+        fn();
+        clobber_memory();
+        check();
+    }
+
+    std::vector<double> samples;
+    PerfCounts counts;
+    for (int k = 0; k < sample_count; k++) {
+        setup();
+        clobber_memory();
+        if (perf) {
+            perf->start();
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        fn();
+        clobber_memory();
+        auto t2 = std::chrono::steady_clock::now();
+        if (perf) {
+            perf->stop(counts);
+        }
+        check();
+        samples.push_back(std::chrono::duration<double>(t2 - t1).count());
+    }
+
+    double median = record(name, size, std::move(samples));
+    if (perf) {
+        double units = (double) sample_count * op_count * counter_units_per_op;
+        for (int e = 0; e < PERF_EVENT_COUNT; e++) {
+            if (counts.valid[e] && units > 0) {
+                metric(std::string(PERF_EVENT_NAMES[e]) + "/" + counter_unit, counts.value[e] / units);
+            }
+        }
+        if (counts.valid[PERF_CYCLES] && counts.valid[PERF_INSTRUCTIONS] && counts.value[PERF_CYCLES] > 0) {
+            metric("instructions/cycle", counts.value[PERF_INSTRUCTIONS] / counts.value[PERF_CYCLES]);
+        }
+    }
+    return median;
+}
+
+double Benchmark::run(std::string const &name, long long size, std::function<void()> const &setup,
+                      std::function<void()> const &fn) {
+    return run(name, size, setup, fn, []() {});
+}
+
+double Benchmark::run(std::string const &name, long long size, std::function<void()> const &fn) {
+    return run(name, size, []() {}, fn, []() {});
+}
+
+double Benchmark::record(std::string const &name, long long size, std::vector<double> samples) {
+    if (!enabled(name) || samples.empty()) {
+        return 0;
+    }
+    flush_text();
+
+    std::sort(samples.begin(), samples.end());
+    int n = samples.size();
+    for (double &sample: samples) {
+        sample /= op_count;
+    }
+
+    BenchmarkResult result;
+    result.name = name;
+    result.size = size;
+    result.samples = n;
+    result.threads = thread_count;
+    result.ops = op_count;
+    result.min = samples.front();
+    result.median = (n % 2 == 1) ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+    result.p99 = samples[std::max((int) std::ceil(0.99 * n) - 1, 0)];
+    double total = 0;
+    for (double sample: samples) {
+        total += sample;
+    }
+    result.mean = total / n;
+
+    results.push_back(result);
+    pending_text = true;
+    return result.median;
+}
+
+void Benchmark::metric(std::string const &name, double value) {
+    if (pending_text) {
+        results.back().metrics.emplace_back(name, value);
+    }
+}
+
+void Benchmark::flush_text() {
+    if (!pending_text) {
+        return;
+    }
+    pending_text = false;
+    if (options.format != "text") {
+        return;
+    }
+
+    auto const &result = results.back();
+    std::cout << result.name << ": " << result.median << " s (median per op of " << result.samples
+              << " samples, min " << result.min << " s, p99 " << result.p99 << " s)";
+    for (auto const &metric: result.metrics) {
+        std::cout << ", " << metric.second << " " << metric.first;
+    }
+    std::cout << std::endl;
+}
+
+bool Benchmark::enabled(std::string const &name) const {
+    return options.filter.empty() || name.find(options.filter) != std::string::npos;
+}
+
+std::vector<long long> Benchmark::sizes(long long size) const {
+    return options.sweep.empty() ? std::vector<long long>{size} : options.sweep;
+}
+
+std::vector<long long> Benchmark::sizes(std::vector<long long> const &default_sizes) const {
+    return options.sweep.empty() ? default_sizes : options.sweep;
+}
+
+void Benchmark::set_threads(int threads) {
+    thread_count = threads;
+}
+
+void Benchmark::set_ops(long long ops) {
+    op_count = std::max(ops, 1LL);
+}
+
+void Benchmark::set_counter_unit(std::string unit, double units_per_op) {
+    counter_unit = std::move(unit);
+    counter_units_per_op = units_per_op;
+}
+
+std::ostream &Benchmark::log() {
+    // Pending text lines must come out before anything else the program prints
+    flush_text();
+    return (options.format != "text" && options.output.empty()) ? std::cerr : std::cout;
+}
+
+int Benchmark::samples() const {
+    return sample_count;
+}
+
+int Benchmark::warmup() const {
+    return options.warmup;
+}
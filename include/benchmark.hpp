@@ -0,0 +1,177 @@
+#ifndef INCLUDE_BENCHMARK_HPP
+#define INCLUDE_BENCHMARK_HPP
+
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+ * @brief Barrier that makes the compiler assume value is read, so the work that computed it cannot be optimised away
+ * */
+template <typename T>
+inline void do_not_optimize(T const &value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/*
+ * @brief Barrier that also makes the compiler assume value is modified, so a computation from it cannot be hoisted
+ * out of a loop, even if its inputs never change
+ * */
+template <typename T>
+inline void do_not_optimize(T &value) {
+    asm volatile("" : "+r,m"(value) : : "memory");
+}
+
+/*
+ * @brief Barrier that makes the compiler assume all memory is read and written, so pending stores cannot be
+ * optimised away or moved across it
+ * */
+inline void clobber_memory() {
+    asm volatile("" : : : "memory");
+}
+
+// Options of a benchmark run, parsed from the --flags on the command line
+struct BenchmarkOptions {
+    int warmup = 1; // untimed runs before the samples
+    int samples = 0; // timed runs, or 0 for the repeat count of the program
+    std::string format = "text"; // text, csv or json
+    std::string output; // file for the csv or json report, or empty for stdout
+    std::string filter; // only run the benchmarks whose names contain this
+    std::vector<long long> sweep; // sizes to run, in place of the size argument of the program
+    bool counters = false; // count hardware events (cycles, cache and branch misses) of each timed run
+    uint64_t seed = 42; // seed of the generated inputs (DEFAULT_INPUT_SEED of randgen.hpp)
+    std::string input; // distribution or alphabet of the generated inputs, or empty for the program default
+};
+
+/*
+ * @brief Parse and remove the benchmark flags from the command line
+ *
+ * Recognises --warmup=N, --samples=N, --format=text|csv|json, --output=path, --filter=text, --sweep=sizes,
+ * --seed=N, --input=name and --counters, where sizes is either a list (1000,10000,100000) or a geometric range
+ * (lo:hi:factor, e.g. 1000:1000000:10), and the input name is checked by the program that generates it. The other
+ * arguments are moved down over the removed flags, so the program parses its positional arguments as before.
+ * @param[in]  argc  argument count, reduced by the number of flags removed
+ * @param[in]  argv  argument vector
+ * @return  parsed options
+ * */
+BenchmarkOptions parse_benchmark_options(int &argc, char *argv[]);
+
+class PerfCounters;
+
+// Summary of the timed samples of one benchmark, with any extra metrics reported alongside
+struct BenchmarkResult {
+    std::string name;
+    long long size;
+    int samples;
+    int threads;
+    long long ops; // operations per timed run, by which the times are divided
+    double min; // seconds per op
+    double median; // seconds per op
+    double p99; // seconds per op
+    double mean; // seconds per op
+    std::vector<std::pair<std::string, double>> metrics;
+};
+
+/*
+ * @brief Harness that times benchmarks and reports them as text, CSV or JSON.
+ *
+ * Each benchmark runs warmup untimed runs and then samples timed runs, with its setup (such as filling the input
+ * with fresh random data) and its check (such as verifying the output) run untimed around each one. The text
+ * report prints each benchmark as it completes, and the CSV and JSON reports are written by report (or when the
+ * harness is destroyed). Programs print any other output to log(), which is stderr when the report is on stdout, so
+ * the report stays machine readable. With --counters, the hardware events of the timed runs (on the calling thread)
+ * are attached to each benchmark as metrics per unit of work, such as cycles/element.
+ * */
+class Benchmark {
+public:
+    /*
+     * @param[in]  program  name of the program, recorded in the reports
+     * @param[in]  options  options parsed from the command line
+     * @param[in]  default_samples  number of samples when the options do not give one (the repeat count)
+     * */
+    Benchmark(std::string program, BenchmarkOptions options, int default_samples);
+
+    // Writes the report, if report has not been called
+    ~Benchmark();
+
+    Benchmark(Benchmark const &) = delete;
+    Benchmark &operator=(Benchmark const &) = delete;
+
+    /*
+     * @brief Time fn, calling setup before and check after each run, untimed
+     *
+     * @param[in]  name  name of the benchmark, also its label in the text report
+     * @param[in]  size  problem size (such as the number of elements), recorded in the reports
+     * @param[in]  setup  prepares the input of a run
+     * @param[in]  fn  the work to be timed
+     * @param[in]  check  verifies the output of a run, exiting on failure
+     * @return  median time of fn in seconds per op, or 0 if the benchmark is skipped by the filter
+     * */
+    double run(std::string const &name, long long size, std::function<void()> const &setup,
+               std::function<void()> const &fn, std::function<void()> const &check);
+
+    // Time fn, calling setup before each run, untimed
+    double run(std::string const &name, long long size, std::function<void()> const &setup,
+               std::function<void()> const &fn);
+
+    // Time fn
+    double run(std::string const &name, long long size, std::function<void()> const &fn);
+
+    // Time a region that the caller has already measured, such as a phase of a larger computation, from samples of
+    // its duration in seconds
+    double record(std::string const &name, long long size, std::vector<double> samples);
+
+    // Attach a metric (such as a speedup, or a rate) to the last benchmark, printed at the end of its text line
+    void metric(std::string const &name, double value);
+
+    // True if the benchmark is selected by the filter
+    bool enabled(std::string const &name) const;
+
+    // Sizes to run, which are the sweep sizes if given, or the size argument of the program
+    std::vector<long long> sizes(long long size) const;
+
+    // Sizes to run, which are the sweep sizes if given, or the default sizes of the program
+    std::vector<long long> sizes(std::vector<long long> const &default_sizes) const;
+
+    // Number of threads recorded with the following benchmarks
+    void set_threads(int threads);
+
+    // Number of operations in each timed run of the following benchmarks (such as a loop of searches), so times
+    // are reported per operation
+    void set_ops(long long ops);
+
+    // Unit of work of the following benchmarks, and the number of units per op, by which the hardware event counts
+    // are divided (e.g. "element" and the array size for a sort), or "op" and 1 by default
+    void set_counter_unit(std::string unit, double units_per_op);
+
+    // Finish the text report, or write the CSV or JSON report (call before exit, which skips the destructor)
+    void report();
+
+    // Stream for the other output of the program
+    std::ostream &log();
+
+    int samples() const;
+    int warmup() const;
+
+private:
+    // Print the text line of the last benchmark, after its metrics are complete
+    void flush_text();
+
+    std::string program;
+    BenchmarkOptions options;
+    int sample_count;
+    int thread_count = 1;
+    long long op_count = 1;
+    std::string counter_unit = "op";
+    double counter_units_per_op = 1;
+    std::unique_ptr<PerfCounters> perf;
+    std::vector<BenchmarkResult> results;
+    bool pending_text = false;
+    bool reported = false;
+};
+
+#endif //INCLUDE_BENCHMARK_HPP
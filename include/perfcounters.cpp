@@ -0,0 +1,121 @@
+#include <cerrno>
+#include <cstring>
+#include "perfcounters.hpp"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+char const *const PERF_EVENT_NAMES[PERF_EVENT_COUNT] = {
+    "cycles", "instructions", "L1d misses", "LLC misses", "branch misses"
+};
+
+#ifdef __linux__
+
+/*
+ * @brief Supporting function to open one hardware event on the calling thread, in user space only
+ *
+ * @param[in]  type  PERF_TYPE_HARDWARE or PERF_TYPE_HW_CACHE
+ * @param[in]  config  event of the type
+ * @return  file descriptor of the event, or -1 with errno set
+ * */
+static int open_event(uint32_t type, uint64_t config) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+PerfCounters::PerfCounters() {
+    uint64_t const l1d_read_miss = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                   (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    uint32_t const types[PERF_EVENT_COUNT] = {
+        PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE
+    };
+    uint64_t const configs[PERF_EVENT_COUNT] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, l1d_read_miss, PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES
+    };
+
+    for (int e = 0; e < PERF_EVENT_COUNT; e++) {
+        fds[e] = open_event(types[e], configs[e]);
+        if (fds[e] < 0) {
+            open_error += std::string(open_error.empty() ? "" : ", ") + PERF_EVENT_NAMES[e] + " (" +
+                          std::strerror(errno) + ")";
+        }
+    }
+}
+
+PerfCounters::~PerfCounters() {
+    for (int fd: fds) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+}
+
+void PerfCounters::start() {
+    for (int fd: fds) {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+void PerfCounters::stop(PerfCounts &total) {
+    for (int fd: fds) {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+
+    for (int e = 0; e < PERF_EVENT_COUNT; e++) {
+        // Value, time enabled and time running, which is less than enabled if the PMU was shared with other events
+        uint64_t data[3];
+        if (fds[e] < 0 || read(fds[e], data, sizeof(data)) != (ssize_t) sizeof(data) || data[2] == 0) {
+            continue;
+        }
+        total.value[e] += (double) data[0] * data[1] / data[2];
+        total.valid[e] = true;
+    }
+}
+
+#else
+
+PerfCounters::PerfCounters() : open_error("perf_event_open is only available on Linux") {
+    for (int &fd: fds) {
+        fd = -1;
+    }
+}
+
+PerfCounters::~PerfCounters() = default;
+
+void PerfCounters::start() {}
+
+void PerfCounters::stop(PerfCounts &) {}
+
+#endif
+
+bool PerfCounters::available() const {
+    for (int fd: fds) {
+        if (fd >= 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string const &PerfCounters::error() const {
+    return open_error;
+}
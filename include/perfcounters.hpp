@@ -0,0 +1,59 @@
+#ifndef INCLUDE_PERFCOUNTERS_HPP
+#define INCLUDE_PERFCOUNTERS_HPP
+
+#include <cstdint>
+#include <string>
+
+// Hardware events counted by PerfCounters
+enum PerfEvent {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_EVENT_COUNT
+};
+
+// Name of each event, as reported (e.g. "cycles")
+extern char const *const PERF_EVENT_NAMES[PERF_EVENT_COUNT];
+
+// Counts of each event between PerfCounters::start and PerfCounters::stop
+struct PerfCounts {
+    double value[PERF_EVENT_COUNT] = {0}; // scaled up if the event was multiplexed with others on the PMU
+    bool valid[PERF_EVENT_COUNT] = {false}; // false if the event could not be counted
+};
+
+/*
+ * @brief Class to count hardware events (cycles, instructions, cache and branch misses) with perf_event_open.
+ *
+ * Each event is opened on the calling thread, in user space only (so perf_event_paranoid of up to 2 is enough),
+ * and events that the CPU, the kernel or a virtual machine does not provide are left out, so a program runs the
+ * same without them. Only the calling thread is counted, so the threads of a TaskPool, which are created before
+ * the counters, are not. Outside Linux, no event is available.
+ * */
+class PerfCounters {
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(PerfCounters const &) = delete;
+    PerfCounters &operator=(PerfCounters const &) = delete;
+
+    // True if any event can be counted
+    bool available() const;
+
+    // Reason the events that could not be opened are missing, or empty if all were opened
+    std::string const &error() const;
+
+    // Reset and start counting
+    void start();
+
+    // Stop counting, and add the counts since start to total
+    void stop(PerfCounts &total);
+
+private:
+    int fds[PERF_EVENT_COUNT];
+    std::string open_error;
+};
+
+#endif //INCLUDE_PERFCOUNTERS_HPP
@@ -0,0 +1,279 @@
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include "randgen.hpp"
+
+// Multipliers and key increments of Philox4x32
+static const uint32_t PHILOX_M0 = 0xD2511F53;
+static const uint32_t PHILOX_M1 = 0xCD9E8D57;
+static const uint32_t PHILOX_W0 = 0x9E3779B9;
+static const uint32_t PHILOX_W1 = 0xBB67AE85;
+
+// Number of counters run through the rounds of Philox together, as independent lanes (enough that the loop over
+// them is vectorized rather than unrolled)
+static const int PHILOX_LANES = 32;
+
+// Compile the Philox rounds for each x86 vector width, chosen between at load time
+#if defined(__x86_64__) && defined(__linux__)
+#define RANDGEN_TARGET_CLONES __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define RANDGEN_TARGET_CLONES
+#endif
+
+Distribution parse_distribution(std::string const &name) {
+    if (name == "uniform") return Distribution::UNIFORM;
+    if (name == "sorted") return Distribution::SORTED;
+    if (name == "reverse") return Distribution::REVERSE_SORTED;
+    if (name == "fewunique") return Distribution::FEW_UNIQUE;
+    if (name == "zipf") return Distribution::ZIPF;
+    if (name == "nearlysorted") return Distribution::NEARLY_SORTED;
+    if (name == "runs") return Distribution::SORTED_RUNS;
+
+    std::cerr << "distribution must be one of: uniform, sorted, reverse, fewunique, zipf, nearlysorted, runs"
+              << std::endl;
+    exit(EXIT_FAILURE);
+}
+
+Alphabet parse_alphabet(std::string const &name) {
+    if (name == "alphanumeric") return Alphabet::ALPHANUMERIC;
+    if (name == "dna") return Alphabet::DNA;
+    if (name == "text") return Alphabet::TEXT;
+
+    std::cerr << "alphabet must be one of: alphanumeric, dna, text" << std::endl;
+    exit(EXIT_FAILURE);
+}
+
+/*
+ * @brief Supporting function to mix the bits of a 64-bit integer (the SplitMix64 finalizer)
+ * */
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return x;
+}
+
+uint64_t derive_seed(uint64_t seed, uint64_t stream) {
+    return mix64(seed ^ mix64(stream + 0x9E3779B97F4A7C15ULL));
+}
+
+RANDGEN_TARGET_CLONES
+void fill_random_words(uint32_t *words, std::size_t first, std::size_t count, uint64_t seed) {
+    if (count == 0) return;
+
+    uint64_t first_counter = first / 4;
+    uint64_t last_counter = (first + count - 1) / 4;
+
+    for (uint64_t base = first_counter; base <= last_counter; base += PHILOX_LANES) {
+        // Structure of arrays, so each step of a round is one loop over the lanes
+        uint32_t c0[PHILOX_LANES], c1[PHILOX_LANES], c2[PHILOX_LANES], c3[PHILOX_LANES];
+        for (int l = 0; l < PHILOX_LANES; l++) {
+            uint64_t counter = base + l;
+            c0[l] = (uint32_t) counter;
+            c1[l] = (uint32_t) (counter >> 32);
+            c2[l] = 0;
+            c3[l] = 0;
+        }
+
+        uint32_t k0 = (uint32_t) seed;
+        uint32_t k1 = (uint32_t) (seed >> 32);
+        for (int round = 0; round < 10; round++) {
+            for (int l = 0; l < PHILOX_LANES; l++) {
+                uint32_t hi0 = ((uint64_t) PHILOX_M0 * c0[l]) >> 32;
+                uint32_t hi1 = ((uint64_t) PHILOX_M1 * c2[l]) >> 32;
+                uint32_t lo0 = PHILOX_M0 * c0[l];
+                uint32_t lo1 = PHILOX_M1 * c2[l];
+                c0[l] = hi1 ^ c1[l] ^ k0;
+                c2[l] = hi0 ^ c3[l] ^ k1;
+                c1[l] = lo1;
+                c3[l] = lo0;
+            }
+            k0 += PHILOX_W0;
+            k1 += PHILOX_W1;
+        }
+
+        // Interleave the lanes into the words of the block, checking the bounds only at the ends of the range
+        uint64_t index = base * 4;
+        if (index >= first && index + 4 * PHILOX_LANES <= first + count) {
+            uint32_t *out = words + (index - first);
+            for (int l = 0; l < PHILOX_LANES; l++) {
+                out[4 * l] = c0[l];
+                out[4 * l + 1] = c1[l];
+                out[4 * l + 2] = c2[l];
+                out[4 * l + 3] = c3[l];
+            }
+            continue;
+        }
+        for (int l = 0; l < PHILOX_LANES; l++) {
+            uint32_t const out[4] = {c0[l], c1[l], c2[l], c3[l]};
+            for (int w = 0; w < 4; w++) {
+                uint64_t i = index + 4 * l + w;
+                if (i >= first && i < first + count) {
+                    words[i - first] = out[w];
+                }
+            }
+        }
+    }
+}
+
+void fill_random_ints(int *A, std::size_t first, std::size_t count, std::size_t n, Distribution distribution,
+                      uint64_t seed) {
+    std::vector<uint32_t> words(std::min(count, FILL_GRAIN_SIZE));
+
+    // Gap between the start of the ranges of neighbouring values of a sorted array, so the last one is <= INT_MAX.
+    // Arrays of more than INT_MAX elements have no gap, and each value is repeated about n / INT_MAX times.
+    uint64_t step = (n <= (std::size_t) INT_MAX) ? INT_MAX / std::max<std::size_t>(n, 1) : 0;
+    uint64_t run_step = INT_MAX / std::max<std::size_t>(std::min(n, SORTED_RUN_LENGTH), 1);
+    double log_ranks = std::log((double) ZIPF_RANKS + 1);
+
+    for (std::size_t chunk = first; chunk < first + count; chunk += FILL_GRAIN_SIZE) {
+        std::size_t end = std::min(chunk + FILL_GRAIN_SIZE, first + count);
+        int *out = A + (chunk - first);
+
+        // A reversed array is generated from the words of the mirrored range, so it is exactly SORTED reversed
+        if (distribution == Distribution::REVERSE_SORTED) {
+            fill_random_words(words.data(), n - end, end - chunk, seed);
+            std::reverse(words.begin(), words.begin() + (end - chunk));
+        } else {
+            fill_random_words(words.data(), chunk, end - chunk, seed);
+        }
+
+        for (std::size_t i = chunk; i < end; i++) {
+            uint64_t w = words[i - chunk];
+            // Position of the element in ascending order, for the sorted distributions
+            std::size_t rank = (distribution == Distribution::REVERSE_SORTED) ? n - 1 - i : i;
+
+            switch (distribution) {
+                case Distribution::UNIFORM:
+                    out[i - chunk] = w >> 1;
+                    break;
+                case Distribution::NEARLY_SORTED:
+                    // A word below 2^32 / NEARLY_SORTED_NOISE selects the noise, and scales up to its value
+                    if (w < UINT32_MAX / NEARLY_SORTED_NOISE) {
+                        out[i - chunk] = (w * NEARLY_SORTED_NOISE) >> 1;
+                        break;
+                    }
+                    [[fallthrough]];
+                case Distribution::SORTED:
+                case Distribution::REVERSE_SORTED:
+                    out[i - chunk] = (step > 0) ? rank * step + ((w * step) >> 32)
+                                                : (int) ((double) rank / n * INT_MAX);
+                    break;
+                case Distribution::SORTED_RUNS:
+                    out[i - chunk] = (i % SORTED_RUN_LENGTH) * run_step + ((w * run_step) >> 32);
+                    break;
+                case Distribution::FEW_UNIQUE:
+                    out[i - chunk] = (int) ((w * FEW_UNIQUE_VALUES) >> 32) * (INT_MAX / FEW_UNIQUE_VALUES);
+                    break;
+                case Distribution::ZIPF: {
+                    // Inverse of the CDF of the density 1/x on [1, ZIPF_RANKS + 1], rounded down to a rank
+                    double u = (w + 0.5) / 4294967296.0;
+                    long zipf_rank = (long) std::exp(u * log_ranks) - 1;
+                    out[i - chunk] = std::min<long>(std::max<long>(zipf_rank, 0), ZIPF_RANKS - 1);
+                    break;
+                }
+            }
+        }
+    }
+}
+
+void fill_random_ints(std::vector<int> &A, Distribution distribution, uint64_t seed) {
+    fill_random_ints(A.data(), 0, A.size(), A.size(), distribution, seed);
+}
+
+void fill_random_ints(std::vector<int> &A, Distribution distribution, uint64_t seed, TaskPool &pool) {
+    std::size_t n = A.size();
+    int blocks = (n + FILL_GRAIN_SIZE - 1) / FILL_GRAIN_SIZE;
+
+    pool.parallel_for(0, blocks, 1, [&](int lo, int hi) {
+        std::size_t first = lo * FILL_GRAIN_SIZE;
+        fill_random_ints(A.data() + first, first, std::min(hi * FILL_GRAIN_SIZE, n) - first, n, distribution, seed);
+    });
+}
+
+/*
+ * @brief Supporting function to build the table mapping the top 12 bits of a word to a char of English text
+ *
+ * Each char has the share of the table given by its frequency, as a count per 10000 letters, with a space for
+ * about every 5.5 chars, the average length of an English word with its space.
+ * */
+static std::array<char, 4096> text_table() {
+    static const std::pair<char, int> frequencies[] = {
+        {' ', 2200}, {'e', 1270}, {'t', 906}, {'a', 817}, {'o', 751}, {'i', 697}, {'n', 675}, {'s', 633},
+        {'h', 609}, {'r', 599}, {'d', 425}, {'l', 403}, {'c', 278}, {'u', 276}, {'m', 241}, {'w', 236},
+        {'f', 223}, {'g', 202}, {'y', 197}, {'p', 193}, {'b', 149}, {'v', 98}, {'k', 77}, {'j', 15},
+        {'x', 15}, {'q', 10}, {'z', 7}
+    };
+
+    int total = 0;
+    for (auto const &f: frequencies) {
+        total += f.second;
+    }
+
+    std::array<char, 4096> table;
+    int cumulative = 0;
+    std::size_t next = 0;
+    for (auto const &f: frequencies) {
+        cumulative += f.second;
+        std::size_t end = (std::size_t) cumulative * table.size() / total;
+        for (; next < end; next++) {
+            table[next] = f.first;
+        }
+    }
+    return table;
+}
+
+/*
+ * @brief Supporting function to fill S[lo, hi) with chars of an alphabet, at most FILL_GRAIN_SIZE chars at a time
+ * */
+static void fill_string_range(std::string &S, Alphabet alphabet, uint64_t seed, std::size_t lo, std::size_t hi) {
+    static constexpr char alphanumeric[] = "0123456789"
+                                           "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                                           "abcdefghijklmnopqrstuvwxyz";
+    static constexpr char dna[] = "ACGT";
+    static const std::array<char, 4096> text = text_table();
+
+    std::vector<uint32_t> words(std::min(hi - lo, FILL_GRAIN_SIZE));
+
+    for (std::size_t chunk = lo; chunk < hi; chunk += FILL_GRAIN_SIZE) {
+        std::size_t end = std::min(chunk + FILL_GRAIN_SIZE, hi);
+        fill_random_words(words.data(), chunk, end - chunk, seed);
+
+        for (std::size_t i = chunk; i < end; i++) {
+            uint64_t w = words[i - chunk];
+
+            switch (alphabet) {
+                case Alphabet::ALPHANUMERIC:
+                    S[i] = alphanumeric[(w * (sizeof(alphanumeric) - 1)) >> 32];
+                    break;
+                case Alphabet::DNA:
+                    S[i] = dna[w >> 30];
+                    break;
+                case Alphabet::TEXT:
+                    S[i] = text[w >> 20];
+                    break;
+            }
+        }
+    }
+}
+
+std::string generate_random_string(std::size_t length, Alphabet alphabet, uint64_t seed) {
+    std::string S(length, '\0');
+    fill_string_range(S, alphabet, seed, 0, length);
+    return S;
+}
+
+std::string generate_random_string(std::size_t length, Alphabet alphabet, uint64_t seed, TaskPool &pool) {
+    std::string S(length, '\0');
+    int blocks = (length + FILL_GRAIN_SIZE - 1) / FILL_GRAIN_SIZE;
+
+    pool.parallel_for(0, blocks, 1, [&](int lo, int hi) {
+        fill_string_range(S, alphabet, seed, lo * FILL_GRAIN_SIZE, std::min(hi * FILL_GRAIN_SIZE, length));
+    });
+    return S;
+}
@@ -0,0 +1,125 @@
+#ifndef INCLUDE_RANDGEN_HPP
+#define INCLUDE_RANDGEN_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "taskpool.hpp"
+
+// Seed of the generated inputs, unless given by --seed
+const uint64_t DEFAULT_INPUT_SEED = 42;
+
+// Number of distinct values in a few unique input
+const int FEW_UNIQUE_VALUES = 16;
+
+// Number of ranks of a Zipfian input, the most frequent of which is 0
+const int ZIPF_RANKS = 1 << 20;
+
+// One in this many elements of a nearly sorted input is replaced by a uniform random value
+const int NEARLY_SORTED_NOISE = 100;
+
+// Length of each sorted run of a sorted runs input
+const std::size_t SORTED_RUN_LENGTH = 1 << 14;
+
+// Number of elements generated by each task of a parallel fill
+const std::size_t FILL_GRAIN_SIZE = 1 << 16;
+
+// Distributions of generated integer arrays, whose values are all >= 0
+enum class Distribution {
+    UNIFORM, // uniform in [0, 2^31)
+    SORTED, // ascending, with a random gap between neighbours
+    REVERSE_SORTED, // descending, as SORTED reversed
+    FEW_UNIQUE, // uniform over FEW_UNIQUE_VALUES values spread across [0, 2^31)
+    ZIPF, // rank k (from 0) with probability close to 1 / (k + 1), over ZIPF_RANKS ranks
+    NEARLY_SORTED, // as SORTED, with about one in NEARLY_SORTED_NOISE elements replaced by a uniform value
+    SORTED_RUNS // concatenated ascending runs of SORTED_RUN_LENGTH, each spanning [0, 2^31)
+};
+
+// Alphabets of generated strings
+enum class Alphabet {
+    ALPHANUMERIC, // uniform over 0-9, A-Z and a-z
+    DNA, // uniform over A, C, G and T
+    TEXT // lowercase letters and spaces, with the letter frequencies of English text
+};
+
+/*
+ * @brief Parse the name of a distribution (uniform, sorted, reverse, fewunique, zipf, nearlysorted or runs), exiting
+ * if unknown
+ * */
+Distribution parse_distribution(std::string const &name);
+
+/*
+ * @brief Parse the name of an alphabet (alphanumeric, dna or text), exiting if unknown
+ * */
+Alphabet parse_alphabet(std::string const &name);
+
+/*
+ * @brief Derive an independent seed from a seed and a stream number, for each of several inputs from one seed
+ *
+ * @param[in]  seed  base seed
+ * @param[in]  stream  stream number
+ * @return  seed of the stream
+ * */
+uint64_t derive_seed(uint64_t seed, uint64_t stream);
+
+/*
+ * @brief Random 32-bit words of a counter-based generator (Philox4x32-10), as a function of their index
+ *
+ * Word i is the (i mod 4)th output of Philox for the counter i / 4, keyed by the seed. Each word depends only on
+ * the seed and its index, so any range can be generated on its own, which splits the fill between threads with
+ * the same output as a serial fill, and the rounds of adjacent counters are independent, so they vectorize.
+ * @param[out]  words  array of words to be filled
+ * @param[in]  first  index of words[0]
+ * @param[in]  count  number of words
+ * @param[in]  seed  seed of the generator
+ * */
+void fill_random_words(uint32_t *words, std::size_t first, std::size_t count, uint64_t seed);
+
+/*
+ * @brief Fill part of an array of ints from a distribution, with the same values as a fill of the whole array
+ *
+ * Arrays too large to be held in memory, such as the key files of an external sort, are filled one part at a time.
+ * @param[out]  A  part of the array to be filled, of count elements
+ * @param[in]  first  index in the array of A[0]
+ * @param[in]  count  number of elements to be filled
+ * @param[in]  n  size of the whole array
+ * @param[in]  distribution  distribution of the values
+ * @param[in]  seed  seed of the generator
+ * */
+void fill_random_ints(int *A, std::size_t first, std::size_t count, std::size_t n, Distribution distribution,
+                      uint64_t seed);
+
+/*
+ * @brief Fill an array of ints from a distribution
+ *
+ * The values depend only on the distribution, the seed and the size of the array.
+ * @param[out]  A  array to be filled (its size is kept)
+ * @param[in]  distribution  distribution of the values
+ * @param[in]  seed  seed of the generator
+ * */
+void fill_random_ints(std::vector<int> &A, Distribution distribution, uint64_t seed);
+
+/*
+ * @brief Fill an array of ints from a distribution, in parallel on the thread pool, with the same values as a
+ * serial fill
+ * */
+void fill_random_ints(std::vector<int> &A, Distribution distribution, uint64_t seed, TaskPool &pool);
+
+/*
+ * @brief Generate a random string over an alphabet
+ *
+ * @param[in]  length  length of the string
+ * @param[in]  alphabet  alphabet of the chars
+ * @param[in]  seed  seed of the generator
+ * @return  string of the given length
+ * */
+std::string generate_random_string(std::size_t length, Alphabet alphabet, uint64_t seed);
+
+/*
+ * @brief Generate a random string over an alphabet, in parallel on the thread pool, with the same chars as a
+ * serial generation
+ * */
+std::string generate_random_string(std::size_t length, Alphabet alphabet, uint64_t seed, TaskPool &pool);
+
+#endif //INCLUDE_RANDGEN_HPP
@@ -0,0 +1,140 @@
+#include <algorithm>
+#include "taskpool.hpp"
+
+// Pool and queue index of the current thread, if it is a pool worker
+thread_local TaskPool const *current_pool = nullptr;
+thread_local int current_index = 0;
+
+TaskGroup::TaskGroup(TaskPool &task_pool) : pool(task_pool) {}
+
+TaskGroup::~TaskGroup() {
+    wait();
+}
+
+void TaskGroup::run(std::function<void()> fn) {
+    pending.fetch_add(1, std::memory_order_relaxed);
+    pool.push(TaskPool::Task{std::move(fn), this});
+}
+
+void TaskGroup::wait() {
+    while (pending.load(std::memory_order_acquire) > 0) {
+        if (!pool.try_run_one()) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+TaskPool::TaskPool(int thread_count) {
+    int worker_count = std::max(thread_count - 1, 0);
+
+    for (int i = 0; i <= worker_count; i++) {
+        queues.push_back(std::make_unique<TaskQueue>());
+    }
+    for (int i = 1; i <= worker_count; i++) {
+        workers.emplace_back(&TaskPool::worker_loop, this, i);
+    }
+}
+
+TaskPool::~TaskPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mtx);
+        stopping = true;
+    }
+    sleep_cv.notify_all();
+
+    for (auto &worker: workers) {
+        worker.join();
+    }
+}
+
+int TaskPool::size() const {
+    return queues.size();
+}
+
+int TaskPool::queue_index() const {
+    return (current_pool == this) ? current_index : 0;
+}
+
+void TaskPool::push(Task task) {
+    TaskQueue &queue = *queues[queue_index()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mtx);
+        queue.tasks.push_back(std::move(task));
+    }
+    queued.fetch_add(1, std::memory_order_release);
+
+    // Take the sleep lock before notifying, so a worker checking the queued count cannot miss the wakeup
+    {
+        std::lock_guard<std::mutex> lock(sleep_mtx);
+    }
+    sleep_cv.notify_one();
+}
+
+bool TaskPool::try_run_one() {
+    int self = queue_index();
+    int queue_count = queues.size();
+    Task task;
+    bool found = false;
+
+    // Take the most recently pushed task from our own queue
+    {
+        TaskQueue &queue = *queues[self];
+        std::lock_guard<std::mutex> lock(queue.mtx);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            found = true;
+        }
+    }
+
+    // Otherwise steal the oldest task from the other queues in turn
+    for (int k = 1; !found && k < queue_count; k++) {
+        TaskQueue &queue = *queues[(self + k) % queue_count];
+        std::lock_guard<std::mutex> lock(queue.mtx);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            found = true;
+        }
+    }
+
+    if (!found) {
+        return false;
+    }
+
+    queued.fetch_sub(1, std::memory_order_relaxed);
+    task.fn();
+    task.group->pending.fetch_sub(1, std::memory_order_release);
+    return true;
+}
+
+void TaskPool::worker_loop(int index) {
+    current_pool = this;
+    current_index = index;
+
+    while (true) {
+        if (try_run_one()) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mtx);
+        sleep_cv.wait(lock, [this]() { return stopping || queued.load(std::memory_order_acquire) > 0; });
+        if (stopping && queued.load(std::memory_order_acquire) == 0) {
+            return;
+        }
+    }
+}
+
+void TaskPool::parallel_for(int begin, int end, int grain, std::function<void(int, int)> const &fn) {
+    if (end - begin <= std::max(grain, 1)) {
+        if (begin < end) {
+            fn(begin, end);
+        }
+        return;
+    }
+
+    // Split range in half, queueing the upper half so that it can be stolen
+    int mid = begin + (end - begin) / 2;
+    invoke([&]() { parallel_for(begin, mid, grain, fn); },
+           [&]() { parallel_for(mid, end, grain, fn); });
+}
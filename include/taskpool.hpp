@@ -0,0 +1,104 @@
+#ifndef INCLUDE_TASKPOOL_HPP
+#define INCLUDE_TASKPOOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class TaskPool;
+
+/*
+ * @brief Group of tasks submitted to a TaskPool that can be waited on together.
+ *
+ * A thread waiting on a group does not block, it keeps executing (or stealing) queued tasks until every task in
+ * the group has finished, so nested fork-join recursion cannot deadlock the pool.
+ * */
+class TaskGroup {
+public:
+    explicit TaskGroup(TaskPool &task_pool);
+
+    // Waits for any outstanding tasks before the group goes out of scope
+    ~TaskGroup();
+
+    // Queue a task on the pool, as part of this group
+    void run(std::function<void()> fn);
+
+    // Execute queued tasks until all tasks in this group have completed
+    void wait();
+
+private:
+    friend class TaskPool;
+    TaskPool &pool;
+    std::atomic<int> pending{0};
+};
+
+/*
+ * @brief Work-stealing thread pool for fork-join parallelism.
+ *
+ * Each worker owns a task deque, pushing and popping new tasks at the back (LIFO, for cache locality of nested
+ * tasks), while idle workers steal from the front of other deques (FIFO, so the largest outstanding tasks are
+ * stolen first). Threads that are not pool workers (e.g. main) share one extra deque. The calling thread takes
+ * part in the work while waiting, so a pool of thread_count threads spawns thread_count - 1 workers.
+ * */
+class TaskPool {
+public:
+    explicit TaskPool(int thread_count);
+    ~TaskPool();
+
+    TaskPool(TaskPool const &) = delete;
+    TaskPool &operator=(TaskPool const &) = delete;
+
+    // Total number of threads taking part in the work, including the calling thread
+    int size() const;
+
+    // Run f and g in parallel and return once both have completed
+    template <typename F, typename G>
+    void invoke(F &&f, G &&g) {
+        TaskGroup group(*this);
+        group.run(std::forward<G>(g));
+        f();
+        group.wait();
+    }
+
+    // Call fn(lo, hi) over disjoint subranges [lo, hi) of [begin, end), each of at most grain iterations
+    void parallel_for(int begin, int end, int grain, std::function<void(int, int)> const &fn);
+
+private:
+    friend class TaskGroup;
+
+    struct Task {
+        std::function<void()> fn;
+        TaskGroup *group;
+    };
+
+    struct TaskQueue {
+        std::mutex mtx;
+        std::deque<Task> tasks;
+    };
+
+    // Queue 0 is shared by external threads, queues 1..n belong to the worker threads
+    std::vector<std::unique_ptr<TaskQueue>> queues;
+    std::vector<std::thread> workers;
+
+    std::atomic<int> queued{0};
+    std::mutex sleep_mtx;
+    std::condition_variable sleep_cv;
+    bool stopping = false;
+
+    // Index of the queue owned by the calling thread
+    int queue_index() const;
+
+    void push(Task task);
+
+    // Pop a task from the calling thread's own queue, or else steal one; returns false if no task was found
+    bool try_run_one();
+
+    void worker_loop(int index);
+};
+
+#endif //INCLUDE_TASKPOOL_HPP
@@ -1,8 +1,21 @@
-#include <chrono>
+#include <algorithm>
+#include <climits>
+#include <cstdint>
 #include <cstdlib>
 #include <iostream>
+#include <memory>
 #include <numeric>
+#include <random>
+#include <span>
+#include <string>
 #include <vector>
+#include "../include/benchmark.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 /*
  * @brief Parse argument to extract user array size
@@ -69,6 +82,7 @@ int get_search_value(char* param) {
 /*
  * @brief Linear search implementation
  *
+ * A is passed by value, so each call copies the whole vector (see the std::span overload)
  * @param[in]  A  vector of ints to be searched
  * @param[in]  n  size of vector
  * @param[in]  x  search value to be found in A
@@ -87,10 +101,31 @@ int linear_search(std::vector<int> A, int n, int x) {
     return answer;
 }
 
+/*
+ * @brief Linear search implementation, over a non-owning view
+ *
+ * @param[in]  A  view of ints to be searched
+ * @param[in]  x  search value to be found in A
+ * @return  answer  (last) index of A for which x found; -1 for not found
+ * */
+int linear_search(std::span<const int> A, int x) {
+    // default return value of not found (-1)
+    int answer = {-1};
+
+    for(int i=0; i<(int)A.size(); i++) {
+        if (A[i] == x) {
+            answer = i;
+        }
+    }
+
+    return answer;
+}
+
 /*
  * @brief Better linear search implementation
  *
- * As for linear search, but return early if search value found
+ * As for linear search, but return early if search value found. A is passed by value, so each call copies the
+ * whole vector (see the std::span overload)
  * @param[in]  A  vector of ints to be searched
  * @param[in]  n  size of vector
  * @param[in]  x  search value to be found in A
@@ -107,13 +142,244 @@ int better_linear_search(std::vector<int> A, int n, int x) {
     return -1;
 }
 
+/*
+ * @brief Better linear search implementation, over a non-owning view
+ *
+ * As for linear search, but return early if search value found
+ * @param[in]  A  view of ints to be searched
+ * @param[in]  x  search value to be found in A
+ * @return  answer  index of A for which x found; -1 for not found
+ * */
+int better_linear_search(std::span<const int> A, int x) {
+    for(int i=0; i<(int)A.size(); i++) {
+        if (A[i] == x) {
+            return i;
+        }
+    }
+
+    // x not found
+    return -1;
+}
+
+/*
+ * @brief Supporting function for SIMD linear search, to find the first match in the block A[i..i+count-1]
+ *
+ * @param[in]  A  view of ints to be searched
+ * @param[in]  i  start index of block
+ * @param[in]  count  size of block
+ * @param[in]  x  search value to be found in A
+ * @return  index of A for which x found; -1 for not found
+ * */
+int scalar_block_search(std::span<const int> A, int i, int count, int x) {
+    for (int j = i; j < i + count; j++) {
+        if (A[j] == x) {
+            return j;
+        }
+    }
+    return -1;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+/*
+ * @brief AVX2 linear search implementation
+ *
+ * Compare 32 ints per iteration against the broadcast search value, as four 8 lane vectors whose comparison masks
+ * are OR'd together, so that the loop only needs one movemask test (and branch) per iteration. Once a match is
+ * found, the block is searched again to find the first matching index.
+ * @param[in]  A  view of ints to be searched
+ * @param[in]  x  search value to be found in A
+ * @return  index of A for which x found; -1 for not found
+ * */
+__attribute__((target("avx2")))
+int avx2_linear_search(std::span<const int> A, int x) {
+    int n = A.size();
+    int const *data = A.data();
+    __m256i key = _mm256_set1_epi32(x);
+    int i = 0;
+
+    for (; i + 32 <= n; i += 32) {
+        __m256i eq0 = _mm256_cmpeq_epi32(_mm256_loadu_si256((__m256i const *)(data + i)), key);
+        __m256i eq1 = _mm256_cmpeq_epi32(_mm256_loadu_si256((__m256i const *)(data + i + 8)), key);
+        __m256i eq2 = _mm256_cmpeq_epi32(_mm256_loadu_si256((__m256i const *)(data + i + 16)), key);
+        __m256i eq3 = _mm256_cmpeq_epi32(_mm256_loadu_si256((__m256i const *)(data + i + 24)), key);
+        __m256i any = _mm256_or_si256(_mm256_or_si256(eq0, eq1), _mm256_or_si256(eq2, eq3));
+
+        if (!_mm256_testz_si256(any, any)) {
+            // Lane masks of each vector, combined into a 32 bit mask of the block
+            unsigned mask = (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(eq0)) |
+                            ((unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(eq1)) << 8) |
+                            ((unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(eq2)) << 16) |
+                            ((unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(eq3)) << 24);
+            return i + __builtin_ctz(mask);
+        }
+    }
+
+    // Search the remaining tail
+    return scalar_block_search(A, i, n - i, x);
+}
+#endif
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+/*
+ * @brief NEON linear search implementation
+ *
+ * As for the AVX2 version, but comparing 16 ints per iteration as four 4 lane vectors.
+ * @param[in]  A  view of ints to be searched
+ * @param[in]  x  search value to be found in A
+ * @return  index of A for which x found; -1 for not found
+ * */
+int neon_linear_search(std::span<const int> A, int x) {
+    int n = A.size();
+    int const *data = A.data();
+    int32x4_t key = vdupq_n_s32(x);
+    int i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        uint32x4_t eq0 = vceqq_s32(vld1q_s32(data + i), key);
+        uint32x4_t eq1 = vceqq_s32(vld1q_s32(data + i + 4), key);
+        uint32x4_t eq2 = vceqq_s32(vld1q_s32(data + i + 8), key);
+        uint32x4_t eq3 = vceqq_s32(vld1q_s32(data + i + 12), key);
+        uint32x4_t any = vorrq_u32(vorrq_u32(eq0, eq1), vorrq_u32(eq2, eq3));
+
+        if (vmaxvq_u32(any) != 0) {
+            return scalar_block_search(A, i, 16, x);
+        }
+    }
+
+    // Search the remaining tail
+    return scalar_block_search(A, i, n - i, x);
+}
+#endif
+
+/*
+ * @brief SIMD linear search implementation
+ *
+ * As for better linear search, returning the first index of x, but comparing many ints per iteration using the
+ * widest vector instructions available (AVX2 if the CPU supports it, or NEON), else falling back to better
+ * linear search.
+ * @param[in]  A  view of ints to be searched
+ * @param[in]  x  search value to be found in A
+ * @return  index of A for which x found; -1 for not found
+ * */
+int simd_linear_search(std::span<const int> A, int x) {
+#if defined(__x86_64__) || defined(__i386__)
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    if (has_avx2) {
+        return avx2_linear_search(A, x);
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    return neon_linear_search(A, x);
+#endif
+    return better_linear_search(A, x);
+}
+
+/*
+ * @brief Scalar batched linear search implementation
+ *
+ * @param[in]  A  view of ints to be searched
+ * @param[in]  keys  view of search values to be found in A
+ * @param[out]  results  index of A for which each key is first found; -1 for not found
+ * */
+void scalar_batch_linear_search(std::span<const int> A, std::span<const int> keys, std::span<int> results) {
+    // Indices of the keys not found yet
+    std::vector<int> remaining(keys.size());
+    std::iota(remaining.begin(), remaining.end(), 0);
+    std::fill(results.begin(), results.end(), -1);
+
+    for (int i = 0; i < (int)A.size() && !remaining.empty(); i++) {
+        for (int r = 0; r < (int)remaining.size(); r++) {
+            if (A[i] == keys[remaining[r]]) {
+                results[remaining[r]] = i;
+                remaining[r--] = remaining.back();
+                remaining.pop_back();
+            }
+        }
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+/*
+ * @brief AVX2 batched linear search implementation
+ *
+ * Each block of 32 ints is loaded once and compared against every key not found yet. Found keys are removed from
+ * the remaining set, and the scan stops early once every key has been found.
+ * @param[in]  A  view of ints to be searched
+ * @param[in]  keys  view of search values to be found in A
+ * @param[out]  results  index of A for which each key is first found; -1 for not found
+ * */
+__attribute__((target("avx2")))
+void avx2_batch_linear_search(std::span<const int> A, std::span<const int> keys, std::span<int> results) {
+    int n = A.size();
+    int const *data = A.data();
+
+    // Indices of the keys not found yet
+    std::vector<int> remaining(keys.size());
+    std::iota(remaining.begin(), remaining.end(), 0);
+    std::fill(results.begin(), results.end(), -1);
+
+    int i = 0;
+    for (; i + 32 <= n && !remaining.empty(); i += 32) {
+        __m256i v0 = _mm256_loadu_si256((__m256i const *)(data + i));
+        __m256i v1 = _mm256_loadu_si256((__m256i const *)(data + i + 8));
+        __m256i v2 = _mm256_loadu_si256((__m256i const *)(data + i + 16));
+        __m256i v3 = _mm256_loadu_si256((__m256i const *)(data + i + 24));
+
+        for (int r = 0; r < (int)remaining.size(); r++) {
+            __m256i key = _mm256_set1_epi32(keys[remaining[r]]);
+            __m256i eq0 = _mm256_cmpeq_epi32(v0, key);
+            __m256i eq1 = _mm256_cmpeq_epi32(v1, key);
+            __m256i eq2 = _mm256_cmpeq_epi32(v2, key);
+            __m256i eq3 = _mm256_cmpeq_epi32(v3, key);
+            __m256i any = _mm256_or_si256(_mm256_or_si256(eq0, eq1), _mm256_or_si256(eq2, eq3));
+
+            if (!_mm256_testz_si256(any, any)) {
+                unsigned mask = (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(eq0)) |
+                                ((unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(eq1)) << 8) |
+                                ((unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(eq2)) << 16) |
+                                ((unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(eq3)) << 24);
+                results[remaining[r]] = i + __builtin_ctz(mask);
+                remaining[r--] = remaining.back();
+                remaining.pop_back();
+            }
+        }
+    }
+
+    // Search the remaining tail for the keys not found yet
+    for (int r = 0; r < (int)remaining.size(); r++) {
+        results[remaining[r]] = scalar_block_search(A, i, n - i, keys[remaining[r]]);
+    }
+}
+#endif
+
+/*
+ * @brief Batched linear search implementation
+ *
+ * Find the first index of each of K keys in a single pass over A, rather than K separate passes, which pays off
+ * when many lookups are made against the same unsorted array. Uses AVX2 if the CPU supports it, else a scalar
+ * version of the same single pass.
+ * @param[in]  A  view of ints to be searched
+ * @param[in]  keys  view of search values to be found in A
+ * @param[out]  results  index of A for which each key is first found; -1 for not found (same size as keys)
+ * */
+void batch_linear_search(std::span<const int> A, std::span<const int> keys, std::span<int> results) {
+#if defined(__x86_64__) || defined(__i386__)
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    if (has_avx2) {
+        avx2_batch_linear_search(A, keys, results);
+        return;
+    }
+#endif
+    scalar_batch_linear_search(A, keys, results);
+}
+
 /*
  * @brief Sentinel linear search implementation
  *
  * Insert the search value into the last index of the vector, in
  * order to avoid the need for loop bounds checking (as the last
  * element is guaranteed to contain the search term if not found
- * earlier.
+ * earlier. A is passed by value, so each call copies the whole
+ * vector (see the std::span overload)
  * @param[in]  A  vector of ints to be searched
  * @param[in]  n  size of vector
  * @param[in]  x  search value to be found in A
@@ -137,11 +403,41 @@ int sentinel_linear_search(std::vector<int> A, int n, int x) {
     return -1;
 }
 
+/*
+ * @brief Sentinel linear search implementation, over a mutable non-owning view
+ *
+ * As for sentinel linear search, but the sentinel is written into the caller's array itself, so the view must be
+ * mutable. The last element is restored before returning, so A is unchanged once the search completes, but it must
+ * not be read concurrently by other threads.
+ * @param[in,out]  A  mutable view of ints to be searched
+ * @param[in]  x  search value to be found in A
+ * @return  (index)  index of A for which x found; -1 for not found
+ * */
+int sentinel_linear_search(std::span<int> A, int x) {
+    int n = A.size();
+    int last = A[n-1];
+    A[n-1] = x;
+
+    int i = {0};
+    while (A[i] != x) {i++;}
+
+    // restore last element of A
+    A[n-1] = last;
+
+    if ((i < n-1) || A[n-1] == x) {
+        return i;
+    }
+
+    // x not found
+    return -1;
+}
+
 /*
  * @brief Recursive linear search implementation
  *
  * A recursive version of better linear search, where we return
- * early if search value found
+ * early if search value found. A is passed by value to the first
+ * call, so each search copies the whole vector (see the std::span overload)
  * @param[in]  A  vector of ints to be searched
  * @param[in]  n  size of vector
  * @param[in]  i  current search index
@@ -164,8 +460,34 @@ int recursive_linear_search(std::vector<int> A, int n, int i, int x) {
 }
 
 /*
- * @brief Recursive binary search implementation
+ * @brief Recursive linear search implementation, over a non-owning view
+ *
+ * A recursive version of better linear search, where we return
+ * early if search value found
+ * @param[in]  A  view of ints to be searched
+ * @param[in]  i  current search index
+ * @param[in]  x  search value to be found in A
+ * @return  (index)  index of A for which x found; -1 for not found
+ * */
+int recursive_linear_search(std::span<const int> A, int i, int x) {
+    // Base recursive case
+    if (i > (int)A.size()-1) {
+        return -1;
+    }
+
+    // Return index if x found
+    if (A[i] == x) {
+        return i;
+    }
+
+    // Advance search index by 1
+    return recursive_linear_search(A, i+1, x);
+}
+
+/*
+ * @brief Binary search implementation
  *
+ * A is passed by value, so each call copies the whole vector (see the std::span overload)
  * @param[in]  A  vector of ints to be searched (must be sorted in advance)
  * @param[in]  n  size of vector
  * @param[in]  x  search value to be found in A
@@ -196,9 +518,42 @@ int binary_search(std::vector<int> A, int n, int x) {
     return -1;
 }
 
+/*
+ * @brief Binary search implementation, over a non-owning view
+ *
+ * @param[in]  A  view of ints to be searched (must be sorted in advance)
+ * @param[in]  x  search value to be found in A
+ * @return  (index)  index of A for which x found; -1 for not found
+ * */
+int binary_search(std::span<const int> A, int x) {
+    // Set initial search index bounds to array bounds
+    int p = 0;
+    int r = A.size() - 1;
+
+    while (p <= r) {
+        // Calculate midpoint of index range [p..r]
+        int q = (p + r) / 2;
+
+        // Return index if x found
+        if (A[q] == x) {
+            return q;
+        }
+
+        // If element at index q is > x, then set search index bounds to lower half else higher half
+        if (A[q] > x) {
+            r = q - 1;
+        } else {
+            p = q + 1;
+        }
+    }
+    // x not found
+    return -1;
+}
+
 /*
  * @brief Recursive binary search implementation
  *
+ * A is passed by value to the first call, so each search copies the whole vector (see the std::span overload)
  * @param[in]  A  vector of ints to be searched (must be sorted in advance)
  * @param[in]  p  lower index search bound (inclusive)
  * @param[in]  r  upper index search bound (inclusive)
@@ -227,92 +582,559 @@ int recursive_binary_search(std::vector<int> A, int p, int r, int x) {
     }
 }
 
-int main(int argc, char* argv[]) {
-    // Check correct usage (e.g. 'search 100000 50000')
-    if (argc != 3) {
-        std::cerr << "Usage: " << argv[0] << " [array_size] [search_value]" << std::endl;
-        exit(EXIT_FAILURE);
+/*
+ * @brief Recursive binary search implementation, over a non-owning view
+ *
+ * @param[in]  A  view of ints to be searched (must be sorted in advance)
+ * @param[in]  p  lower index search bound (inclusive)
+ * @param[in]  r  upper index search bound (inclusive)
+ * @param[in]  x  search value to be found in A
+ * @return  (index)  index of A for which x found; -1 for not found
+ * */
+int recursive_binary_search(std::span<const int> A, int p, int r, int x) {
+    // Base recursive case
+    if (p > r) {
+        return -1;
     }
 
-    std::chrono::time_point<std::chrono::steady_clock> t1, t2;
-    long dt;
-    int dummy_val = 0; // Use for accumulation to prevent compiler optimising away ops
-    int repeats = 10e4;
+    // Calculate midpoint of index range [p..r]
+    int q = (p + r) / 2;
 
-    int array_size = get_array_size(argv[1]);
-    int search_value = get_search_value(argv[2]);
+    // Return index if x found
+    if (A[q] == x) {
+        return q;
+    }
 
-    // Create a vector with sequential integers with random start
-    std::vector<int> arr(array_size);
-    std::iota(arr.begin(), arr.end(), 0);
+    // If element at index q is > x, then recurse to lower half else higher half
+    if (A[q] > x) {
+        return recursive_binary_search(A, p, q-1, x);
+    } else {
+        return recursive_binary_search(A, q+1, r, x);
+    }
+}
+
+/*
+ * @brief Branchless binary search implementation
+ *
+ * A lower bound search that halves the range on every step without an early exit on equality, so the loop runs a
+ * fixed log2(n) steps for every x, and each step is a conditional move rather than a data dependent branch the CPU
+ * would mispredict half of the time. Only the final step checks for a match.
+ * @param[in]  A  view of ints to be searched (must be sorted in advance)
+ * @param[in]  x  search value to be found in A
+ * @return  (index)  index of A for which x found; -1 for not found
+ * */
+int branchless_binary_search(std::span<const int> A, int x) {
+    int n = A.size();
+    if (n == 0) {
+        return -1;
+    }
+
+    // Invariant: the lower bound of x is in base[0..n]
+    int const *base = A.data();
+    while (n > 1) {
+        int half = n / 2;
+        base += (base[half - 1] < x) ? half : 0;
+        n -= half;
+    }
+    base += (*base < x);
+
+    int i = base - A.data();
+    if (i < (int)A.size() && A[i] == x) {
+        return i;
+    }
+    return -1;
+}
+
+// Number of queries walked in lockstep by batch_binary_search
+const int BINARY_SEARCH_LANES = 16;
+
+/*
+ * @brief Batched branchless binary search implementation
+ *
+ * Search for a batch of queries, walking BINARY_SEARCH_LANES independent branchless searches in lockstep. The
+ * range halves by the same amount for every query, so each step issues one probe per lane with no dependency
+ * between lanes, and the CPU overlaps the latency of their cache misses rather than waiting on each in turn. The
+ * next probe of each lane is also prefetched as soon as its address is known.
+ * @param[in]  A  view of ints to be searched (must be sorted in advance)
+ * @param[in]  queries  view of search values to be found in A
+ * @param[out]  results  index of A for which each query found; -1 for not found (same size as queries)
+ * */
+void batch_binary_search(std::span<const int> A, std::span<const int> queries, std::span<int> results) {
+    int size = A.size();
+    int query_count = queries.size();
+    int const *base[BINARY_SEARCH_LANES];
+
+    for (int first = 0; first < query_count; first += BINARY_SEARCH_LANES) {
+        int lanes = std::min(BINARY_SEARCH_LANES, query_count - first);
+        int const *x = queries.data() + first;
+        int n = size;
+
+        if (n == 0) {
+            std::fill(results.begin() + first, results.begin() + first + lanes, -1);
+            continue;
+        }
+
+        for (int l = 0; l < lanes; l++) {
+            base[l] = A.data();
+        }
+
+        while (n > 1) {
+            int half = n / 2;
+            int next_half = (n - half) / 2;
+            for (int l = 0; l < lanes; l++) {
+                base[l] += (base[l][half - 1] < x[l]) ? half : 0;
+                __builtin_prefetch(base[l] + next_half - 1);
+            }
+            n -= half;
+        }
+
+        for (int l = 0; l < lanes; l++) {
+            int i = (base[l] - A.data()) + (*base[l] < x[l]);
+            results[first + l] = (i < size && A[i] == x[l]) ? i : -1;
+        }
+    }
+}
+
+/*
+ * @brief Search index over a sorted array, re-laid out in Eytzinger (BFS) order
+ *
+ * The sorted keys are stored in the order of a breadth first traversal of the implicit binary search tree, with
+ * the children of node k at 2k and 2k+1. The nodes that binary search probes first are then packed together at
+ * the start of the array, so the top levels of every search stay in cache. Searches also prefetch the cache line
+ * holding the node's 16 great-great-grandchildren, four levels ahead, hiding most of the latency of the misses
+ * further down. Example for the sorted array {0, 1, 2, 3, 4, 5, 6}:
+ *
+ *   keys = {-, 3, 1, 5, 0, 2, 4, 6}
+ *
+ *            3
+ *        1       5
+ *      0   2   4   6
+ * */
+struct EytzingerIndex {
+    int size;
+    std::vector<int> storage;   // Keys in Eytzinger order, from index offset + 1, with the root cache line aligned
+    std::vector<int> positions; // Index in the original sorted array of each node
+    int offset;
+
+    // Constructor copies the sorted array into Eytzinger order (a one-time O(n) build step).
+    EytzingerIndex(std::span<const int> sorted);
+
+    // offset depends on the alignment of the buffer of storage, which a copy would not keep, so the index may be
+    // moved (which keeps the buffer) but not copied.
+    EytzingerIndex(EytzingerIndex const &) = delete;
+    EytzingerIndex &operator=(EytzingerIndex const &) = delete;
+    EytzingerIndex(EytzingerIndex &&) = default;
+    EytzingerIndex &operator=(EytzingerIndex &&) = default;
+
+    // Search index for x, returning its index in the original sorted array; -1 for not found.
+    int search(int x) const;
+
+private:
+    // Recursively fill node k of the Eytzinger layout with sorted[next..], by in-order traversal
+    void build(std::span<const int> sorted, int &next, int k);
+};
+
+EytzingerIndex::EytzingerIndex(std::span<const int> sorted) {
+    size = sorted.size();
+
+    // Align keys[16] (the first node four levels down) to a 64 byte cache line, so that every prefetched group of
+    // 16 descendants keys[16k..16k+15] sits in a single cache line
+    storage = std::vector<int>(size + 1 + 32);
+    offset = 16 - (((reinterpret_cast<std::uintptr_t>(storage.data()) / sizeof(int)) + 16) % 16);
+    positions = std::vector<int>(size + 1);
+
+    int next = 0;
+    build(sorted, next, 1);
+}
+
+void EytzingerIndex::build(std::span<const int> sorted, int &next, int k) {
+    if (k > size) return;
+
+    build(sorted, next, 2 * k);
+    storage[offset + k] = sorted[next];
+    positions[k] = next++;
+    build(sorted, next, 2 * k + 1);
+}
+
+int EytzingerIndex::search(int x) const {
+    int const *keys = storage.data() + offset;
+    int k = 1;
+
+    // Descend to the left child if x <= key else the right child, without an early exit, until falling off the
+    // tree; the branch is data dependent but resolved by a conditional move
+    while (k <= size) {
+        __builtin_prefetch(keys + 16 * k);
+        k = 2 * k + (keys[k] < x);
+    }
+
+    // The last left turn was at the lower bound of x, so strip the trailing right turns (1 bits) and that left turn
+    k >>= __builtin_ffs(~k);
+
+    if (k == 0 || keys[k] != x) {
+        return -1;
+    }
+    return positions[k];
+}
+
+/*
+ * @brief Search index over a sorted array, re-laid out as a static B-tree (S-tree) of cache line sized nodes
+ *
+ * Each node holds 16 sorted keys (one 64 byte cache line) and has 17 implicit children, with the children of node
+ * k at k * 17 + 1 .. k * 17 + 17, so a search costs one cache miss per level, or log17(n) misses compared to log2(n)
+ * for binary search. The rank of x within a node is found with two 8 lane AVX2 comparisons and a popcount, when
+ * the CPU supports AVX2.
+ * */
+struct STreeIndex {
+    static const int B = 16; // keys per node
+
+    int size;
+    int node_count;
+    std::vector<int> storage;   // Node keys, padded with INT_MAX, with node 0 cache line aligned from offset
+    std::vector<int> positions; // Index in the original sorted array of each key
+    int offset;
+    bool use_avx2;
+
+    // Constructor copies the sorted array into S-tree order (a one-time O(n) build step).
+    STreeIndex(std::span<const int> sorted);
+
+    // offset depends on the alignment of the buffer of storage, which a copy would not keep, so the index may be
+    // moved (which keeps the buffer) but not copied.
+    STreeIndex(STreeIndex const &) = delete;
+    STreeIndex &operator=(STreeIndex const &) = delete;
+    STreeIndex(STreeIndex &&) = default;
+    STreeIndex &operator=(STreeIndex &&) = default;
+
+    // Search index for x, returning its index in the original sorted array; -1 for not found.
+    int search(int x) const;
+
+private:
+    // Recursively fill node k of the S-tree with sorted[next..], by in-order traversal
+    void build(std::span<const int> sorted, int &next, int k);
+
+    // Number of keys in node k that are < x
+    int rank(int const *node, int x) const;
+    int rank_avx2(int const *node, int x) const;
+};
+
+STreeIndex::STreeIndex(std::span<const int> sorted) {
+    size = sorted.size();
+    node_count = (size + B - 1) / B;
+
+    storage = std::vector<int>(node_count * B + 16);
+    offset = (16 - (reinterpret_cast<std::uintptr_t>(storage.data()) / sizeof(int)) % 16) % 16;
+    positions = std::vector<int>(node_count * B, -1);
+
+    int next = 0;
+    build(sorted, next, 0);
+
+#if defined(__x86_64__) || defined(__i386__)
+    use_avx2 = __builtin_cpu_supports("avx2");
+#else
+    use_avx2 = false;
+#endif
+}
+
+void STreeIndex::build(std::span<const int> sorted, int &next, int k) {
+    if (k >= node_count) return;
+
+    for (int i = 0; i < B; i++) {
+        build(sorted, next, k * (B + 1) + i + 1);
+        if (next < size) {
+            storage[offset + k * B + i] = sorted[next];
+            positions[k * B + i] = next++;
+        } else {
+            storage[offset + k * B + i] = INT_MAX;
+        }
+    }
+    build(sorted, next, k * (B + 1) + B + 1);
+}
 
-    // Linear search
-    t1 = std::chrono::steady_clock::now();
-    for (int i=0; i<repeats; i++) {
-        dummy_val += linear_search(arr, array_size, search_value);
+int STreeIndex::rank(int const *node, int x) const {
+#if defined(__x86_64__) || defined(__i386__)
+    if (use_avx2) {
+        return rank_avx2(node, x);
+    }
+#endif
+    int i = 0;
+    while (i < B && node[i] < x) {
+        i++;
     }
-    t2 = std::chrono::steady_clock::now();
+    return i;
+}
 
-    dt = std::chrono::duration_cast<std::chrono::microseconds>(t2-t1).count();
-    std::cout << "Linear search: " << ((float)dt / (10e5 * repeats)) << " s (average per op)" <<std::endl;
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2")))
+int STreeIndex::rank_avx2(int const *node, int x) const {
+    __m256i key = _mm256_set1_epi32(x);
+    __m256i lt0 = _mm256_cmpgt_epi32(key, _mm256_load_si256((__m256i const *)node));
+    __m256i lt1 = _mm256_cmpgt_epi32(key, _mm256_load_si256((__m256i const *)(node + 8)));
+    unsigned mask = (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(lt0)) |
+                    ((unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(lt1)) << 8);
+    return __builtin_popcount(mask);
+}
+#else
+int STreeIndex::rank_avx2(int const *node, int x) const {
+    return rank(node, x);
+}
+#endif
 
+int STreeIndex::search(int x) const {
+    int const *keys = storage.data() + offset;
+    int k = 0;
+    int best = -1; // Flat index of the smallest key >= x seen so far
 
-    // Better linear search
-    t1 = std::chrono::steady_clock::now();
-    for (int i=0; i<repeats; i++) {
-        dummy_val += better_linear_search(arr, array_size, search_value);
+    while (k < node_count) {
+        int i = rank(keys + k * B, x);
+        if (i < B) {
+            best = k * B + i;
+        }
+        k = k * (B + 1) + i + 1;
     }
-    t2 = std::chrono::steady_clock::now();
 
-    dt = std::chrono::duration_cast<std::chrono::microseconds>(t2-t1).count();
-    std::cout << "Better linear search: " << ((float)dt / (10e5 * repeats)) << " s (average per op)" <<std::endl;
+    if (best < 0 || keys[best] != x) {
+        return -1;
+    }
+    return positions[best];
+}
+
+// Number of timed samples of each search, unless given by --samples
+const int SEARCH_SAMPLES = 10;
+
+// Number of searches in each timed sample of the fixed search value
+const int FIXED_QUERY_OPS = 10000;
+
+// Number of random queries in each timed sample of the search index sweep
+const int RANDOM_QUERY_COUNT = 100000;
+
+/*
+ * @brief Benchmark each search of the fixed search value, on an array of sequential integers
+ *
+ * @param[in]  bench  benchmark harness
+ * @param[in]  array_size  size of the array
+ * @param[in]  search_value  value to be found
+ * */
+void run_fixed_searches(Benchmark &bench, int array_size, int search_value) {
+    int batch_size = 16; // Number of keys per batched search
+
+    // Create a vector with sequential integers
+    std::vector<int> arr(array_size);
+    std::iota(arr.begin(), arr.end(), 0);
+
+    // Non-owning views of the array, for the std::span searches
+    std::span<const int> view(arr);
+    std::span<int> mutable_view(arr);
 
+    // Each sample repeats the same search, with the search value hidden from the compiler, so no call is hoisted
+    auto repeat = [&](auto search) {
+        return [&, search]() {
+            for (int i=0; i<FIXED_QUERY_OPS; i++) {
+                int x = search_value;
+                do_not_optimize(x);
+                do_not_optimize(search(x));
+            }
+        };
+    };
 
-    // Sentinel search
-    t1 = std::chrono::steady_clock::now();
-    for (int i=0; i<repeats; i++) {
-        dummy_val += sentinel_linear_search(arr, array_size, search_value);
+    bench.set_ops(FIXED_QUERY_OPS);
+    bench.set_counter_unit("search", 1);
+
+    bench.run("Linear search (by value)", array_size,
+              repeat([&](int x) { return linear_search(arr, array_size, x); }));
+    bench.run("Linear search (span)", array_size, repeat([&](int x) { return linear_search(view, x); }));
+
+    bench.run("Better linear search (by value)", array_size,
+              repeat([&](int x) { return better_linear_search(arr, array_size, x); }));
+    bench.run("Better linear search (span)", array_size,
+              repeat([&](int x) { return better_linear_search(view, x); }));
+
+    bench.run("SIMD linear search (span)", array_size, repeat([&](int x) { return simd_linear_search(view, x); }));
+
+    // Batched linear search (span), for keys following on from the search value, timed per key
+    std::vector<int> keys(batch_size);
+    std::vector<int> results(batch_size);
+    std::iota(keys.begin(), keys.end(), search_value);
+
+    bench.set_ops((long long) FIXED_QUERY_OPS * batch_size);
+    bench.run("Batched linear search (span, " + std::to_string(batch_size) + " keys)", array_size, [&]() {
+        for (int i=0; i<FIXED_QUERY_OPS; i++) {
+            do_not_optimize(keys);
+            batch_linear_search(view, keys, results);
+            do_not_optimize(results[i % batch_size]);
+        }
+    });
+    bench.set_ops(FIXED_QUERY_OPS);
+
+    bench.run("Sentinel linear search (by value)", array_size,
+              repeat([&](int x) { return sentinel_linear_search(arr, array_size, x); }));
+    bench.run("Sentinel linear search (span)", array_size,
+              repeat([&](int x) { return sentinel_linear_search(mutable_view, x); }));
+
+    bench.run("Recursive linear search (by value)", array_size,
+              repeat([&](int x) { return recursive_linear_search(arr, array_size, 0, x); }));
+    bench.run("Recursive linear search (span)", array_size,
+              repeat([&](int x) { return recursive_linear_search(view, 0, x); }));
+
+    bench.run("Binary search (by value)", array_size,
+              repeat([&](int x) { return binary_search(arr, array_size, x); }));
+    bench.run("Binary search (span)", array_size, repeat([&](int x) { return binary_search(view, x); }));
+    bench.run("Branchless binary search (span)", array_size,
+              repeat([&](int x) { return branchless_binary_search(view, x); }));
+
+    bench.run("Recursive binary search (by value)", array_size,
+              repeat([&](int x) { return recursive_binary_search(arr, 0, array_size-1, x); }));
+    bench.run("Recursive binary search (span)", array_size,
+              repeat([&](int x) { return recursive_binary_search(view, 0, array_size-1, x); }));
+
+    bench.set_ops(1);
+    bench.set_counter_unit("op", 1);
+}
+
+/*
+ * @brief Benchmark the searches and search indexes on a sorted array of even integers, with random queries
+ *
+ * Half of the queries are found, and the queries are random as repeating the same query would keep every probe in
+ * cache. Each search is checked against binary search.
+ * @param[in]  bench  benchmark harness
+ * @param[in]  sweep_size  size of the array
+ * */
+void run_random_searches(Benchmark &bench, int sweep_size) {
+    std::vector<int> queries(RANDOM_QUERY_COUNT);
+    std::vector<int> expected(RANDOM_QUERY_COUNT);
+    std::vector<int> batch_results(RANDOM_QUERY_COUNT);
+
+    std::vector<int> sorted_arr(sweep_size);
+    for (int i=0; i<sweep_size; i++) {
+        sorted_arr[i] = 2 * i;
+    }
+    std::span<const int> sorted_view(sorted_arr);
+
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<int> distribution(0, 2 * sweep_size - 1);
+    for (auto &q: queries) {
+        q = distribution(generator);
     }
-    t2 = std::chrono::steady_clock::now();
+    for (int i=0; i<RANDOM_QUERY_COUNT; i++) {
+        expected[i] = binary_search(sorted_view, queries[i]);
+    }
+
+    std::string n = "n = " + std::to_string(sweep_size);
 
-    dt = std::chrono::duration_cast<std::chrono::microseconds>(t2-t1).count();
-    std::cout << "Sentinel linear search: " << ((float)dt / (10e5 * repeats)) << " s (average per op)" <<std::endl;
+    // Check a search gives the same answers as binary search
+    auto check_search = [&](std::string const &name, auto search) {
+        return [&, name, search]() {
+            for (int i=0; i<RANDOM_QUERY_COUNT; i++) {
+                if (search(queries[i]) != expected[i]) {
+                    std::cerr << name << " failure!" << std::endl;
+                    exit(EXIT_FAILURE);
+                }
+            }
+        };
+    };
 
+    auto repeat = [&](auto search) {
+        return [&, search]() {
+            for (int i=0; i<RANDOM_QUERY_COUNT; i++) {
+                do_not_optimize(search(queries[i]));
+            }
+        };
+    };
 
-    // Recursive linear search
-    t1 = std::chrono::steady_clock::now();
-    for (int i=0; i<repeats; i++) {
-        dummy_val += recursive_linear_search(arr,array_size,0,search_value);
+    bench.set_ops(RANDOM_QUERY_COUNT);
+    bench.set_counter_unit("query", 1);
+
+    bench.run("Binary search (" + n + ", random queries)", sweep_size, []() {}, [&]() {
+        for (int i=0; i<RANDOM_QUERY_COUNT; i++) {
+            batch_results[i] = binary_search(sorted_view, queries[i]);
+        }
+    }, [&]() {
+        if (batch_results != expected) {
+            std::cerr << "Binary search failure!" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    });
+
+    auto branchless = [&](int x) { return branchless_binary_search(sorted_view, x); };
+    bench.run("Branchless binary search (" + n + ", random queries)", sweep_size, []() {}, repeat(branchless),
+              check_search("Branchless binary search", branchless));
+
+    bench.run("Batched binary search (" + n + ", random queries, " + std::to_string(BINARY_SEARCH_LANES) + " lanes)",
+              sweep_size, []() {}, [&]() { batch_binary_search(sorted_view, queries, batch_results); }, [&]() {
+        if (batch_results != expected) {
+            std::cerr << "Batched binary search failure!" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    });
+
+    // Each index is built once per sample, and once more if the build is skipped by the filter
+    std::unique_ptr<EytzingerIndex> eytzinger_index;
+    bench.set_ops(1);
+    bench.set_counter_unit("element", sweep_size);
+    bench.run("Eytzinger build (" + n + ")", sweep_size, [&]() { eytzinger_index.reset(); },
+              [&]() { eytzinger_index = std::make_unique<EytzingerIndex>(sorted_view); });
+    if (!eytzinger_index) {
+        eytzinger_index = std::make_unique<EytzingerIndex>(sorted_view);
     }
-    t2 = std::chrono::steady_clock::now();
 
-    dt = std::chrono::duration_cast<std::chrono::microseconds>(t2-t1).count();
-    std::cout << "Recursive linear search: " << ((float)dt / (10e5 * repeats)) << " s (average per op)" <<std::endl;
+    auto eytzinger = [&](int x) { return eytzinger_index->search(x); };
+    bench.set_ops(RANDOM_QUERY_COUNT);
+    bench.set_counter_unit("query", 1);
+    bench.run("Eytzinger search (" + n + ", random queries)", sweep_size, []() {}, repeat(eytzinger),
+              check_search("Eytzinger search", eytzinger));
+
+    std::unique_ptr<STreeIndex> stree_index;
+    bench.set_ops(1);
+    bench.set_counter_unit("element", sweep_size);
+    bench.run("S-tree build (" + n + ")", sweep_size, [&]() { stree_index.reset(); },
+              [&]() { stree_index = std::make_unique<STreeIndex>(sorted_view); });
+    if (!stree_index) {
+        stree_index = std::make_unique<STreeIndex>(sorted_view);
+    }
 
+    auto stree = [&](int x) { return stree_index->search(x); };
+    bench.set_ops(RANDOM_QUERY_COUNT);
+    bench.set_counter_unit("query", 1);
+    bench.run("S-tree search (" + n + ", random queries)", sweep_size, []() {}, repeat(stree),
+              check_search("S-tree search", stree));
+
+    bench.set_ops(1);
+    bench.set_counter_unit("op", 1);
+}
 
-    // Binary search
-    t1 = std::chrono::steady_clock::now();
-    for (int i=0; i<repeats; i++) {
-        dummy_val += binary_search(arr,array_size,search_value);
+int main(int argc, char* argv[]) {
+    BenchmarkOptions options = parse_benchmark_options(argc, argv);
+
+    // Check correct usage (e.g. 'search 100000 50000')
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " [array_size] [search_value] "
+                  << "[--warmup=N] [--samples=N] [--format=text|csv|json] [--output=path] [--filter=name] "
+                  << "[--sweep=sizes] [--counters]" << std::endl;
+        exit(EXIT_FAILURE);
     }
-    t2 = std::chrono::steady_clock::now();
 
-    dt = std::chrono::duration_cast<std::chrono::microseconds>(t2-t1).count();
-    std::cout << "Binary search: " << ((float)dt / (10e5 * repeats)) << " s (average per op)" <<std::endl;
+    int array_size = get_array_size(argv[1]);
+    int search_value = get_search_value(argv[2]);
 
+    Benchmark bench("search", options, SEARCH_SAMPLES);
 
-    // Recursive binary search
-    t1 = std::chrono::steady_clock::now();
-    for (int i=0; i<repeats; i++) {
-        dummy_val += recursive_binary_search(arr,0,array_size-1,search_value);
+    // The search index sweep runs over sorted arrays from 1K up to array_size, unless the sizes are given by --sweep,
+    // and the fixed search value on the array_size array only
+    std::vector<long long> sweep_sizes;
+    for (long sweep_size = 1000; sweep_size <= array_size; sweep_size *= 10) {
+        sweep_sizes.push_back(sweep_size);
     }
-    t2 = std::chrono::steady_clock::now();
 
-    dt = std::chrono::duration_cast<std::chrono::microseconds>(t2-t1).count();
-    std::cout << "Recursive binary search: " << ((float)dt / (10e5 * repeats)) << " s (average per op)" <<std::endl;
+    for (long long size: bench.sizes(array_size)) {
+        if (size < 1 || size > 100000000) {
+            std::cerr << "sweep sizes must be >= 1 and <= 100000000" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        run_fixed_searches(bench, size, search_value);
+    }
 
-    // Dump final accumulated value to prevent compiler optimising away ops
-    std::cout << dummy_val << std::endl;
+    for (long long size: bench.sizes(sweep_sizes)) {
+        run_random_searches(bench, size);
+    }
 
+    bench.report();
     exit(EXIT_SUCCESS);
 }
@@ -0,0 +1,466 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fcntl.h>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "external.hpp"
+#include "sort.hpp"
+
+namespace sorting {
+
+// Key of a run with no keys left, which loses to every real key
+static const long long EXHAUSTED_KEY = LLONG_MAX;
+
+// Keys read at once when summarizing a key file
+static const std::size_t SUMMARY_BLOCK_KEYS = 1 << 20;
+
+/*
+ * @brief Single thread executing reads and writes in the order they are submitted, so the merge can carry on with
+ * the blocks it holds while the next ones are transferred
+ * */
+class IOQueue {
+public:
+    IOQueue() : worker([this]() { loop(); }) {}
+
+    ~IOQueue() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+        }
+        cv.notify_one();
+        worker.join();
+    }
+
+    IOQueue(IOQueue const &) = delete;
+    IOQueue &operator=(IOQueue const &) = delete;
+
+    // Queue a job, returning the number of keys it transferred once it has run
+    std::future<std::size_t> submit(std::function<std::size_t()> job) {
+        std::packaged_task<std::size_t()> task(std::move(job));
+        std::future<std::size_t> result = task.get_future();
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            jobs.push_back(std::move(task));
+        }
+        cv.notify_one();
+        return result;
+    }
+
+private:
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<std::packaged_task<std::size_t()>> jobs;
+    bool stopping = false;
+    std::thread worker; // started last, once the queue is constructed
+
+    void loop() {
+        while (true) {
+            std::packaged_task<std::size_t()> task;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                cv.wait(lock, [this]() { return stopping || !jobs.empty(); });
+                if (jobs.empty()) return;
+                task = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            task();
+        }
+    }
+};
+
+/*
+ * @brief Supporting function to open a file, exiting if it cannot be opened
+ * */
+static int open_file(std::string const &path, int flags) {
+    int fd = open(path.c_str(), flags, 0644);
+    if (fd < 0) {
+        perror(("open " + path).c_str());
+        exit(EXIT_FAILURE);
+    }
+    return fd;
+}
+
+/*
+ * @brief Supporting function to read up to count keys from a file at a byte offset, retrying short reads
+ *
+ * @return  number of keys read, which is less than count only at the end of the file
+ * */
+static std::size_t read_keys(int fd, int *keys, std::size_t count, off_t offset) {
+    char *data = reinterpret_cast<char *>(keys);
+    std::size_t bytes = count * sizeof(int);
+    std::size_t done = 0;
+
+    while (done < bytes) {
+        ssize_t got = pread(fd, data + done, bytes - done, offset + done);
+        if (got < 0 && errno == EINTR) continue;
+        if (got < 0) {
+            perror("pread");
+            exit(EXIT_FAILURE);
+        }
+        if (got == 0) break;
+        done += got;
+    }
+    return done / sizeof(int);
+}
+
+/*
+ * @brief Supporting function to write count keys to a file at a byte offset, retrying short writes
+ *
+ * @return  number of keys written, which is always count
+ * */
+static std::size_t write_keys(int fd, int const *keys, std::size_t count, off_t offset) {
+    char const *data = reinterpret_cast<char const *>(keys);
+    std::size_t bytes = count * sizeof(int);
+    std::size_t done = 0;
+
+    while (done < bytes) {
+        ssize_t put = pwrite(fd, data + done, bytes - done, offset + done);
+        if (put < 0 && errno == EINTR) continue;
+        if (put < 0) {
+            perror("pwrite");
+            exit(EXIT_FAILURE);
+        }
+        done += put;
+    }
+    return count;
+}
+
+/*
+ * @brief Supporting function to find the number of keys of a key file, exiting if it is not a whole number of keys
+ * */
+static long long key_file_size(int fd, std::string const &path) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        perror("fstat");
+        exit(EXIT_FAILURE);
+    }
+    if (st.st_size % sizeof(int) != 0) {
+        std::cerr << "Error: " << path << " is not a file of " << sizeof(int) << "-byte keys" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    return st.st_size / sizeof(int);
+}
+
+/*
+ * @brief Supporting function to give the elapsed seconds since a start time
+ * */
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Reader of a run file, holding the block being merged and the next block, which the I/O thread reads into
+struct RunReader {
+    int fd = -1;
+    off_t next_offset = 0; // byte offset of the next block to be requested
+    off_t file_size = 0;
+    std::vector<int> current;
+    std::vector<int> next;
+    std::size_t position = 0; // position of the next key in the current block
+    std::size_t count = 0; // number of keys in the current block
+    std::future<std::size_t> pending; // read of the next block, or invalid at the end of the run
+
+    void request(IOQueue &io) {
+        if (next_offset >= file_size) {
+            pending = std::future<std::size_t>();
+            return;
+        }
+        std::size_t keys = std::min<off_t>(next.size(), (file_size - next_offset) / sizeof(int));
+        pending = io.submit([fd = fd, data = next.data(), keys, offset = next_offset]() {
+            return read_keys(fd, data, keys, offset);
+        });
+        next_offset += keys * sizeof(int);
+    }
+
+    // Make the next block current, once it has been read, and request the one after; false at the end of the run
+    bool advance(IOQueue &io) {
+        if (!pending.valid()) return false;
+        count = pending.get();
+        position = 0;
+        std::swap(current, next);
+        request(io);
+        return count > 0;
+    }
+
+    long long next_key(IOQueue &io) {
+        if (position == count && !advance(io)) {
+            return EXHAUSTED_KEY;
+        }
+        return current[position++];
+    }
+};
+
+// Writer of a run or output file, filling one block while the I/O thread writes the other
+struct RunWriter {
+    int fd = -1;
+    off_t offset = 0; // byte offset of the next block to be written
+    std::vector<int> current;
+    std::vector<int> next;
+    std::size_t count = 0; // number of keys in the current block
+    std::future<std::size_t> pending; // write of the previous block, if any
+
+    // Wait for the previous write, then hand the current block to the I/O thread
+    void flush(IOQueue &io) {
+        if (pending.valid()) pending.get();
+        std::swap(current, next);
+        pending = io.submit([fd = fd, data = next.data(), keys = count, offset = offset]() {
+            return write_keys(fd, data, keys, offset);
+        });
+        offset += count * sizeof(int);
+        count = 0;
+    }
+
+    void push(IOQueue &io, int key) {
+        current[count++] = key;
+        if (count == current.size()) {
+            flush(io);
+        }
+    }
+
+    void finish(IOQueue &io) {
+        if (count > 0) flush(io);
+        if (pending.valid()) pending.get();
+    }
+};
+
+/*
+ * @brief Tree of losers for a k-way merge
+ *
+ * The leaves are the current keys of the runs, and each internal node holds the run that lost the match played
+ * there, with the overall winner at the root. Replacing the key of the winner only replays the matches on the path
+ * from its leaf to the root, one comparison per level, against the losers stored there. Ties go to the lower run.
+ * */
+class LoserTree {
+public:
+    explicit LoserTree(std::vector<long long> heads) : keys(std::move(heads)), tree(keys.size()) {
+        tree[0] = play(1);
+    }
+
+    int winner() const {
+        return tree[0];
+    }
+
+    long long winning_key() const {
+        return keys[tree[0]];
+    }
+
+    // Replace the key of the winning run, and find the new winner
+    void replace_winner(long long key) {
+        int k = keys.size();
+        int w = tree[0];
+        keys[w] = key;
+
+        for (int node = (w + k) / 2; node > 0; node /= 2) {
+            if (beats(tree[node], w)) {
+                std::swap(tree[node], w);
+            }
+        }
+        tree[0] = w;
+    }
+
+private:
+    std::vector<long long> keys; // current key of each run
+    std::vector<int> tree; // internal nodes 1..k-1 (with the leaves of the runs at k..2k-1), and the winner at 0
+
+    bool beats(int a, int b) const {
+        return keys[a] < keys[b] || (keys[a] == keys[b] && a < b);
+    }
+
+    // Play the matches of the subtree at node, storing the losers, and return its winner
+    int play(int node) {
+        int k = keys.size();
+        if (node >= k) return node - k;
+
+        int a = play(2 * node);
+        int b = play(2 * node + 1);
+        if (beats(a, b)) {
+            tree[node] = b;
+            return a;
+        }
+        tree[node] = a;
+        return b;
+    }
+};
+
+/*
+ * @brief Supporting function to merge sorted run files into one sorted file, removing the runs
+ *
+ * @param[in]  io  I/O thread for the reads and writes
+ * @param[in]  runs  run files to be merged
+ * @param[in]  output_path  file the merged keys are written to
+ * @param[in]  block_keys  keys per block, of which each run and the output hold two
+ * */
+static void merge_runs(IOQueue &io, std::vector<std::string> const &runs, std::string const &output_path,
+                       std::size_t block_keys) {
+    int k = runs.size();
+    std::vector<RunReader> readers(k);
+    std::vector<long long> heads(k);
+
+    // Request the first block of every run before waiting on any of them
+    for (int r = 0; r < k; r++) {
+        RunReader &reader = readers[r];
+        reader.fd = open_file(runs[r], O_RDONLY);
+        reader.file_size = key_file_size(reader.fd, runs[r]) * sizeof(int);
+        reader.current.resize(block_keys);
+        reader.next.resize(block_keys);
+        posix_fadvise(reader.fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        reader.request(io);
+    }
+    for (int r = 0; r < k; r++) {
+        heads[r] = readers[r].next_key(io);
+    }
+
+    RunWriter writer;
+    writer.fd = open_file(output_path, O_WRONLY | O_CREAT | O_TRUNC);
+    writer.current.resize(block_keys);
+    writer.next.resize(block_keys);
+
+    LoserTree tree(std::move(heads));
+    while (tree.winning_key() != EXHAUSTED_KEY) {
+        int w = tree.winner();
+        writer.push(io, (int) tree.winning_key());
+        tree.replace_winner(readers[w].next_key(io));
+    }
+    writer.finish(io);
+
+    if (close(writer.fd) != 0) {
+        perror("close");
+        exit(EXIT_FAILURE);
+    }
+    for (int r = 0; r < k; r++) {
+        close(readers[r].fd);
+        std::remove(runs[r].c_str());
+    }
+}
+
+ExternalSortStats external_sort(TaskPool &pool, std::string const &input_path, std::string const &output_path,
+                                std::size_t memory_bytes) {
+    if (memory_bytes < EXTERNAL_MIN_MEMORY_BYTES) {
+        std::cerr << "Error: external sort needs at least " << EXTERNAL_MIN_MEMORY_BYTES << " bytes of memory"
+                  << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    ExternalSortStats stats;
+    std::vector<std::string> runs;
+    int next_run = 0;
+    auto run_path = [&]() { return output_path + ".run" + std::to_string(next_run++); };
+
+    // Run generation: merge sort needs a buffer of half its range, so chunks take two thirds of the memory
+    auto start = std::chrono::steady_clock::now();
+    {
+        std::vector<int> chunk(memory_bytes / sizeof(int) * 2 / 3);
+        int in = open_file(input_path, O_RDONLY);
+        stats.keys = key_file_size(in, input_path);
+        posix_fadvise(in, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+        for (long long read = 0; read < stats.keys;) {
+            std::size_t n = read_keys(in, chunk.data(), chunk.size(), read * sizeof(int));
+            read += n;
+
+            // Each thread sorts and writes its own slice, as a separate run, rather than merging them in memory
+            std::size_t min_slice = EXTERNAL_MIN_BLOCK_BYTES / sizeof(int);
+            int slices = std::max<std::size_t>(std::min<std::size_t>(pool.size(), n / min_slice), 1);
+            std::size_t slice = (n + slices - 1) / slices;
+            std::vector<std::string> slice_paths;
+            for (int s = 0; s < slices; s++) {
+                slice_paths.push_back(run_path());
+            }
+
+            pool.parallel_for(0, slices, 1, [&](int lo, int hi) {
+                for (int s = lo; s < hi; s++) {
+                    std::size_t first = s * slice;
+                    std::size_t last = std::min(first + slice, n);
+                    sorting::merge_sort(chunk.begin() + first, chunk.begin() + last);
+
+                    int out = open_file(slice_paths[s], O_WRONLY | O_CREAT | O_TRUNC);
+                    write_keys(out, chunk.data() + first, last - first, 0);
+                    close(out);
+                }
+            });
+            runs.insert(runs.end(), slice_paths.begin(), slice_paths.end());
+        }
+        close(in);
+    }
+    stats.run_seconds = seconds_since(start);
+    stats.runs = runs.size();
+
+    // Merge passes: each run and the output are double buffered, with blocks of at least EXTERNAL_MIN_BLOCK_BYTES
+    start = std::chrono::steady_clock::now();
+    IOQueue io;
+    std::size_t memory_keys = memory_bytes / sizeof(int);
+    int max_fan_in = memory_bytes / (2 * EXTERNAL_MIN_BLOCK_BYTES) - 1;
+
+    if (runs.empty()) {
+        close(open_file(output_path, O_WRONLY | O_CREAT | O_TRUNC));
+    } else if (runs.size() == 1) {
+        if (std::rename(runs[0].c_str(), output_path.c_str()) != 0) {
+            perror("rename");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    while (runs.size() > 1) {
+        stats.merge_passes++;
+
+        // The last pass merges every remaining run into the output
+        if ((int) runs.size() <= max_fan_in) {
+            stats.fan_in = std::max<int>(stats.fan_in, runs.size());
+            merge_runs(io, runs, output_path, memory_keys / (2 * (runs.size() + 1)));
+            break;
+        }
+
+        // Otherwise merge groups of runs into fewer, longer runs, spreading the runs evenly between the groups
+        int groups = (runs.size() + max_fan_in - 1) / max_fan_in;
+        std::vector<std::string> merged;
+        for (int g = 0; g < groups; g++) {
+            std::size_t first = runs.size() * g / groups;
+            std::size_t last = runs.size() * (g + 1) / groups;
+            std::vector<std::string> group(runs.begin() + first, runs.begin() + last);
+
+            stats.fan_in = std::max<int>(stats.fan_in, group.size());
+            merged.push_back(run_path());
+            merge_runs(io, group, merged.back(), memory_keys / (2 * (group.size() + 1)));
+        }
+        runs = merged;
+    }
+    stats.merge_seconds = seconds_since(start);
+
+    return stats;
+}
+
+KeyFileSummary summarize_key_file(std::string const &path) {
+    KeyFileSummary summary;
+    int fd = open_file(path, O_RDONLY);
+    long long keys = key_file_size(fd, path);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    std::vector<int> block(SUMMARY_BLOCK_KEYS);
+    long long previous = LLONG_MIN;
+    while (summary.keys < keys) {
+        std::size_t n = read_keys(fd, block.data(), block.size(), summary.keys * sizeof(int));
+        if (n == 0) break;
+
+        for (std::size_t i = 0; i < n; i++) {
+            summary.checksum += (uint32_t) block[i];
+            summary.sorted &= block[i] >= previous;
+            previous = block[i];
+        }
+        summary.keys += n;
+    }
+    close(fd);
+
+    return summary;
+}
+
+} // namespace sorting
@@ -0,0 +1,63 @@
+#ifndef SORT_EXTERNAL_HPP
+#define SORT_EXTERNAL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "../../include/taskpool.hpp"
+
+namespace sorting {
+
+// Smallest block of keys read or written at once by the merge of an external sort, which bounds its fan-in
+const std::size_t EXTERNAL_MIN_BLOCK_BYTES = 1 << 16;
+
+// Smallest memory limit of an external sort, enough to merge two runs at the smallest block size
+const std::size_t EXTERNAL_MIN_MEMORY_BYTES = 6 * EXTERNAL_MIN_BLOCK_BYTES;
+
+// What an external sort did, for reporting alongside its throughput
+struct ExternalSortStats {
+    long long keys = 0;
+    int runs = 0; // sorted runs written by run generation
+    int merge_passes = 0; // passes merging runs, the last of which writes the output (0 if there was only one run)
+    int fan_in = 0; // most runs merged at once
+    double run_seconds = 0; // time spent generating runs
+    double merge_seconds = 0; // time spent merging runs
+};
+
+// Number of keys of a key file, their sum (mod 2^64) and whether they are in ascending order
+struct KeyFileSummary {
+    long long keys = 0;
+    uint64_t checksum = 0;
+    bool sorted = true;
+};
+
+/*
+ * @brief External merge sort of a file of keys, in bounded memory
+ *
+ * The keys are native endian 32-bit ints, packed with no header. Run generation reads the input in chunks that fit
+ * in the memory limit, splits each chunk between the threads of the pool to be merge sorted in parallel, and writes
+ * each sorted slice to a run file next to the output. The runs are then merged with a loser tree, as many at once
+ * as the memory limit allows double buffering of every run and of the output, in as many passes as needed. A
+ * dedicated I/O thread reads the next block of each run and writes the last block of output while the tree merges
+ * the current blocks, so the merge only waits on the disk when it is the bottleneck. The run files are removed
+ * once merged. Errors are reported on stderr and exit the program.
+ * @param[in]  pool  thread pool to sort the chunks of run generation on
+ * @param[in]  input_path  file of keys to be sorted
+ * @param[in]  output_path  file the sorted keys are written to, which must differ from the input
+ * @param[in]  memory_bytes  memory limit for the buffers of keys, which must be >= EXTERNAL_MIN_MEMORY_BYTES
+ * @return  what the sort did
+ * */
+ExternalSortStats external_sort(TaskPool &pool, std::string const &input_path, std::string const &output_path,
+                                std::size_t memory_bytes);
+
+/*
+ * @brief Summarize a file of keys, reading it in blocks, so the output of an external sort can be checked
+ *
+ * @param[in]  path  file of keys
+ * @return  number of keys, checksum and order of the file
+ * */
+KeyFileSummary summarize_key_file(std::string const &path);
+
+} // namespace sorting
+
+#endif //SORT_EXTERNAL_HPP
@@ -0,0 +1,54 @@
+#include "network.hpp"
+#include "sort.hpp"
+
+namespace sorting {
+
+#if defined(__x86_64__) || defined(__i386__)
+// Kernels compiled with their own instruction set flags, in network_avx2.cpp and network_avx512.cpp
+void network_sort_avx2(int *A, int n);
+void network_sort_avx512(int *A, int n);
+#endif
+
+namespace {
+
+struct NetworkKernel {
+    void (*sort)(int *, int);
+    int cutoff;
+    char const *name;
+};
+
+void network_sort_scalar(int *A, int n) {
+    insertion_sort(A, A + n);
+}
+
+// Pick the widest kernel supported by the CPU we are running on
+NetworkKernel select_network_kernel() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return {network_sort_avx512, NETWORK_SORT_LIMIT, "avx512"};
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return {network_sort_avx2, NETWORK_SORT_LIMIT, "avx2"};
+    }
+#endif
+    return {network_sort_scalar, INSERTION_SORT_CUTOFF, "scalar"};
+}
+
+NetworkKernel const kernel = select_network_kernel();
+
+} // namespace
+
+void network_sort(int *A, int n) {
+    kernel.sort(A, n);
+}
+
+int network_sort_cutoff() {
+    return kernel.cutoff;
+}
+
+char const *network_sort_kernel() {
+    return kernel.name;
+}
+
+} // namespace sorting
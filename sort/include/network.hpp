@@ -0,0 +1,27 @@
+#ifndef SORT_NETWORK_HPP
+#define SORT_NETWORK_HPP
+
+namespace sorting {
+
+// Largest range that may be passed to network_sort
+const int NETWORK_SORT_LIMIT = 64;
+
+/*
+ * @brief Sort a small array of ints with a bitonic sorting network held in SIMD registers
+ *
+ * The kernel is chosen once at startup from the features of the CPU (AVX-512, else AVX2, else a scalar insertion
+ * sort fallback).
+ * @param[in]  A  pointer to array of ints to be sorted
+ * @param[in]  n  size of array, which must be <= NETWORK_SORT_LIMIT
+ * */
+void network_sort(int *A, int n);
+
+// Largest range that the selected kernel sorts faster than recursing further
+int network_sort_cutoff();
+
+// Name of the selected kernel ("avx512", "avx2" or "scalar")
+char const *network_sort_kernel();
+
+} // namespace sorting
+
+#endif //SORT_NETWORK_HPP
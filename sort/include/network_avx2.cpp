@@ -0,0 +1,59 @@
+#ifdef __AVX2__
+
+#include <immintrin.h>
+#include "network_bitonic.hpp"
+
+namespace sorting {
+namespace {
+
+// Bitonic network operations on 8 int lanes of an AVX2 register
+struct Avx2 {
+    using Vec = __m256i;
+    static const int W = 8;
+
+    static inline Vec iota() {
+        return _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    }
+
+    // All ones in lanes [0..count-1]
+    static inline Vec lanes_below(int count) {
+        return _mm256_cmpgt_epi32(_mm256_set1_epi32(count), iota());
+    }
+
+    static inline Vec load_padded(int const *p, int count) {
+        Vec mask = lanes_below(count);
+        return _mm256_blendv_epi8(_mm256_set1_epi32(INT_MAX), _mm256_maskload_epi32(p, mask), mask);
+    }
+
+    static inline void store_partial(int *p, Vec v, int count) {
+        _mm256_maskstore_epi32(p, lanes_below(count), v);
+    }
+
+    static inline Vec min(Vec a, Vec b) {
+        return _mm256_min_epi32(a, b);
+    }
+
+    static inline Vec max(Vec a, Vec b) {
+        return _mm256_max_epi32(a, b);
+    }
+
+    static inline Vec reverse(Vec v) {
+        return _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+    }
+
+    static inline Vec exchange(Vec v, int x, int bit) {
+        Vec partner = _mm256_permutevar8x32_epi32(v, _mm256_xor_si256(iota(), _mm256_set1_epi32(x)));
+        Vec upper = _mm256_cmpeq_epi32(_mm256_and_si256(iota(), _mm256_set1_epi32(bit)), _mm256_set1_epi32(bit));
+        return _mm256_blendv_epi8(min(v, partner), max(v, partner), upper);
+    }
+};
+
+} // namespace
+
+void network_sort_avx2(int *A, int n) {
+    bitonic::network_sort<Avx2>(A, n);
+}
+
+} // namespace sorting
+
+#endif //__AVX2__
@@ -0,0 +1,64 @@
+#ifdef __AVX512F__
+
+#include <immintrin.h>
+#include "network_bitonic.hpp"
+
+namespace sorting {
+namespace {
+
+// Bitonic network operations on 16 int lanes of an AVX-512 register. The min, max and permutes use the masked
+// forms with every lane selected, as the unmasked intrinsics of GCC 12 pass an uninitialized source that -Wall
+// reports wherever they are inlined. The merge source is always one of the inputs, so the mask adds no dependency.
+struct Avx512 {
+    using Vec = __m512i;
+    static const int W = 16;
+    static const __mmask16 ALL_LANES = 0xffff;
+
+    static inline Vec iota() {
+        return _mm512_set_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    }
+
+    // Mask of lanes [0..count-1]
+    static inline __mmask16 lanes_below(int count) {
+        if (count <= 0) return 0;
+        if (count >= W) return ALL_LANES;
+        return (__mmask16)((1u << count) - 1);
+    }
+
+    static inline Vec load_padded(int const *p, int count) {
+        return _mm512_mask_loadu_epi32(_mm512_set1_epi32(INT_MAX), lanes_below(count), p);
+    }
+
+    static inline void store_partial(int *p, Vec v, int count) {
+        _mm512_mask_storeu_epi32(p, lanes_below(count), v);
+    }
+
+    static inline Vec min(Vec a, Vec b) {
+        return _mm512_mask_min_epi32(a, ALL_LANES, a, b);
+    }
+
+    static inline Vec max(Vec a, Vec b) {
+        return _mm512_mask_max_epi32(a, ALL_LANES, a, b);
+    }
+
+    static inline Vec reverse(Vec v) {
+        Vec reversed = _mm512_set_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+        return _mm512_mask_permutexvar_epi32(v, ALL_LANES, reversed, v);
+    }
+
+    static inline Vec exchange(Vec v, int x, int bit) {
+        Vec partner = _mm512_mask_permutexvar_epi32(v, ALL_LANES, _mm512_xor_si512(iota(), _mm512_set1_epi32(x)), v);
+        __mmask16 upper = _mm512_test_epi32_mask(iota(), _mm512_set1_epi32(bit));
+        return _mm512_mask_blend_epi32(upper, min(v, partner), max(v, partner));
+    }
+};
+
+} // namespace
+
+void network_sort_avx512(int *A, int n) {
+    bitonic::network_sort<Avx512>(A, n);
+}
+
+} // namespace sorting
+
+#endif //__AVX512F__
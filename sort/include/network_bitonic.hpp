@@ -0,0 +1,128 @@
+#ifndef SORT_NETWORK_BITONIC_HPP
+#define SORT_NETWORK_BITONIC_HPP
+
+#include <climits>
+
+// Generic bitonic sorting network, instantiated by network_avx2.cpp and network_avx512.cpp. Each of those files is
+// compiled with its own instruction set flags, and supplies an ISA type with a register type Vec of W int lanes
+// and the following operations:
+//
+//   load_padded(p, count)   load p[0..count-1] into the low lanes, filling the remaining lanes with INT_MAX
+//   store_partial(p, v, count)  store the low count lanes of v to p[0..count-1]
+//   min(a, b), max(a, b)    lane-wise minimum and maximum
+//   reverse(v)              reverse the lane order of v
+//   exchange(v, x, bit)     compare each lane l with lane l ^ x, keeping the maximum in lanes where (l & bit) != 0
+//                           and the minimum elsewhere
+//
+// Nothing from the standard library is used, so no inline library code is compiled with the wider instruction set.
+namespace sorting {
+namespace bitonic {
+
+/*
+ * @brief Sort the K * W ints held in registers v[0..K-1], in register-major order
+ *
+ * For each block size s = 2, 4, ..., K * W, element e is first compared with its mirror e ^ (s - 1) inside the
+ * block, and then with e ^ t for t = s / 4, ..., 1, always keeping the minimum at the lower index. Comparisons
+ * between elements in the same register are made with a lane permute, and between registers lane-wise.
+ * @param[in]  v  array of K registers to be sorted
+ * */
+template <typename ISA, int K>
+inline void sort_registers(typename ISA::Vec *v) {
+    const int W = ISA::W;
+    const int N = K * W;
+
+#pragma GCC unroll 8
+    for (int log_s = 1; (1 << log_s) <= N; log_s++) {
+        const int s = 1 << log_s;
+
+        // Compare each element with its mirror inside the block of size s
+        if (s <= W) {
+#pragma GCC unroll 8
+            for (int k = 0; k < K; k++) {
+                v[k] = ISA::exchange(v[k], s - 1, s / 2);
+            }
+        } else {
+            const int span = s / W; // number of registers per block
+#pragma GCC unroll 8
+            for (int a = 0; a < K; a++) {
+                if ((a % span) >= span / 2) continue;
+                const int c = a ^ (span - 1);
+                auto rc = ISA::reverse(v[c]);
+                auto mx = ISA::max(v[a], rc);
+                v[a] = ISA::min(v[a], rc);
+                v[c] = ISA::reverse(mx);
+            }
+        }
+
+        // Half cleaners with strides s / 4 down to 1
+#pragma GCC unroll 8
+        for (int log_t = log_s - 2; log_t >= 0; log_t--) {
+            const int t = 1 << log_t;
+            if (t >= W) {
+                const int d = t / W; // stride in registers
+#pragma GCC unroll 8
+                for (int a = 0; a < K; a++) {
+                    // a + d < K whenever bit d of a is clear, which the compiler cannot see through the unrolling
+                    if ((a & d) || a + d >= K) continue;
+                    auto mx = ISA::max(v[a], v[a + d]);
+                    v[a] = ISA::min(v[a], v[a + d]);
+                    v[a + d] = mx;
+                }
+            } else {
+#pragma GCC unroll 8
+                for (int k = 0; k < K; k++) {
+                    v[k] = ISA::exchange(v[k], t, t);
+                }
+            }
+        }
+    }
+}
+
+/*
+ * @brief Sort A[0..n-1] with K registers, padding the unused lanes with INT_MAX so they sort to the end
+ *
+ * @param[in]  A  pointer to array of ints to be sorted
+ * @param[in]  n  size of array, where n <= K * W
+ * */
+template <typename ISA, int K>
+inline void sort_padded(int *A, int n) {
+    typename ISA::Vec v[K];
+
+#pragma GCC unroll 8
+    for (int k = 0; k < K; k++) {
+        v[k] = ISA::load_padded(A + k * ISA::W, n - k * ISA::W);
+    }
+
+    sort_registers<ISA, K>(v);
+
+#pragma GCC unroll 8
+    for (int k = 0; k < K; k++) {
+        ISA::store_partial(A + k * ISA::W, v[k], n - k * ISA::W);
+    }
+}
+
+/*
+ * @brief Sort A[0..n-1] using the fewest (power of two) registers that hold n ints
+ *
+ * @param[in]  A  pointer to array of ints to be sorted
+ * @param[in]  n  size of array, where n <= 64
+ * */
+template <typename ISA>
+inline void network_sort(int *A, int n) {
+    const int W = ISA::W;
+
+    if (n <= W) {
+        sort_padded<ISA, 1>(A, n);
+    } else if (n <= 2 * W) {
+        sort_padded<ISA, 2>(A, n);
+    } else if (n <= 4 * W) {
+        sort_padded<ISA, 4>(A, n);
+    } else {
+        sort_padded<ISA, 64 / W>(A, n);
+    }
+}
+
+} // namespace bitonic
+} // namespace sorting
+
+#endif //SORT_NETWORK_BITONIC_HPP
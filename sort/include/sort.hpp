@@ -0,0 +1,528 @@
+#ifndef SORT_SORT_HPP
+#define SORT_SORT_HPP
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#ifdef SORT_COUNT_OPERATIONS
+#include <atomic>
+#endif
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "network.hpp"
+
+// The sorts are namespaced, as unqualified calls with std iterators would otherwise be ambiguous with std::partition
+// and std::merge (found by argument dependent lookup).
+namespace sorting {
+
+// Ranges at or below this size are insertion sorted by the recursive sorts
+const int INSERTION_SORT_CUTOFF = 24;
+
+// Natural runs shorter than this are extended to this length by insertion sort, before powersort merges them
+const int POWERSORT_MIN_RUN = 32;
+
+// Number of consecutive elements taken from one side of a powersort merge before it starts galloping
+const int POWERSORT_MIN_GALLOP = 7;
+
+#ifdef SORT_COUNT_OPERATIONS
+// Comparisons, swaps and moves made by partition, merge and powersort, in builds with SORT_COUNT_OPERATIONS defined
+// (make COUNT_OPERATIONS=1). Each call adds its own counts once at the end, so the parallel sorts can share them.
+struct OperationCounts {
+    std::atomic<long long> comparisons{0};
+    std::atomic<long long> swaps{0};
+    std::atomic<long long> moves{0};
+};
+
+inline OperationCounts operation_counts;
+
+#define SORT_COUNT_OPERATION(counter, n) \
+    sorting::operation_counts.counter.fetch_add((n), std::memory_order_relaxed)
+#else
+#define SORT_COUNT_OPERATION(counter, n) ((void) 0)
+#endif
+
+/*
+ * @brief Insertion sort implementation
+ *
+ * @param[in]  first  iterator to start of range to be sorted
+ * @param[in]  last  iterator to end of range to be sorted (exclusive)
+ * @param[in]  comp  comparator returning true if the first argument orders before the second
+ * */
+template <typename RandomIt, typename Compare = std::less<>>
+void insertion_sort(RandomIt first, RandomIt last, Compare comp = Compare()) {
+    if (first == last) return;
+
+    for (RandomIt i = first + 1; i != last; ++i) {
+        auto key = std::move(*i);
+        RandomIt j = i;
+        while (j != first && comp(key, *(j - 1))) {
+            *j = std::move(*(j - 1));
+            --j;
+        }
+        *j = std::move(key);
+    }
+}
+
+/*
+ * @brief True if a range [first, last) with this iterator and comparator can be passed to network_sort
+ * */
+template <typename RandomIt, typename Compare>
+constexpr bool uses_network_sort() {
+    using T = typename std::iterator_traits<RandomIt>::value_type;
+    return std::is_same_v<T, int> &&
+           (std::is_same_v<RandomIt, int *> || std::is_same_v<RandomIt, typename std::vector<int>::iterator>) &&
+           (std::is_same_v<Compare, std::less<>> || std::is_same_v<Compare, std::less<int>>);
+}
+
+/*
+ * @brief Supporting function for the recursive sorts, to sort a small range at the leaves of the recursion
+ *
+ * Contiguous ranges of ints, in ascending order, are sorted by the SIMD sorting network kernel, and anything else
+ * by insertion sort.
+ * @param[in]  first  iterator to start of range to be sorted
+ * @param[in]  last  iterator to end of range to be sorted (exclusive)
+ * @param[in]  comp  comparator returning true if the first argument orders before the second
+ * @return  true if the range was small enough to be sorted, false if it should be recursed into
+ * */
+template <typename RandomIt, typename Compare>
+bool leaf_sort(RandomIt first, RandomIt last, Compare comp) {
+    if constexpr (uses_network_sort<RandomIt, Compare>()) {
+        if (last - first > network_sort_cutoff()) return false;
+        network_sort(&*first, last - first);
+    } else {
+        if (last - first > INSERTION_SORT_CUTOFF) return false;
+        sorting::insertion_sort(first, last, comp);
+    }
+    return true;
+}
+
+/*
+ * @brief Supporting function for merge sort implementation
+ *
+ * Merge the sorted ranges [first, middle) and [middle, last) in place. The left range is moved out to the buffer
+ * and merged back with the right range, which can be read in place as it is never overwritten before it is read.
+ * The merge stops once the buffer is empty, so no sentinel value is needed, and equal elements keep their order.
+ * @param[in]  first  iterator to start of first sorted range
+ * @param[in]  middle  iterator to end of first sorted range, and start of second sorted range
+ * @param[in]  last  iterator to end of second sorted range
+ * @param[in]  buffer  iterator to scratch buffer, with space for at least (middle - first) elements
+ * @param[in]  comp  comparator returning true if the first argument orders before the second
+ * */
+template <typename RandomIt, typename BufferIt, typename Compare>
+void merge(RandomIt first, RandomIt middle, RandomIt last, BufferIt buffer, Compare comp) {
+    BufferIt buffer_end = std::move(first, middle, buffer);
+
+    BufferIt i = buffer;
+    RandomIt j = middle;
+    RandomIt k = first;
+
+    while (i != buffer_end && j != last) {
+        if (comp(*j, *i)) {
+            *k++ = std::move(*j++);
+        } else {
+            *k++ = std::move(*i++);
+        }
+    }
+
+    // One comparison per element merged, and one move of each element into the buffer and one back (apart from the
+    // remaining elements of the right range)
+    SORT_COUNT_OPERATION(comparisons, k - first);
+    SORT_COUNT_OPERATION(moves, (middle - first) + (k - first) + (buffer_end - i));
+
+    // Any remaining elements of the right range are already in place
+    std::move(i, buffer_end, k);
+}
+
+/*
+ * @brief Supporting recursive function for merge sort implementation
+ *
+ * @param[in]  first  iterator to start of range to be sorted
+ * @param[in]  last  iterator to end of range to be sorted (exclusive)
+ * @param[in]  buffer  iterator to scratch buffer, with space for at least half of the range
+ * @param[in]  comp  comparator returning true if the first argument orders before the second
+ * */
+template <typename RandomIt, typename BufferIt, typename Compare>
+void merge_sort(RandomIt first, RandomIt last, BufferIt buffer, Compare comp) {
+    // Small ranges are cheaper to sort in place
+    if (sorting::leaf_sort(first, last, comp)) return;
+
+    // Calculate midpoint of range
+    RandomIt middle = first + (last - first) / 2;
+
+    // Recursively sort each range [first, middle) and [middle, last)
+    sorting::merge_sort(first, middle, buffer, comp);
+    sorting::merge_sort(middle, last, buffer, comp);
+
+    // Finally, merge sorted ranges
+    sorting::merge(first, middle, last, buffer, comp);
+}
+
+/*
+ * @brief Merge sort implementation
+ *
+ * A single scratch buffer of half the range is allocated up front, and reused by every merge. The value type must
+ * be default constructible and move assignable.
+ * @param[in]  first  iterator to start of range to be sorted
+ * @param[in]  last  iterator to end of range to be sorted (exclusive)
+ * @param[in]  comp  comparator returning true if the first argument orders before the second
+ * */
+template <typename RandomIt, typename Compare = std::less<>>
+void merge_sort(RandomIt first, RandomIt last, Compare comp = Compare()) {
+    if (last - first < 2) return;
+
+    std::vector<typename std::iterator_traits<RandomIt>::value_type> buffer((last - first + 1) / 2);
+    sorting::merge_sort(first, last, buffer.begin(), comp);
+}
+
+/*
+ * @brief Supporting function for powersort, to find the end of the prefix of [first, last) on which pred holds
+ *
+ * Probes 1, 2, 4, ... elements in, then binary searches the last gap, so a prefix of length m costs O(log m)
+ * comparisons wherever it ends.
+ * @param[in]  first  iterator to start of range
+ * @param[in]  last  iterator to end of range (exclusive)
+ * @param[in]  pred  predicate that holds on a prefix of the range and nowhere after it
+ * @return  iterator to the first element on which pred does not hold, or last
+ * */
+template <typename It, typename Pred>
+It gallop_prefix(It first, It last, Pred pred) {
+    auto n = last - first;
+    decltype(n) previous = 0, offset = 1;
+
+    while (offset <= n && pred(*(first + (offset - 1)))) {
+        previous = offset;
+        offset *= 2;
+    }
+    return std::partition_point(first + previous, first + std::min(offset - 1, n), pred);
+}
+
+/*
+ * @brief Supporting function for powersort, to find the start of the suffix of [first, last) on which pred holds
+ *
+ * As gallop_prefix, probing from the end of the range.
+ * @param[in]  first  iterator to start of range
+ * @param[in]  last  iterator to end of range (exclusive)
+ * @param[in]  pred  predicate that holds on a suffix of the range and nowhere before it
+ * @return  iterator to the first element of the suffix, or last if it is empty
+ * */
+template <typename It, typename Pred>
+It gallop_suffix(It first, It last, Pred pred) {
+    auto n = last - first;
+    decltype(n) previous = 0, offset = 1;
+
+    while (offset <= n && pred(*(last - offset))) {
+        previous = offset;
+        offset *= 2;
+    }
+    return std::partition_point(last - std::min(offset - 1, n), last - previous,
+                                [&](auto const &x) { return !pred(x); });
+}
+
+/*
+ * @brief Supporting function for powersort, to merge adjacent sorted runs with galloping, using a buffer of the
+ * shorter run
+ *
+ * The elements of the left run that already order before the right run, and those of the right run that already
+ * order after the left run, are found by galloping and left in place, so runs that do not overlap cost O(log n).
+ * The shorter of what remains is moved to the buffer and merged, from the front if it is the left run and from the
+ * back otherwise. Once one side wins POWERSORT_MIN_GALLOP times in a row, the merge gallops, moving the whole
+ * stretch of each side that orders before the next element of the other side at once, until the stretches get
+ * short again. Equal elements keep their order.
+ * @param[in]  first  iterator to start of first sorted run
+ * @param[in]  middle  iterator to end of first sorted run, and start of second sorted run
+ * @param[in]  last  iterator to end of second sorted run
+ * @param[in]  buffer  iterator to scratch buffer, with space for at least the shorter run
+ * @param[in]  comp  comparator returning true if the first argument orders before the second
+ * */
+template <typename RandomIt, typename BufferIt, typename Compare>
+void merge_galloping(RandomIt first, RandomIt middle, RandomIt last, BufferIt buffer, Compare comp) {
+    // Trim the elements already in their final place
+    first = sorting::gallop_prefix(first, middle, [&](auto const &x) { return !comp(*middle, x); });
+    if (first == middle) return;
+    last = sorting::gallop_suffix(middle, last, [&](auto const &x) { return comp(*(middle - 1), x); });
+    if (middle == last) return;
+
+    if (middle - first <= last - middle) {
+        // Merge forwards, with the left run in the buffer and the right run read in place ahead of the output
+        BufferIt i = buffer;
+        BufferIt buffer_end = std::move(first, middle, buffer);
+        RandomIt j = middle;
+        RandomIt k = first;
+
+        while (i != buffer_end && j != last) {
+            int left_wins = 0, right_wins = 0;
+            while (i != buffer_end && j != last && left_wins < POWERSORT_MIN_GALLOP &&
+                   right_wins < POWERSORT_MIN_GALLOP) {
+                if (comp(*j, *i)) {
+                    *k++ = std::move(*j++);
+                    right_wins++;
+                    left_wins = 0;
+                } else {
+                    *k++ = std::move(*i++);
+                    left_wins++;
+                    right_wins = 0;
+                }
+            }
+
+            while (i != buffer_end && j != last &&
+                   (left_wins >= POWERSORT_MIN_GALLOP || right_wins >= POWERSORT_MIN_GALLOP)) {
+                BufferIt next_i = sorting::gallop_prefix(i, buffer_end, [&](auto const &x) { return !comp(*j, x); });
+                left_wins = next_i - i;
+                k = std::move(i, next_i, k);
+                i = next_i;
+                if (i == buffer_end) break;
+
+                RandomIt next_j = sorting::gallop_prefix(j, last, [&](auto const &x) { return comp(x, *i); });
+                right_wins = next_j - j;
+                k = std::move(j, next_j, k);
+                j = next_j;
+            }
+        }
+
+        // Each element of the left run moves to the buffer and back, and each element of the right run merged
+        // before the end moves once, while the remaining elements of the right run are already in place
+        SORT_COUNT_OPERATION(moves, (middle - first) * 2 + (j - middle));
+        std::move(i, buffer_end, k);
+    } else {
+        // Merge backwards, with the right run in the buffer and the left run read in place behind the output
+        BufferIt buffer_end = std::move(middle, last, buffer);
+        BufferIt i = buffer_end;
+        RandomIt j = middle;
+        RandomIt k = last;
+
+        while (i != buffer && j != first) {
+            int left_wins = 0, right_wins = 0;
+            while (i != buffer && j != first && left_wins < POWERSORT_MIN_GALLOP &&
+                   right_wins < POWERSORT_MIN_GALLOP) {
+                if (comp(*(i - 1), *(j - 1))) {
+                    *--k = std::move(*--j);
+                    left_wins++;
+                    right_wins = 0;
+                } else {
+                    *--k = std::move(*--i);
+                    right_wins++;
+                    left_wins = 0;
+                }
+            }
+
+            while (i != buffer && j != first &&
+                   (left_wins >= POWERSORT_MIN_GALLOP || right_wins >= POWERSORT_MIN_GALLOP)) {
+                RandomIt next_j = sorting::gallop_suffix(first, j, [&](auto const &x) { return comp(*(i - 1), x); });
+                left_wins = j - next_j;
+                k = std::move_backward(next_j, j, k);
+                j = next_j;
+                if (j == first) break;
+
+                BufferIt next_i = sorting::gallop_suffix(buffer, i, [&](auto const &x) { return !comp(x, *(j - 1)); });
+                right_wins = i - next_i;
+                k = std::move_backward(next_i, i, k);
+                i = next_i;
+            }
+        }
+
+        // As for merging forwards, with the runs swapped
+        SORT_COUNT_OPERATION(moves, (last - middle) * 2 + (middle - j));
+        std::move_backward(buffer, i, k);
+    }
+}
+
+/*
+ * @brief Supporting function for powersort, to find the end of the natural run at first, reversing it if it
+ * descends
+ *
+ * Only strictly descending runs are reversed, so equal elements keep their order.
+ * @param[in]  first  iterator to start of run
+ * @param[in]  last  iterator to end of range (exclusive)
+ * @param[in]  comp  comparator returning true if the first argument orders before the second
+ * @return  iterator to end of run, which is sorted
+ * */
+template <typename RandomIt, typename Compare>
+RandomIt find_run(RandomIt first, RandomIt last, Compare comp) {
+    RandomIt end = first + 1;
+    if (end == last) return end;
+
+    if (comp(*end, *first)) {
+        while (end + 1 != last && comp(*(end + 1), *end)) ++end;
+        ++end;
+        std::reverse(first, end);
+        SORT_COUNT_OPERATION(swaps, (end - first) / 2);
+    } else {
+        while (end + 1 != last && !comp(*(end + 1), *end)) ++end;
+        ++end;
+    }
+    return end;
+}
+
+/*
+ * @brief Supporting function for powersort, to give the power of the boundary between two adjacent runs
+ *
+ * The power is the depth, in a perfectly balanced binary tree over [0, n), of the node splitting the midpoints of
+ * the runs: the first bit at which the binary fractions midpoint1 / n and midpoint2 / n differ.
+ * @param[in]  start  index of the start of the first run
+ * @param[in]  n1  length of the first run
+ * @param[in]  n2  length of the second run
+ * @param[in]  n  length of the whole range
+ * @return  power of the boundary, from 1
+ * */
+inline int node_power(long long start, long long n1, long long n2, long long n) {
+    // Twice each midpoint, so they are integers
+    long long a = 2 * start + n1;
+    long long b = a + n1 + n2;
+    int power = 0;
+
+    while (true) {
+        ++power;
+        if (a >= n) {
+            a -= n;
+            b -= n;
+        } else if (b >= n) {
+            break;
+        }
+        a <<= 1;
+        b <<= 1;
+    }
+    return power;
+}
+
+/*
+ * @brief Supporting function for powersort implementation, with the comparator that is counted, if any
+ * */
+template <typename RandomIt, typename BufferIt, typename Compare>
+void powersort(RandomIt first, RandomIt last, BufferIt buffer, Compare comp) {
+    // Runs waiting to be merged, with the power of the boundary before each, which increases up the stack
+    struct Run {
+        RandomIt first;
+        RandomIt last;
+        int power;
+    };
+    std::vector<Run> stack;
+    long long n = last - first;
+
+    auto merge_top = [&]() {
+        Run right = stack.back();
+        stack.pop_back();
+        sorting::merge_galloping(stack.back().first, right.first, right.last, buffer, comp);
+        stack.back().last = right.last;
+    };
+
+    for (RandomIt start = first; start != last;) {
+        RandomIt end = sorting::find_run(start, last, comp);
+
+        // Extend short runs, so the merges at the bottom of the tree are not of a few elements each, by the same
+        // leaf sort as merge sort
+        if (end - start < POWERSORT_MIN_RUN) {
+            RandomIt extended = start + std::min<long long>(POWERSORT_MIN_RUN, last - start);
+            if (!sorting::leaf_sort(start, extended, comp)) {
+                sorting::insertion_sort(start, extended, comp);
+            }
+            end = extended;
+        }
+
+        // Merge the runs on the stack below a boundary deeper than the new one, before pushing it
+        int power = 0;
+        if (!stack.empty()) {
+            Run const &top = stack.back();
+            power = sorting::node_power(top.first - first, top.last - top.first, end - start, n);
+            while (stack.size() > 1 && stack.back().power > power) {
+                merge_top();
+            }
+        }
+        stack.push_back(Run{start, end, power});
+        start = end;
+    }
+
+    while (stack.size() > 1) {
+        merge_top();
+    }
+}
+
+/*
+ * @brief Powersort implementation: a natural merge sort that adapts to existing order
+ *
+ * The range is split into natural runs, ascending or strictly descending (which are reversed), and short runs are
+ * extended by insertion sort. Each pair of adjacent runs is merged in the order given by the power of its boundary
+ * (Munro and Wild), which keeps the merge tree close to optimal for the run lengths, with a stack of at most one
+ * run per power. The merges gallop through long stretches of one run. A sorted or reverse sorted range is a single
+ * run, sorted with n - 1 comparisons, and k sorted runs take O(n log k). A scratch buffer of half the range is
+ * allocated up front. The value type must be default constructible and move assignable.
+ * @param[in]  first  iterator to start of range to be sorted
+ * @param[in]  last  iterator to end of range to be sorted (exclusive)
+ * @param[in]  comp  comparator returning true if the first argument orders before the second
+ * */
+template <typename RandomIt, typename Compare = std::less<>>
+void powersort(RandomIt first, RandomIt last, Compare comp = Compare()) {
+    if (last - first < 2) return;
+
+    std::vector<typename std::iterator_traits<RandomIt>::value_type> buffer((last - first + 1) / 2);
+#ifdef SORT_COUNT_OPERATIONS
+    // Count every comparison, including those of finding the runs and galloping
+    long long compared = 0;
+    auto counted = [&](auto const &a, auto const &b) {
+        ++compared;
+        return comp(a, b);
+    };
+    sorting::powersort(first, last, buffer.begin(), counted);
+    SORT_COUNT_OPERATION(comparisons, compared);
+#else
+    sorting::powersort(first, last, buffer.begin(), comp);
+#endif
+}
+
+/*
+ * @brief Supporting partition function for quicksort implementation
+ *
+ * @param[in]  first  iterator to start of range to be partitioned
+ * @param[in]  last  iterator to end of range to be partitioned (exclusive), where *(last - 1) is the pivot
+ * @param[in]  comp  comparator returning true if the first argument orders before the second
+ * @return  iterator to the pivot, after partitioning
+ * */
+template <typename RandomIt, typename Compare = std::less<>>
+RandomIt partition(RandomIt first, RandomIt last, Compare comp = Compare()) {
+    RandomIt pivot = last - 1;
+
+    // Start with pivot position (q) at start of range
+    RandomIt q = first;
+
+    // Iterate over the unpartitioned range [u, pivot), and swap each element that does not order after the pivot
+    // into the current pivot position, then advance the pivot position to the next element.
+    for (RandomIt u = first; u != pivot; ++u) {
+        if (!comp(*pivot, *u)) {
+            std::iter_swap(q, u);
+            ++q;
+        }
+    }
+
+    // One comparison per element, and one swap per element ordering before the pivot, plus the pivot swap
+    SORT_COUNT_OPERATION(comparisons, pivot - first);
+    SORT_COUNT_OPERATION(swaps, q - first + 1);
+
+    // Finally, move the pivot value to position q
+    std::iter_swap(q, pivot);
+
+    return q;
+}
+
+/*
+ * @brief Quicksort implementation
+ *
+ * @param[in]  first  iterator to start of range to be sorted
+ * @param[in]  last  iterator to end of range to be sorted (exclusive)
+ * @param[in]  comp  comparator returning true if the first argument orders before the second
+ * */
+template <typename RandomIt, typename Compare = std::less<>>
+void quicksort(RandomIt first, RandomIt last, Compare comp = Compare()) {
+    // Small ranges (including the trivial one or zero elements) are cheaper to sort in place
+    if (sorting::leaf_sort(first, last, comp)) return;
+
+    // Partition the range in-place and return the chosen pivot q
+    RandomIt q = sorting::partition(first, last, comp);
+
+    // Recursively sort each range [first, q) and [q + 1, last)
+    sorting::quicksort(first, q, comp);
+    sorting::quicksort(q + 1, last, comp);
+}
+
+} // namespace sorting
+
+#endif //SORT_SORT_HPP
@@ -1,10 +1,44 @@
 #include <algorithm>
-#include <chrono>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <functional>
 #include <iostream>
-#include <climits>
+#include <new>
 #include <numeric>
+#include <string>
+#include <thread>
 #include <vector>
+#include "../include/benchmark.hpp"
+#include "../include/randgen.hpp"
+#include "../include/taskpool.hpp"
+#include "include/external.hpp"
+#include "include/sort.hpp"
+
+// Subarrays at or below this size are sorted serially by the parallel sorts
+const int PARALLEL_GRAIN_SIZE = 1 << 14;
+
+// Count of heap allocations, used to report the allocations made by each sort
+std::atomic<long> allocation_count{0};
+
+void *operator new(std::size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void *ptr = std::malloc(size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
 
 /*
  * @brief Parse argument to extract user array size
@@ -63,6 +97,99 @@ int get_repeat_count(char* param) {
     return (int)repeat_count;
 }
 
+/*
+ * @brief Parse argument to extract user thread count
+ *
+ * @param[in]  param  argv element corresponding to thread count
+ * @return  (int)thread_count  parsed thread count, casted to int
+ * */
+int get_thread_count(char* param) {
+    char *endptr;
+    long thread_count;
+
+    errno = 0;
+    thread_count = std::strtol(param, &endptr, 10);
+
+    if (errno != 0) {
+        perror("strtol");
+        exit(EXIT_FAILURE);
+    }
+
+    if (endptr == param) {
+        std::cerr << "could not parse thread_count as an integer" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    if (thread_count < 1) {
+        std::cerr << "thread_count parameter must be >= 1" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    return (int)thread_count;
+}
+
+/*
+ * @brief Parse argument to extract user memory limit of the external sort
+ *
+ * @param[in]  param  argv element corresponding to memory limit, in MB
+ * @return  memory limit in bytes
+ * */
+std::size_t get_memory_limit(char* param) {
+    char *endptr;
+    long memory_mb;
+
+    errno = 0;
+    memory_mb = std::strtol(param, &endptr, 10);
+
+    if (errno != 0) {
+        perror("strtol");
+        exit(EXIT_FAILURE);
+    }
+
+    if (endptr == param) {
+        std::cerr << "could not parse memory_mb as an integer" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    if (memory_mb < 1) {
+        std::cerr << "memory_mb parameter must be >= 1" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    return (std::size_t)memory_mb << 20;
+}
+
+/*
+ * @brief Parse argument to extract user number of keys of a generated key file
+ *
+ * @param[in]  param  argv element corresponding to key count
+ * @return  key_count  parsed key count
+ * */
+long long get_key_count(char* param) {
+    char *endptr;
+    long long key_count;
+
+    errno = 0;
+    key_count = std::strtoll(param, &endptr, 10);
+
+    if (errno != 0) {
+        perror("strtoll");
+        exit(EXIT_FAILURE);
+    }
+
+    if (endptr == param) {
+        std::cerr << "could not parse key_count as an integer" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    if (key_count < 0) {
+        std::cerr << "key_count parameter must be >= 0" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    return key_count;
+}
+
 /*
  * @brief Selection sort implementation
  *
@@ -84,135 +211,569 @@ void selection_sort(std::vector<int> &A, int n) {
 }
 
 /*
- * @brief Insertion sort implementation
+ * @brief Supporting function for buffered merge sort implementation
  *
- * @param[in]  A  reference to vector of ints to be sorted
- * @param[in]  n  size of vector
+ * Merge the sorted subarrays src[p..q] and src[q+1..r] into dst[p..r], without sentinels or allocation
+ * @param[in]  src  reference to vector of ints, where subarrays src[p..q] and src[q+1..r] are assumed sorted
+ * @param[out]  dst  reference to vector of ints, where the merged dst[p..r] is written
+ * @param[in]  p  index of subarrays of src (src[p..q] and src[q+1..r])
+ * @param[in]  q  index of subarrays of src (src[p..q] and src[q+1..r])
+ * @param[in]  r  index of subarrays of src (src[p..q] and src[q+1..r])
  * */
-void insertion_sort(std::vector<int> &A, int n) {
-    int key;
-    int j;
-
-    for(int i=1; i<n; i++) {
-        key = A[i];
-        j = i - 1;
-        while (j>=0 && A[j]>key) {
-            A[j+1] = A[j];
-            j--;
+void merge_into(std::vector<int> const &src, std::vector<int> &dst, int p, int q, int r) {
+    int i = p;
+    int j = q + 1;
+    int k = p;
+
+    // Merge while both subarrays have remaining elements
+    while (i <= q && j <= r) {
+        if (src[i] <= src[j]) {
+            dst[k++] = src[i++];
+        } else {
+            dst[k++] = src[j++];
         }
-        A[j+1] = key;
     }
+    SORT_COUNT_OPERATION(comparisons, k - p);
+    SORT_COUNT_OPERATION(moves, r - p + 1);
+
+    // Copy across whichever subarray still has remaining elements
+    while (i <= q) {
+        dst[k++] = src[i++];
+    }
+    while (j <= r) {
+        dst[k++] = src[j++];
+    }
+}
+
+/*
+ * @brief Supporting recursive function for buffered merge sort implementation
+ *
+ * Sort the subarray [p..r] into dst, using src as the merge source. On entry src[p..r] and dst[p..r] must hold
+ * the same values. Each level of recursion swaps the roles of src and dst, so the sorted halves always end up in
+ * src, ready to be merged into dst, and no copying back is needed.
+ * @param[in]  src  reference to vector of ints used as merge source
+ * @param[out]  dst  reference to vector of ints, where the sorted dst[p..r] is written
+ * @param[in]  p  start index of subarray
+ * @param[in]  r  end index of subarray
+ * */
+void merge_sort_ping_pong(std::vector<int> &src, std::vector<int> &dst, int p, int r) {
+    // Small subarrays are cheaper to insertion sort in place
+    if (r - p < sorting::INSERTION_SORT_CUTOFF) {
+        sorting::insertion_sort(dst.begin() + p, dst.begin() + r + 1);
+        return;
+    }
+
+    // Calculate midpoint of array range
+    int q = (p + r) / 2;
+
+    // Recursively sort each subarray [p..q] and [q+1..r] into src
+    merge_sort_ping_pong(dst, src, p, q);
+    merge_sort_ping_pong(dst, src, q+1, r);
+
+    // Finally, merge sorted subarrays of src into dst
+    merge_into(src, dst, p, q, r);
+}
+
+/*
+ * @brief Buffered merge sort implementation, using a caller supplied scratch buffer
+ *
+ * As for merge sort, but merging ping-pongs between A and a single scratch buffer, rather than allocating new
+ * subarrays on every merge. The scratch buffer is only resized if it is smaller than A, so reusing it across
+ * calls makes the sort allocation free.
+ * @param[in]  A  reference to vector of ints to be sorted
+ * @param[in]  scratch  reference to vector of ints used as scratch buffer
+ * */
+void merge_sort_buffered(std::vector<int> &A, std::vector<int> &scratch) {
+    if (A.size() < 2) return;
+
+    if (scratch.size() < A.size()) {
+        scratch.resize(A.size());
+    }
+
+    // Both buffers must start with the same values
+    std::copy(A.begin(), A.end(), scratch.begin());
+
+    merge_sort_ping_pong(scratch, A, 0, A.size()-1);
+}
+
+/*
+ * @brief Buffered merge sort implementation, allocating one scratch buffer per call
+ *
+ * @param[in]  A  reference to vector of ints to be sorted
+ * */
+void merge_sort_buffered(std::vector<int> &A) {
+    std::vector<int> scratch(A.size());
+    merge_sort_buffered(A, scratch);
+}
+
+/*
+ * @brief Supporting function for hardened quicksort, returning the index of the median of A[a], A[b] and A[c]
+ *
+ * @param[in]  A  reference to vector of ints
+ * @param[in]  a  index of first sample
+ * @param[in]  b  index of second sample
+ * @param[in]  c  index of third sample
+ * @return  index of median sample
+ * */
+int median_of_three(std::vector<int> const &A, int a, int b, int c) {
+    if (A[a] < A[b]) {
+        if (A[b] < A[c]) return b;
+        return (A[a] < A[c]) ? c : a;
+    }
+    if (A[a] < A[c]) return a;
+    return (A[b] < A[c]) ? c : b;
 }
 
 /*
- * @brief Supporting function for merge sort implementation
+ * @brief Supporting function for hardened quicksort, to choose a pivot index for subarray A[p..r]
  *
- * @param[in]  A  reference to vector of ints, where subarrays
- *                A[p..q] and A[q+1..r] are assumed sorted
- * @param[in]  p  index of subarrays of A (A[p..q] and A[q+1..r])
- * @param[in]  q  index of subarrays of A (A[p..q] and A[q+1..r])
- * @param[in]  r  index of subarrays of A (A[p..q] and A[q+1..r])
+ * Small subarrays use the median of the first, middle and last elements. Larger subarrays use Tukey's ninther
+ * (the median of three medians of three), which is much more robust against sorted and patterned input.
+ * @param[in]  A  reference to vector of ints
+ * @param[in]  p  start index of subarray of A
+ * @param[in]  r  end index of subarray of A
+ * @return  index of chosen pivot
+ * */
+int choose_pivot(std::vector<int> const &A, int p, int r) {
+    int n = r - p + 1;
+    int q = p + n / 2;
+
+    if (n < 128) {
+        return median_of_three(A, p, q, r);
+    }
+
+    int s = n / 8;
+    return median_of_three(A,
+                           median_of_three(A, p, p + s, p + 2 * s),
+                           median_of_three(A, q - s, q, q + s),
+                           median_of_three(A, r - 2 * s, r - s, r));
+}
+
+/*
+ * @brief Supporting three-way (Dutch national flag) partition function for hardened quicksort
+ *
+ * Partition A[p..r] around the value of A[pivot], into A[p..lt-1] < pivot, A[lt..gt] == pivot and
+ * A[gt+1..r] > pivot. Runs of elements equal to the pivot are excluded from further recursion, so input with
+ * many duplicates is not quadratic. Uses the Bentley-McIlroy scheme, which scans inwards from both ends as for
+ * a Hoare partition and parks equal elements at the ends until the scans cross, so that input with few
+ * duplicates costs little more than a two-way partition.
+ * @param[in]  A  reference to vector of ints
+ * @param[in]  p  start index of subarray of A
+ * @param[in]  r  end index of subarray of A
+ * @param[in]  pivot  index of pivot element
+ * @param[out]  lt  index of first element equal to the pivot
+ * @param[out]  gt  index of last element equal to the pivot
  * */
-void merge(std::vector<int> &A, int p, int q, int r) {
-    // Calculate sizes of each subarray A[p..q] and A[q+1..r]
-    int n1 = q - p + 1;
-    int n2 = r - q;
+void partition_three_way(std::vector<int> &A, int p, int r, int pivot, int &lt, int &gt) {
+    // Move the pivot to the start of the subarray
+    std::swap(A[p], A[pivot]);
+    int x = A[p];
+
+    // Invariant: A[p..pe] == x, A[pe+1..i] < x, A[j..qe-1] > x and A[qe..r] == x
+    int i = p;
+    int j = r + 1;
+    int pe = p;
+    int qe = r + 1;
+
+    while (true) {
+        while (A[++i] < x) {
+            if (i == r) break;
+        }
+        while (x < A[--j]) {
+            if (j == p) break;
+        }
+
+        // Scans have crossed
+        if (i == j && A[i] == x) {
+            std::swap(A[++pe], A[i]);
+        }
+        if (i >= j) break;
 
-    // Create a copy of subarray B = A[p..q], terminated with MAX_INT
-    std::vector<int> B(n1+1); // Allocate extra element for MAX_INT
-    for(int i=p; i<=q; i++) {
-        B[i - p] = A[i];
+        std::swap(A[i], A[j]);
+        if (A[i] == x) std::swap(A[++pe], A[i]);
+        if (A[j] == x) std::swap(A[--qe], A[j]);
     }
-    B[n1] = INT_MAX;
 
-    // Create a copy of subarray C = A[q+1..r], terminated with MAX_INT
-    std::vector<int> C(n2+1); // Allocate extra element for MAX_INT
-    for(int i=q+1; i<=r; i++) {
-        C[i - (q + 1)] = A[i];
+    // Swap the equal elements parked at either end into the middle
+    i = j + 1;
+    for (int k = p; k <= pe; k++) {
+        std::swap(A[k], A[j--]);
     }
-    C[n2] = INT_MAX;
+    for (int k = r; k >= qe; k--) {
+        std::swap(A[k], A[i++]);
+    }
+
+    lt = j + 1;
+    gt = i - 1;
+}
+
+/*
+ * @brief Heapsort implementation over the subarray A[p..r]
+ *
+ * Used by hardened quicksort as a guaranteed O(n log n) fallback, when its recursion depth limit is reached.
+ * @param[in]  A  reference to vector of ints to be sorted
+ * @param[in]  p  start index of subarray of A
+ * @param[in]  r  end index of subarray of A
+ * */
+void heapsort(std::vector<int> &A, int p, int r) {
+    int n = r - p + 1;
+
+    // Restore the max heap property for the heap A[p..p+size-1], below the (relative) node i
+    auto sift_down = [&](int i, int size) {
+        int x = A[p + i];
+        while (2 * i + 1 < size) {
+            int child = 2 * i + 1;
+            if (child + 1 < size && A[p + child + 1] > A[p + child]) {
+                child++;
+            }
+            if (A[p + child] <= x) break;
+            A[p + i] = A[p + child];
+            i = child;
+        }
+        A[p + i] = x;
+    };
 
-    // Merge and sort subarrays B and C into A[p..r]
-    int i=0;
-    int j=0;
+    // Build max heap, then repeatedly move the maximum to the end of the shrinking heap
+    for (int i = n / 2 - 1; i >= 0; i--) {
+        sift_down(i, n);
+    }
+    for (int size = n - 1; size > 0; size--) {
+        std::swap(A[p], A[p + size]);
+        sift_down(0, size);
+    }
+}
 
-    for(int k=p; k<=r; k++) {
-        if (B[i] <= C[j]) {
-            A[k] = B[i++];
+/*
+ * @brief Supporting recursive function for hardened quicksort implementation
+ *
+ * @param[in]  A  reference to vector of ints to be sorted
+ * @param[in]  p  start index of subarray of A
+ * @param[in]  r  end index of subarray of A
+ * @param[in]  depth_limit  remaining partitioning depth before falling back to heapsort
+ * */
+void introsort(std::vector<int> &A, int p, int r, int depth_limit) {
+    while (r - p >= sorting::INSERTION_SORT_CUTOFF) {
+        // Too many unbalanced partitions, so fall back to heapsort to guarantee O(n log n)
+        if (depth_limit == 0) {
+            heapsort(A, p, r);
+            return;
+        }
+        depth_limit--;
+
+        int lt, gt;
+        partition_three_way(A, p, r, choose_pivot(A, p, r), lt, gt);
+
+        // Recurse into the smaller side and loop on the larger, so stack depth is at most O(log n)
+        if (lt - p < r - gt) {
+            introsort(A, p, lt - 1, depth_limit);
+            p = gt + 1;
         } else {
-            A[k] = C[j++];
+            introsort(A, gt + 1, r, depth_limit);
+            r = lt - 1;
         }
     }
+
+    // Small subarrays are cheaper to insertion sort in place
+    sorting::insertion_sort(A.begin() + p, A.begin() + r + 1);
 }
 
 /*
- * @brief Merge sort implementation
+ * @brief Hardened quicksort (introsort) implementation
  *
+ * As for quicksort, but with median of three / ninther pivot selection, three-way partitioning of duplicates,
+ * and a heapsort fallback once the recursion depth exceeds 2 log2(n), so worst case input (sorted, reversed or
+ * all equal) remains O(n log n) and cannot overflow the stack.
  * @param[in]  A  reference to vector of ints to be sorted
  * @param[in]  p  start index of subarray of A
  * @param[in]  r  end index of subarray of A
  * */
-void merge_sort(std::vector<int> &A, int p, int r) {
-    // Trivial basecase for one or zero elements, as they are "sorted"
-    if (p >= r) return;
+void hardened_quicksort(std::vector<int> &A, int p, int r) {
+    int depth_limit = 0;
+    for (int n = r - p + 1; n > 1; n >>= 1) {
+        depth_limit += 2;
+    }
+
+    introsort(A, p, r, depth_limit);
+}
+
+/*
+ * @brief Supporting function for radix sort, to extract the digit (byte) d of an int key
+ *
+ * The sign bit is flipped, so that negative keys order before positive keys when sorted as unsigned digits.
+ * @param[in]  x  key
+ * @param[in]  d  index of digit, from 0 (least significant) to 3 (most significant)
+ * @return  digit value in range [0..255]
+ * */
+inline unsigned radix_digit(int x, int d) {
+    return (((unsigned)x ^ 0x80000000u) >> (8 * d)) & 0xffu;
+}
+
+/*
+ * @brief Supporting function for radix sort, to apply one stable counting sort pass per digit
+ *
+ * Sort the range [lo..hi) of A by the digits first_digit..last_digit, least significant first, ping-ponging
+ * between A and B. The histograms for all digits are counted in a single pass up front, and any digit for which
+ * every key falls into the same bucket is skipped.
+ * @param[in]  A  reference to vector of ints, holding the range to be sorted
+ * @param[in]  B  reference to vector of ints, used as scratch buffer for the range
+ * @param[in]  lo  start index of range (inclusive)
+ * @param[in]  hi  end index of range (exclusive)
+ * @param[in]  first_digit  least significant digit to sort by
+ * @param[in]  last_digit  most significant digit to sort by
+ * @return  true if the sorted range was left in B, or false if in A
+ * */
+bool radix_passes(std::vector<int> &A, std::vector<int> &B, int lo, int hi, int first_digit, int last_digit) {
+    std::array<std::array<int, 256>, 4> count = {};
+
+    // Histogram of every digit in one pass over the keys
+    for (int i = lo; i < hi; i++) {
+        for (int d = first_digit; d <= last_digit; d++) {
+            count[d][radix_digit(A[i], d)]++;
+        }
+    }
+
+    std::vector<int> *src = &A;
+    std::vector<int> *dst = &B;
+
+    for (int d = first_digit; d <= last_digit; d++) {
+        // Every key has the same digit, so this pass would not change the order
+        if (count[d][radix_digit(A[lo], d)] == hi - lo) continue;
+
+        // Exclusive prefix sum converts digit counts into output offsets
+        std::array<int, 256> offset;
+        int total = lo;
+        for (int k = 0; k < 256; k++) {
+            offset[k] = total;
+            total += count[d][k];
+        }
+
+        // Stable scatter of keys into their digit buckets
+        for (int i = lo; i < hi; i++) {
+            int x = (*src)[i];
+            (*dst)[offset[radix_digit(x, d)]++] = x;
+        }
+
+        std::swap(src, dst);
+    }
+
+    return src == &B;
+}
+
+/*
+ * @brief LSD radix sort implementation for ints
+ *
+ * Least significant digit first radix sort, with four passes of 8-bit digits, using a caller supplied scratch
+ * buffer (resized if smaller than A).
+ * @param[in]  A  reference to vector of ints to be sorted
+ * @param[in]  scratch  reference to vector of ints used as scratch buffer
+ * */
+void radix_sort_lsd(std::vector<int> &A, std::vector<int> &scratch) {
+    if (A.size() < 2) return;
+
+    if (scratch.size() < A.size()) {
+        scratch.resize(A.size());
+    }
+
+    if (radix_passes(A, scratch, 0, A.size(), 0, 3)) {
+        std::copy(scratch.begin(), scratch.begin() + A.size(), A.begin());
+    }
+}
+
+/*
+ * @brief MSD radix sort implementation for ints
+ *
+ * Scatter keys into 256 buckets by their most significant digit, then LSD radix sort each bucket by the three
+ * remaining digits. At large n each bucket is 1/256 of the array, so the remaining passes run in cache rather
+ * than streaming the whole array through memory three more times. Small buckets are insertion sorted.
+ * @param[in]  A  reference to vector of ints to be sorted
+ * @param[in]  scratch  reference to vector of ints used as scratch buffer
+ * */
+void radix_sort_msd(std::vector<int> &A, std::vector<int> &scratch) {
+    int n = A.size();
+    if (n < 2) return;
+
+    if ((int)scratch.size() < n) {
+        scratch.resize(n);
+    }
+
+    // Histogram of the most significant digit, converted into bucket start offsets
+    std::array<int, 257> offset = {};
+    for (int i = 0; i < n; i++) {
+        offset[radix_digit(A[i], 3) + 1]++;
+    }
+    for (int k = 0; k < 256; k++) {
+        offset[k + 1] += offset[k];
+    }
+
+    // Scatter keys into their buckets in the scratch buffer
+    std::array<int, 256> next;
+    std::copy(offset.begin(), offset.begin() + 256, next.begin());
+    for (int i = 0; i < n; i++) {
+        scratch[next[radix_digit(A[i], 3)]++] = A[i];
+    }
+
+    // Sort each bucket back into A
+    for (int k = 0; k < 256; k++) {
+        int lo = offset[k];
+        int hi = offset[k + 1];
+
+        if (hi - lo <= sorting::INSERTION_SORT_CUTOFF) {
+            std::copy(scratch.begin() + lo, scratch.begin() + hi, A.begin() + lo);
+            sorting::insertion_sort(A.begin() + lo, A.begin() + hi);
+        } else if (!radix_passes(scratch, A, lo, hi, 0, 2)) {
+            std::copy(scratch.begin() + lo, scratch.begin() + hi, A.begin() + lo);
+        }
+    }
+}
+
+/*
+ * @brief Supporting function for parallel merge implementation
+ *
+ * Serially merge the sorted subarrays src[p1..r1] and src[p2..r2] into dst, starting at index p3
+ * @param[in]  src  reference to vector of ints, where subarrays src[p1..r1] and src[p2..r2] are assumed sorted
+ * @param[out]  dst  reference to vector of ints, where the merged subarray is written
+ * @param[in]  p1  start index of first subarray of src
+ * @param[in]  r1  end index of first subarray of src
+ * @param[in]  p2  start index of second subarray of src
+ * @param[in]  r2  end index of second subarray of src
+ * @param[in]  p3  start index of merged subarray in dst
+ * */
+void merge_ranges(std::vector<int> const &src, std::vector<int> &dst, int p1, int r1, int p2, int r2, int p3) {
+    SORT_COUNT_OPERATION(moves, std::max(r1 - p1 + 1, 0) + std::max(r2 - p2 + 1, 0));
+#ifdef SORT_COUNT_OPERATIONS
+    int start = p3;
+#endif
+
+    while (p1 <= r1 && p2 <= r2) {
+        if (src[p1] <= src[p2]) {
+            dst[p3++] = src[p1++];
+        } else {
+            dst[p3++] = src[p2++];
+        }
+    }
+    SORT_COUNT_OPERATION(comparisons, p3 - start);
+    while (p1 <= r1) {
+        dst[p3++] = src[p1++];
+    }
+    while (p2 <= r2) {
+        dst[p3++] = src[p2++];
+    }
+}
+
+/*
+ * @brief Parallel merge implementation
+ *
+ * Divide and conquer merge of src[p1..r1] and src[p2..r2] into dst from index p3. The median of the larger
+ * subarray is found in the smaller by binary search, which splits the merge into two independent halves that are
+ * merged in parallel, until they fall below the grain size.
+ * @param[in]  pool  task pool to run the parallel merges on
+ * @param[in]  src  reference to vector of ints, where subarrays src[p1..r1] and src[p2..r2] are assumed sorted
+ * @param[out]  dst  reference to vector of ints, where the merged subarray is written
+ * @param[in]  p1  start index of first subarray of src
+ * @param[in]  r1  end index of first subarray of src
+ * @param[in]  p2  start index of second subarray of src
+ * @param[in]  r2  end index of second subarray of src
+ * @param[in]  p3  start index of merged subarray in dst
+ * */
+void parallel_merge(TaskPool &pool, std::vector<int> const &src, std::vector<int> &dst,
+                    int p1, int r1, int p2, int r2, int p3) {
+    int n1 = r1 - p1 + 1;
+    int n2 = r2 - p2 + 1;
+
+    // Small merges are done serially
+    if (n1 + n2 <= PARALLEL_GRAIN_SIZE) {
+        merge_ranges(src, dst, p1, r1, p2, r2, p3);
+        return;
+    }
+
+    // Ensure that src[p1..r1] is the larger subarray
+    if (n1 < n2) {
+        std::swap(p1, p2);
+        std::swap(r1, r2);
+        std::swap(n1, n2);
+    }
+
+    // Split on the median of the larger subarray, and find its position in the smaller subarray
+    int q1 = (p1 + r1) / 2;
+    int q2 = std::lower_bound(src.begin() + p2, src.begin() + r2 + 1, src[q1]) - src.begin();
+    int q3 = p3 + (q1 - p1) + (q2 - p2);
+    dst[q3] = src[q1];
+
+    // Merge the elements either side of the median in parallel
+    pool.invoke([&]() { parallel_merge(pool, src, dst, p1, q1 - 1, p2, q2 - 1, p3); },
+                [&]() { parallel_merge(pool, src, dst, q1 + 1, r1, q2, r2, q3 + 1); });
+}
+
+/*
+ * @brief Supporting recursive function for parallel merge sort implementation
+ *
+ * As for merge_sort_ping_pong, but both halves are sorted in parallel, and then merged in parallel, until the
+ * subarray falls below the grain size.
+ * @param[in]  pool  task pool to run the parallel sorts on
+ * @param[in]  src  reference to vector of ints used as merge source
+ * @param[out]  dst  reference to vector of ints, where the sorted dst[p..r] is written
+ * @param[in]  p  start index of subarray
+ * @param[in]  r  end index of subarray
+ * */
+void parallel_merge_sort_ping_pong(TaskPool &pool, std::vector<int> &src, std::vector<int> &dst, int p, int r) {
+    if (r - p < PARALLEL_GRAIN_SIZE) {
+        merge_sort_ping_pong(src, dst, p, r);
+        return;
+    }
 
     // Calculate midpoint of array range
     int q = (p + r) / 2;
 
-    // Recursively sort each subarray A[p..q] and A[q+1..r]
-    merge_sort(A, p, q);
-    merge_sort(A, q+1, r);
+    // Sort each subarray [p..q] and [q+1..r] into src in parallel
+    pool.invoke([&]() { parallel_merge_sort_ping_pong(pool, dst, src, p, q); },
+                [&]() { parallel_merge_sort_ping_pong(pool, dst, src, q + 1, r); });
 
-    // Finally, merge sorted subarrays
-    merge(A, p, q, r);
+    // Finally, merge sorted subarrays of src into dst
+    parallel_merge(pool, src, dst, p, q, q + 1, r, p);
 }
 
 /*
- * @brief Supporting partition function for quicksort implementation
+ * @brief Parallel merge sort implementation
  *
- * @param[in]  A  reference to vector of ints
- * @param[in]  p  index of subarray A[p..q]
- * @param[in]  r  index of subarray A[p..q]
+ * @param[in]  pool  task pool to run the parallel sorts on
+ * @param[in]  A  reference to vector of ints to be sorted
+ * @param[in]  scratch  reference to vector of ints used as scratch buffer
  * */
-int partition(std::vector<int> &A, int p, int r) {
-    // Start with pivot index (q) at start of subarray
-    int q = p;
-
-    // Iterate over the unpartitioned subarray A[u..r-1], and compare the
-    // value of each element A[u] with the pivot A[r]. At each step, if A[u]
-    // is less than the pivot value, swap the elements into the current pivot
-    // index position and then increment the pivot index to the next element.
-    for(int u=p; u<=(r-1); u++) {
-        if (A[u] <= A[r]) {
-            std::swap(A[q], A[u]);
-            q++;
-        }
+void parallel_merge_sort(TaskPool &pool, std::vector<int> &A, std::vector<int> &scratch) {
+    if (A.size() < 2) return;
+
+    if (scratch.size() < A.size()) {
+        scratch.resize(A.size());
     }
 
-    // Finally, move the pivot value to position q, by swapping A[q] and A[r]
-    std::swap(A[q], A[r]);
+    // Both buffers must start with the same values
+    std::copy(A.begin(), A.end(), scratch.begin());
 
-    // Return the index of the pivot, where A[q] is the pivot value
-    return q;
+    parallel_merge_sort_ping_pong(pool, scratch, A, 0, A.size()-1);
 }
 
 /*
- * @brief Quicksort implementation
+ * @brief Parallel quicksort implementation
  *
+ * As for quicksort, but the subarrays either side of the pivot are sorted in parallel, until they fall below
+ * the grain size.
+ * @param[in]  pool  task pool to run the parallel sorts on
  * @param[in]  A  reference to vector of ints to be sorted
  * @param[in]  p  start index of subarray of A
  * @param[in]  r  end index of subarray of A
  * */
-void quicksort(std::vector<int> &A, int p, int r) {
-    // Trivial basecase for one or zero elements, as they are "sorted"
-    if (p >= r) return;
+void parallel_quicksort(TaskPool &pool, std::vector<int> &A, int p, int r) {
+    if (r - p < PARALLEL_GRAIN_SIZE) {
+        sorting::quicksort(A.begin() + p, A.begin() + r + 1);
+        return;
+    }
 
     // Partition A in-place and return the chosen pivot q
-    int q = partition(A, p, r);
+    int q = sorting::partition(A.begin() + p, A.begin() + r + 1) - A.begin();
 
-    // Recursively sort each subarray A[p..q-1] and A[q+1..r]
-    quicksort(A, p, q-1);
-    quicksort(A, q+1, r);
+    // Sort each subarray A[p..q-1] and A[q+1..r] in parallel
+    pool.invoke([&]() { parallel_quicksort(pool, A, p, q-1); },
+                [&]() { parallel_quicksort(pool, A, q+1, r); });
 }
 
 /*
@@ -233,135 +794,303 @@ bool verify_sorted(std::vector<int> const &A, int n) {
     return true;
 }
 
-int main(int argc, char* argv[]) {
-    // Check correct usage (e.g. 'sort 100000 5')
-    if (argc != 3) {
-        std::cerr << "Usage: " << argv[0] << " [array_size] [repeat_count]" << std::endl;
-        exit(EXIT_FAILURE);
+/*
+ * @brief Supporting function to make a check that exits if a sort failed to sort the array
+ * */
+std::function<void()> check_sorted(std::vector<int> const &arr, std::string const &name) {
+    return [&arr, name]() {
+        if (!verify_sorted(arr, arr.size())) {
+            std::cerr << name << " failure!" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    };
+}
+
+/*
+ * @brief Time each sort on arrays of random integers of one size
+ *
+ * Every run of every sort starts from the same random integers, generated once from the seed and copied in before
+ * the timed region.
+ * @param[in]  bench  benchmark harness
+ * @param[in]  pool  thread pool for the parallel sorts, which also generates the integers
+ * @param[in]  array_size  size of the arrays to be sorted
+ * @param[in]  distribution  distribution of the integers
+ * @param[in]  seed  seed of the integers
+ * */
+void run_sort_benchmarks(Benchmark &bench, TaskPool &pool, int array_size, Distribution distribution,
+                         uint64_t seed) {
+    std::vector<int> source(array_size);
+    std::vector<int> arr(array_size);
+    std::vector<int> scratch(array_size); // Scratch buffer reused across calls to buffered merge sort
+
+    fill_random_ints(source, distribution, seed, pool);
+
+    // Hardware counters are reported per element sorted
+    bench.set_counter_unit("element", array_size);
+
+    auto fill = [&arr, &source]() {
+        std::copy(source.begin(), source.end(), arr.begin());
+    };
+
+    // Time a sort that is reported with the average number of heap allocations it makes, if count_allocations, and
+    // with the comparisons, swaps and moves per element made by partition and merge, in builds with
+    // SORT_COUNT_OPERATIONS defined
+    auto run_counting = [&](std::string const &name, bool count_allocations, std::function<void()> const &sort) {
+        long allocations = 0;
+        int runs = 0;
+#ifdef SORT_COUNT_OPERATIONS
+        long long comparisons = 0, swaps = 0, moves = 0;
+        auto &counts = sorting::operation_counts;
+#endif
+        double median = bench.run(name, array_size, fill, [&]() {
+            long before = allocation_count.load(std::memory_order_relaxed);
+#ifdef SORT_COUNT_OPERATIONS
+            comparisons -= counts.comparisons.load(std::memory_order_relaxed);
+            swaps -= counts.swaps.load(std::memory_order_relaxed);
+            moves -= counts.moves.load(std::memory_order_relaxed);
+#endif
+            sort();
+#ifdef SORT_COUNT_OPERATIONS
+            comparisons += counts.comparisons.load(std::memory_order_relaxed);
+            swaps += counts.swaps.load(std::memory_order_relaxed);
+            moves += counts.moves.load(std::memory_order_relaxed);
+#endif
+            allocations += allocation_count.load(std::memory_order_relaxed) - before;
+            runs++;
+        }, check_sorted(arr, name));
+        if (runs > 0 && count_allocations) {
+            bench.metric("allocations (average per op)", (double) allocations / runs);
+        }
+#ifdef SORT_COUNT_OPERATIONS
+        if (runs > 0 && array_size > 0) {
+            double elements = (double) runs * array_size;
+            bench.metric("comparisons/element", comparisons / elements);
+            bench.metric("swaps/element", swaps / elements);
+            bench.metric("moves/element", moves / elements);
+        }
+#endif
+        return median;
+    };
+
+    bench.run("Selection sort", array_size, fill, [&]() { selection_sort(arr, array_size); },
+              check_sorted(arr, "Selection sort"));
+
+    bench.run("Insertion sort", array_size, fill, [&]() { sorting::insertion_sort(arr.begin(), arr.end()); },
+              check_sorted(arr, "Insertion sort"));
+
+    double merge_sort_median = run_counting("Merge sort", true, [&]() {
+        sorting::merge_sort(arr.begin(), arr.end());
+    });
+
+    // Natural merge sort, which is linear on sorted input and gains on any existing order
+    double powersort_median = run_counting("Powersort", true, [&]() {
+        sorting::powersort(arr.begin(), arr.end());
+    });
+    if (powersort_median > 0 && merge_sort_median > 0) {
+        bench.metric("x speedup vs merge sort", merge_sort_median / powersort_median);
     }
 
-    std::chrono::time_point<std::chrono::steady_clock> t1, t2;
-    long dt;
-    int dummy_val = 0; // Use for accumulation to prevent compiler optimising away ops
+    // One scratch allocation per call
+    run_counting("Buffered merge sort", true, [&]() { merge_sort_buffered(arr); });
 
-    int array_size = get_array_size(argv[1]);
-    int repeats = get_repeat_count(argv[2]);
-    std::vector<int> arr(array_size);
+    run_counting("Buffered merge sort (reused)", true, [&]() { merge_sort_buffered(arr, scratch); });
 
-    // Selection sort
-    dt = 0;
-    for (int i=0; i<repeats; i++) {
-        // Create a vector with random integers (seeded)
-        std::srand(42);
-        std::generate(arr.begin(), arr.end(), std::rand);
+    double quicksort_median = run_counting("Quicksort", false, [&]() {
+        sorting::quicksort(arr.begin(), arr.end());
+    });
 
-        // Sort array in place (only time the sort)
-        t1 = std::chrono::steady_clock::now();
-        selection_sort(arr, array_size);
-        t2 = std::chrono::steady_clock::now();
+    bench.run("Hardened quicksort", array_size, fill, [&]() { hardened_quicksort(arr, 0, array_size - 1); },
+              check_sorted(arr, "Hardened quicksort"));
 
-        // Accumulate measurement time
-        dt += std::chrono::duration_cast<std::chrono::microseconds>(t2-t1).count();
+    bench.run("LSD radix sort", array_size, fill, [&]() { radix_sort_lsd(arr, scratch); },
+              check_sorted(arr, "LSD radix sort"));
 
-        // Check the sort actually worked
-        if (!verify_sorted(arr, array_size)) {
-            std::cerr << "Selection sort failure!" << std::endl;
-            exit(EXIT_FAILURE);
-        }
+    bench.run("MSD radix sort", array_size, fill, [&]() { radix_sort_msd(arr, scratch); },
+              check_sorted(arr, "MSD radix sort"));
 
-        // Use values in the sorted array to prevent the compiler optimising away ops
-        dummy_val += arr[i % array_size];
+    // Parallel sorts, with speedups over their serial baselines
+    std::string threads = " (" + std::to_string(pool.size()) + " threads)";
+    bench.set_threads(pool.size());
+
+    double median = run_counting("Parallel merge sort" + threads, false, [&]() {
+        parallel_merge_sort(pool, arr, scratch);
+    });
+    if (median > 0 && merge_sort_median > 0) {
+        bench.metric("x speedup vs merge sort", merge_sort_median / median);
     }
 
-    std::cout << "Selection sort: " << ((float)dt / (1e6 * repeats)) << " s (average per op)" <<std::endl;
+    median = run_counting("Parallel quicksort" + threads, false, [&]() {
+        parallel_quicksort(pool, arr, 0, array_size - 1);
+    });
+    if (median > 0 && quicksort_median > 0) {
+        bench.metric("x speedup vs quicksort", quicksort_median / median);
+    }
 
+    bench.set_threads(1);
+    bench.set_counter_unit("op", 1);
+}
 
-    // Insertion sort
-    dt = 0;
-    for (int i=0; i<repeats; i++) {
-        // Create a vector with random integers (seeded)
-        std::srand(42);
-        std::generate(arr.begin(), arr.end(), std::rand);
+// Keys generated at once when writing a key file
+const std::size_t KEY_FILE_CHUNK_KEYS = 1 << 22;
+
+/*
+ * @brief Write a file of random keys for the external sort, one chunk at a time so any size fits in memory
+ *
+ * The keys are the same as those of an in-memory array of the same size, distribution and seed.
+ * @param[in]  pool  thread pool to generate each chunk on
+ * @param[in]  path  file to be written
+ * @param[in]  key_count  number of keys
+ * @param[in]  distribution  distribution of the keys
+ * @param[in]  seed  seed of the keys
+ * */
+void generate_key_file(TaskPool &pool, std::string const &path, long long key_count, Distribution distribution,
+                       uint64_t seed) {
+    std::FILE *file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        perror("fopen");
+        exit(EXIT_FAILURE);
+    }
 
-        // Sort array in place (only time the sort)
-        t1 = std::chrono::steady_clock::now();
-        insertion_sort(arr, array_size);
-        t2 = std::chrono::steady_clock::now();
+    std::vector<int> chunk(KEY_FILE_CHUNK_KEYS);
+    for (long long first = 0; first < key_count; first += KEY_FILE_CHUNK_KEYS) {
+        std::size_t count = std::min<long long>(KEY_FILE_CHUNK_KEYS, key_count - first);
+        int blocks = (count + FILL_GRAIN_SIZE - 1) / FILL_GRAIN_SIZE;
 
-        // Accumulate measurement time
-        dt += std::chrono::duration_cast<std::chrono::microseconds>(t2-t1).count();
+        pool.parallel_for(0, blocks, 1, [&](int lo, int hi) {
+            std::size_t begin = lo * FILL_GRAIN_SIZE;
+            std::size_t end = std::min(hi * FILL_GRAIN_SIZE, count);
+            fill_random_ints(chunk.data() + begin, first + begin, end - begin, key_count, distribution, seed);
+        });
 
-        // Check the sort actually worked
-        if (!verify_sorted(arr, array_size)) {
-            std::cerr << "Insertion sort failure!" << std::endl;
+        if (std::fwrite(chunk.data(), sizeof(int), count, file) != count) {
+            perror("fwrite");
             exit(EXIT_FAILURE);
         }
-
-        // Use values in the sorted array to prevent the compiler optimising away ops
-        dummy_val += arr[i % array_size];
     }
 
-    std::cout << "Insertion sort: " << ((float)dt / (1e6 * repeats)) << " s (average per op)" <<std::endl;
+    if (std::fclose(file) != 0) {
+        perror("fclose");
+        exit(EXIT_FAILURE);
+    }
+}
 
+/*
+ * @brief Time the external sort of a key file, writing the sorted keys next to it
+ *
+ * Each run sorts the file into path.sorted, which is checked to hold the same keys in ascending order.
+ * @param[in]  bench  benchmark harness
+ * @param[in]  pool  thread pool for run generation
+ * @param[in]  path  file of keys to be sorted
+ * @param[in]  memory_bytes  memory limit of the sort
+ * */
+void run_external_sort_benchmark(Benchmark &bench, TaskPool &pool, std::string const &path,
+                                 std::size_t memory_bytes) {
+    std::string output_path = path + ".sorted";
+    sorting::KeyFileSummary input = sorting::summarize_key_file(path);
+    sorting::ExternalSortStats stats;
+
+    bench.set_counter_unit("key", input.keys);
+    bench.set_threads(pool.size());
+
+    std::string name = "External sort (" + std::to_string(memory_bytes >> 20) + " MB memory, " +
+                       std::to_string(pool.size()) + " threads)";
+    double median = bench.run(name, input.keys, []() {}, [&]() {
+        stats = sorting::external_sort(pool, path, output_path, memory_bytes);
+    }, [&]() {
+        sorting::KeyFileSummary output = sorting::summarize_key_file(output_path);
+        if (!output.sorted || output.keys != input.keys || output.checksum != input.checksum) {
+            std::cerr << "External sort failure!" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    });
+
+    if (median > 0) {
+        bench.metric("MB/s", input.keys * sizeof(int) / 1e6 / median);
+        bench.metric("runs", stats.runs);
+        bench.metric("merge passes", stats.merge_passes);
+        bench.metric("fan-in", stats.fan_in);
+        bench.metric("run generation s", stats.run_seconds);
+        bench.metric("merge s", stats.merge_seconds);
+    }
+    std::remove(output_path.c_str());
 
-    // Merge sort
-    dt = 0;
-    for (int i=0; i<repeats; i++) {
-        // Create a vector with random integers (seeded)
-        std::srand(42);
-        std::generate(arr.begin(), arr.end(), std::rand);
+    bench.set_threads(1);
+    bench.set_counter_unit("op", 1);
+}
 
-        // Sort array in place (only time the sort)
-        t1 = std::chrono::steady_clock::now();
-        merge_sort(arr, 0, array_size-1);
-        t2 = std::chrono::steady_clock::now();
+int main(int argc, char* argv[]) {
+    BenchmarkOptions options = parse_benchmark_options(argc, argv);
+    std::string flags = " [--warmup=N] [--samples=N] [--format=text|csv|json] [--output=path] [--filter=name]"
+                        " [--counters]";
+    std::string inputs = " [--seed=N] [--input=uniform|sorted|reverse|fewunique|zipf|nearlysorted|runs]";
+
+    Distribution distribution = parse_distribution(options.input.empty() ? "uniform" : options.input);
+
+    // Write a file of random keys (e.g. 'sort generate keys.bin 1000000000')
+    if (argc >= 2 && std::strcmp(argv[1], "generate") == 0) {
+        if (argc != 4 && argc != 5) {
+            std::cerr << "Usage: " << argv[0] << " generate [file_path] [key_count] [thread_count (optional)]"
+                      << inputs << std::endl;
+            exit(EXIT_FAILURE);
+        }
 
-        // Accumulate measurement time
-        dt += std::chrono::duration_cast<std::chrono::microseconds>(t2-t1).count();
+        long long key_count = get_key_count(argv[3]);
+        int threads = (argc == 5) ? get_thread_count(argv[4]) : std::max((int)std::thread::hardware_concurrency(), 1);
+        TaskPool pool(threads);
+        generate_key_file(pool, argv[2], key_count, distribution, options.seed);
+        exit(EXIT_SUCCESS);
+    }
 
-        // Check the sort actually worked
-        if (!verify_sorted(arr, array_size)) {
-            std::cerr << "Merge sort failure!" << std::endl;
+    // Sort a file of keys in bounded memory (e.g. 'sort external keys.bin 256 3')
+    if (argc >= 2 && std::strcmp(argv[1], "external") == 0) {
+        if (argc != 5 && argc != 6) {
+            std::cerr << "Usage: " << argv[0] << " external [file_path] [memory_mb] [repeat_count] "
+                      << "[thread_count (optional)]" << flags << std::endl;
             exit(EXIT_FAILURE);
         }
 
-        // Use values in the sorted array to prevent the compiler optimising away ops
-        dummy_val += arr[i % array_size];
-    }
+        std::size_t memory_bytes = get_memory_limit(argv[3]);
+        int repeats = get_repeat_count(argv[4]);
+        int threads = (argc == 6) ? get_thread_count(argv[5]) : std::max((int)std::thread::hardware_concurrency(), 1);
 
-    std::cout << "Merge sort: " << ((float)dt / (1e6 * repeats)) << " s (average per op)" <<std::endl;
+        Benchmark bench("sort", options, repeats);
+        TaskPool pool(threads);
+        run_external_sort_benchmark(bench, pool, argv[2], memory_bytes);
 
+        bench.report();
+        exit(EXIT_SUCCESS);
+    }
 
-    // Quicksort
-    dt = 0;
-    for (int i=0; i<repeats; i++) {
-        // Create a vector with random integers (seeded)
-        std::srand(42);
-        std::generate(arr.begin(), arr.end(), std::rand);
+    // Check correct usage (e.g. 'sort 100000 5 8')
+    if (argc < 3 || argc > 4) {
+        std::cerr << "Usage: " << argv[0] << " [array_size] [repeat_count] [thread_count (optional)]" << flags
+                  << " [--sweep=sizes]" << inputs << std::endl;
+        std::cerr << "       " << argv[0] << " generate [file_path] [key_count] [thread_count (optional)]" << inputs
+                  << std::endl;
+        std::cerr << "       " << argv[0] << " external [file_path] [memory_mb] [repeat_count] "
+                  << "[thread_count (optional)]" << flags << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    int array_size = get_array_size(argv[1]);
+    int repeats = get_repeat_count(argv[2]);
+    int threads = (argc == 4) ? get_thread_count(argv[3]) : std::max((int)std::thread::hardware_concurrency(), 1);
 
-        // Sort array in place (only time the sort)
-        t1 = std::chrono::steady_clock::now();
-        quicksort(arr, 0, array_size-1);
-        t2 = std::chrono::steady_clock::now();
+    Benchmark bench("sort", options, repeats);
+    TaskPool pool(threads);
 
-        // Accumulate measurement time
-        dt += std::chrono::duration_cast<std::chrono::microseconds>(t2-t1).count();
+    bench.log() << "Sorting network kernel: " << sorting::network_sort_kernel() << std::endl;
+    bench.log() << "Input: " << (options.input.empty() ? "uniform" : options.input) << " integers, seed "
+                << options.seed << std::endl;
 
-        // Check the sort actually worked
-        if (!verify_sorted(arr, array_size)) {
-            std::cerr << "Quicksort failure!" << std::endl;
+    for (long long size: bench.sizes(array_size)) {
+        if (size < 0 || size > 100000000) {
+            std::cerr << "sweep sizes must be >= 0 and <= 100000000" << std::endl;
             exit(EXIT_FAILURE);
         }
-
-        // Use values in the sorted array to prevent the compiler optimising away ops
-        dummy_val += arr[i % array_size];
+        run_sort_benchmarks(bench, pool, size, distribution, options.seed);
     }
 
-    std::cout << "Quicksort: " << ((float)dt / (1e6 * repeats)) << " s (average per op)" <<std::endl;
-
-
-    // Dump final accumulated value to prevent compiler optimising away ops
-    std::cout << dummy_val << std::endl;
-
+    bench.report();
     exit(EXIT_SUCCESS);
 }
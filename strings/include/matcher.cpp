@@ -0,0 +1,292 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+#include "matcher.hpp"
+
+// Identifies a file written by CompiledMatcher::save, including the format version
+static const char MATCHER_MAGIC[8] = {'F', 'A', 'M', 'A', 'T', 'C', 'H', '1'};
+
+std::vector<int> compute_prefix_function(std::string const &P) {
+    int m = P.size();
+    std::vector<int> prefix(m + 1, 0);
+
+    for (int q = 2; q <= m; q++) {
+        int k = prefix[q - 1];
+        while (k > 0 && P[k] != P[q - 1]) {
+            k = prefix[k];
+        }
+        prefix[q] = (P[k] == P[q - 1]) ? k + 1 : 0;
+    }
+    return prefix;
+}
+
+std::size_t CompiledMatcher::block_size(std::size_t pattern_length, std::size_t width) {
+    return sizeof(Header) + 256 * sizeof(uint16_t) + (pattern_length + 1) * width * sizeof(uint16_t) + pattern_length;
+}
+
+void CompiledMatcher::attach(unsigned char const *data) {
+    header = reinterpret_cast<Header const *>(data);
+    char_index = reinterpret_cast<uint16_t const *>(data + sizeof(Header));
+    table = char_index + 256;
+    pattern = reinterpret_cast<unsigned char const *>(table + (header->pattern_length + 1) * header->width);
+}
+
+CompiledMatcher CompiledMatcher::compile(std::string const &P) {
+    if ((int) P.size() > MAX_PATTERN_LENGTH) {
+        std::cerr << "Error: pattern must be <= " << MAX_PATTERN_LENGTH << " chars to compile" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    int m = P.size();
+
+    // Assign a column to each unique byte in the pattern, after column 0 for all other bytes
+    uint16_t columns[256] = {0};
+    uint32_t width = 1;
+    for (unsigned char c: P) {
+        if (columns[c] == 0) {
+            columns[c] = width++;
+        }
+    }
+
+    CompiledMatcher matcher;
+    matcher.storage = std::vector<unsigned char>(block_size(m, width));
+    unsigned char *data = matcher.storage.data();
+
+    Header header{};
+    std::memcpy(header.magic, MATCHER_MAGIC, sizeof(MATCHER_MAGIC));
+    header.pattern_length = m;
+    header.width = width;
+    std::memcpy(data, &header, sizeof(Header));
+    std::memcpy(data + sizeof(Header), columns, sizeof(columns));
+    matcher.attach(data);
+
+    fill_state_table(P, width, [&columns](char c) { return (int) columns[(unsigned char) c]; },
+                     const_cast<uint16_t *>(matcher.table));
+    std::memcpy(const_cast<unsigned char *>(matcher.pattern), P.data(), m);
+
+    return matcher;
+}
+
+CompiledMatcher CompiledMatcher::load(std::string const &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        perror("open");
+        exit(EXIT_FAILURE);
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        perror("fstat");
+        exit(EXIT_FAILURE);
+    }
+
+    std::size_t size = st.st_size;
+    if (size < sizeof(Header) + 256 * sizeof(uint16_t)) {
+        std::cerr << "Error: " << path << " is not a compiled matcher" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        perror("mmap");
+        exit(EXIT_FAILURE);
+    }
+
+    Header const *header = static_cast<Header const *>(mapping);
+    if (std::memcmp(header->magic, MATCHER_MAGIC, sizeof(MATCHER_MAGIC)) != 0 ||
+        header->pattern_length > (uint32_t) MAX_PATTERN_LENGTH || header->width < 1 || header->width > 257 ||
+        block_size(header->pattern_length, header->width) != size) {
+        std::cerr << "Error: " << path << " is not a compiled matcher" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    CompiledMatcher matcher;
+    matcher.mapping = mapping;
+    matcher.mapping_size = size;
+    matcher.attach(static_cast<unsigned char const *>(mapping));
+    return matcher;
+}
+
+CompiledMatcher::CompiledMatcher(CompiledMatcher &&other) noexcept {
+    *this = std::move(other);
+}
+
+CompiledMatcher &CompiledMatcher::operator=(CompiledMatcher &&other) noexcept {
+    if (this != &other) {
+        if (mapping != nullptr) {
+            munmap(mapping, mapping_size);
+        }
+        storage = std::move(other.storage);
+        mapping = std::exchange(other.mapping, nullptr);
+        mapping_size = std::exchange(other.mapping_size, 0);
+        header = std::exchange(other.header, nullptr);
+        char_index = std::exchange(other.char_index, nullptr);
+        table = std::exchange(other.table, nullptr);
+        pattern = std::exchange(other.pattern, nullptr);
+    }
+    return *this;
+}
+
+CompiledMatcher::~CompiledMatcher() {
+    if (mapping != nullptr) {
+        munmap(mapping, mapping_size);
+    }
+}
+
+void CompiledMatcher::save(std::string const &path) const {
+    std::FILE *file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        perror("fopen");
+        exit(EXIT_FAILURE);
+    }
+
+    std::size_t size = block_size(header->pattern_length, header->width);
+    if (std::fwrite(header, 1, size, file) != size || std::fclose(file) != 0) {
+        perror("fwrite");
+        exit(EXIT_FAILURE);
+    }
+}
+
+int CompiledMatcher::pattern_length() const {
+    return header->pattern_length;
+}
+
+int CompiledMatcher::width() const {
+    return header->width;
+}
+
+unsigned char CompiledMatcher::first_char() const {
+    return pattern[0];
+}
+
+uint16_t const *CompiledMatcher::char_index_data() const {
+    return char_index;
+}
+
+uint16_t const *CompiledMatcher::table_data() const {
+    return table;
+}
+
+std::vector<int> compiled_string_matcher(std::string const &T, CompiledMatcher const &matcher) {
+    std::vector<int> shifts;
+    matcher.scan(reinterpret_cast<unsigned char const *>(T.data()), T.size(), 0, 0,
+                 [&shifts](long long shift) { shifts.push_back(shift); });
+    return shifts;
+}
+
+/*
+ * @brief Supporting function to map a whole file read-only into memory
+ *
+ * @param[in]  path  path of file to be mapped
+ * @param[out]  size  size of the file in bytes
+ * @return  pointer to the mapping, or nullptr for an empty file
+ * */
+static unsigned char const *map_file(std::string const &path, std::size_t &size) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        perror("open");
+        exit(EXIT_FAILURE);
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        perror("fstat");
+        exit(EXIT_FAILURE);
+    }
+
+    size = st.st_size;
+    if (size == 0) {
+        close(fd);
+        return nullptr;
+    }
+
+    void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        perror("mmap");
+        exit(EXIT_FAILURE);
+    }
+
+    // The file is read once from start to end, so the kernel can read ahead aggressively
+    madvise(mapping, size, MADV_SEQUENTIAL);
+    return static_cast<unsigned char const *>(mapping);
+}
+
+long long scan_file(CompiledMatcher const &matcher, std::string const &path, std::size_t chunk_size,
+                    MatchCallback const &on_match) {
+    std::FILE *file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        perror("fopen");
+        exit(EXIT_FAILURE);
+    }
+
+    std::vector<unsigned char> chunk(chunk_size);
+    long long offset = 0;
+    int state = 0;
+
+    while (true) {
+        std::size_t bytes = std::fread(chunk.data(), 1, chunk_size, file);
+        if (bytes == 0) {
+            break;
+        }
+        state = matcher.scan(chunk.data(), bytes, state, offset, on_match);
+        offset += bytes;
+    }
+
+    if (std::ferror(file)) {
+        perror("fread");
+        exit(EXIT_FAILURE);
+    }
+    std::fclose(file);
+
+    return offset;
+}
+
+long long scan_file_mapped(CompiledMatcher const &matcher, std::string const &path, MatchCallback const &on_match) {
+    std::size_t size;
+    unsigned char const *data = map_file(path, size);
+
+    if (data != nullptr) {
+        matcher.scan(data, size, 0, 0, on_match);
+        munmap(const_cast<unsigned char *>(data), size);
+    }
+    return size;
+}
+
+long long scan_file_parallel(TaskPool &pool, CompiledMatcher const &matcher, std::string const &path, int shard_count,
+                             ShardMatchCallback const &on_match) {
+    std::size_t size;
+    unsigned char const *data = map_file(path, size);
+    if (data == nullptr) {
+        return 0;
+    }
+
+    long long overlap = std::max(matcher.pattern_length() - 1, 0);
+    long long m = matcher.pattern_length();
+
+    pool.parallel_for(0, shard_count, 1, [&](int lo, int hi) {
+        for (int shard = lo; shard < hi; shard++) {
+            long long begin = (long long) size * shard / shard_count;
+            long long end = (long long) size * (shard + 1) / shard_count;
+            long long start = std::max(begin - overlap, 0LL);
+
+            // Matches ending before the start of the shard belong to the previous shard
+            matcher.scan(data + start, end - start, 0, start, [&](long long position) {
+                if (position + m - 1 >= begin) {
+                    on_match(shard, position);
+                }
+            });
+        }
+    });
+
+    munmap(const_cast<unsigned char *>(data), size);
+    return size;
+}
@@ -0,0 +1,219 @@
+#ifndef STRINGS_MATCHER_HPP
+#define STRINGS_MATCHER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+#include "../../include/taskpool.hpp"
+
+/*
+ * @brief Compute the prefix function of a pattern
+ *
+ * @param[in]  P  pattern string
+ * @return  vector of length |P| + 1, where element q is the length of the longest proper prefix of P that is also a
+ *          suffix of the first q chars of P
+ * */
+std::vector<int> compute_prefix_function(std::string const &P);
+
+/*
+ * @brief Fill the next state table of the finite automaton for a pattern from its prefix function
+ *
+ * A mismatch in state q behaves exactly as the same char read in state prefix[q], which has already been computed,
+ * so each row is a copy of that row apart from the transition on the next char of the pattern, in O(m |Sigma|)
+ * time. Shared by StateTable, DenseStateTable and CompiledMatcher, which differ only in their column mapping and
+ * state type.
+ * @param[in]  P  pattern string
+ * @param[in]  width  number of columns of the table
+ * @param[in]  column_of  called as column_of(c) for each char c of P, returning its column, or -1 if it has none
+ * @param[out]  next_state  table of (|P| + 1) * width states, in row-major order
+ * */
+template <typename State, typename ColumnOf>
+void fill_state_table(std::string const &P, int width, ColumnOf const &column_of, State *next_state) {
+    int m = P.size();
+    std::vector<int> prefix = compute_prefix_function(P);
+
+    for (int state = 0; state <= m; state++) {
+        for (int c = 0; c < width; c++) {
+            next_state[state * width + c] = (state == 0) ? 0 : next_state[prefix[state] * width + c];
+        }
+
+        if (state < m) {
+            int column = column_of(P[state]);
+            if (column >= 0) {
+                next_state[state * width + column] = state + 1;
+            }
+        }
+    }
+}
+
+/*
+ * @brief Finite automaton string matcher compiled from a pattern alone.
+ *
+ * Covers the full byte range, so it can scan any input: each byte is remapped to a column through a 256-entry
+ * array, with column 0 shared by every byte that is not in the pattern, and next states are stored as uint16_t
+ * (so patterns may be up to 65534 chars). The whole automaton lives in one contiguous block, which save writes
+ * straight to a file and load maps read-only back into memory, so a matcher can be compiled once, then loaded at
+ * startup without being rebuilt. The file is in the native byte order. A matcher is never modified after it is
+ * built, so one instance can be shared by any number of threads scanning different inputs.
+ * */
+class CompiledMatcher {
+public:
+    // Longest pattern that can be compiled
+    static const int MAX_PATTERN_LENGTH = 65534;
+
+    // Compile the automaton for pattern P
+    static CompiledMatcher compile(std::string const &P);
+
+    // Map a compiled automaton, written by save, read-only from a file
+    static CompiledMatcher load(std::string const &path);
+
+    CompiledMatcher(CompiledMatcher &&other) noexcept;
+    CompiledMatcher &operator=(CompiledMatcher &&other) noexcept;
+    CompiledMatcher(CompiledMatcher const &) = delete;
+    CompiledMatcher &operator=(CompiledMatcher const &) = delete;
+    ~CompiledMatcher();
+
+    // Write the compiled automaton to a file
+    void save(std::string const &path) const;
+
+    int pattern_length() const;
+    int width() const;
+
+    // First char of the pattern (the only char that leaves state 0), for a non-empty pattern
+    unsigned char first_char() const;
+
+    /*
+     * @brief Scan a chunk of input, continuing from the state reached at the end of the previous chunk
+     *
+     * Skips through state 0 with memchr, as dense_string_matcher. A match that straddles the boundary with the
+     * previous chunk is found, as the state carries the matched prefix across. An empty pattern never matches.
+     * @param[in]  data  pointer to the chunk
+     * @param[in]  size  size of the chunk in bytes
+     * @param[in]  state  state at the end of the previous chunk (0 at the start of the input)
+     * @param[in]  offset  position of the chunk from the start of the input
+     * @param[in]  on_match  called as on_match(position) with the position of the start of each match from the start
+     *                       of the input
+     * @return  state at the end of the chunk
+     * */
+    template <typename OnMatch>
+    int scan(unsigned char const *data, std::size_t size, int state, long long offset, OnMatch &&on_match) const {
+        int m = header->pattern_length;
+        if (m == 0) {
+            return state;
+        }
+
+        int w = header->width;
+        unsigned char first = pattern[0];
+        unsigned char const *p = data;
+        unsigned char const *end = data + size;
+
+        while (p < end) {
+            if (state == 0) {
+                p = static_cast<unsigned char const *>(std::memchr(p, first, end - p));
+                if (p == nullptr) {
+                    break;
+                }
+            }
+
+            state = table[state * w + char_index[*p++]];
+            if (state == m) {
+                on_match(offset + (p - data) - m);
+            }
+        }
+        return state;
+    }
+
+    // Look up the next state from a state, on reading a byte
+    uint16_t next_state(uint16_t state, unsigned char c) const {
+        return table[state * header->width + char_index[c]];
+    }
+
+    // Raw views of the tables, for scanning loops
+    uint16_t const *char_index_data() const;
+    uint16_t const *table_data() const;
+
+private:
+    struct Header {
+        char magic[8];
+        uint32_t pattern_length;
+        uint32_t width;
+    };
+
+    CompiledMatcher() = default;
+
+    // Point the table views into the block starting at data
+    void attach(unsigned char const *data);
+
+    // Size of the block for a pattern of the given length and width
+    static std::size_t block_size(std::size_t pattern_length, std::size_t width);
+
+    std::vector<unsigned char> storage; // block of a compiled matcher
+    void *mapping = nullptr; // block of a loaded matcher
+    std::size_t mapping_size = 0;
+
+    Header const *header = nullptr;
+    uint16_t const *char_index = nullptr;
+    uint16_t const *table = nullptr;
+    unsigned char const *pattern = nullptr;
+};
+
+/*
+ * @brief Find all occurrences of the compiled pattern in the full text T
+ *
+ * As dense_string_matcher, skipping through state 0 with memchr. An empty pattern never matches.
+ * @param[in]  T  full text string T, which may contain any bytes
+ * @param[in]  matcher  matcher compiled from a substring pattern P
+ * @return  vector of integer shifts to representing the relative position of the substring from the start of T
+ * */
+std::vector<int> compiled_string_matcher(std::string const &T, CompiledMatcher const &matcher);
+
+// Called with the position of the start of each match from the start of the input
+using MatchCallback = std::function<void(long long)>;
+
+// Called with the index of the shard a match was found in, and the position of the start of the match from the start
+// of the input. May be called from several threads at once, but never at once for the same shard.
+using ShardMatchCallback = std::function<void(int, long long)>;
+
+/*
+ * @brief Scan a file for the compiled pattern, reading it in fixed size chunks
+ *
+ * Only one chunk is held in memory at a time, and the automaton state is carried from one chunk to the next.
+ * @param[in]  matcher  matcher compiled from a substring pattern P
+ * @param[in]  path  path of file to be scanned
+ * @param[in]  chunk_size  size of the chunks read, in bytes
+ * @param[in]  on_match  called with the position of each match
+ * @return  size of the file in bytes
+ * */
+long long scan_file(CompiledMatcher const &matcher, std::string const &path, std::size_t chunk_size,
+                    MatchCallback const &on_match);
+
+/*
+ * @brief Scan a file for the compiled pattern, mapping the whole file read-only into memory
+ *
+ * @param[in]  matcher  matcher compiled from a substring pattern P
+ * @param[in]  path  path of file to be scanned
+ * @param[in]  on_match  called with the position of each match
+ * @return  size of the file in bytes
+ * */
+long long scan_file_mapped(CompiledMatcher const &matcher, std::string const &path, MatchCallback const &on_match);
+
+/*
+ * @brief Scan a file for the compiled pattern in parallel, as equal shards of a read-only mapping of the file
+ *
+ * Each shard starts scanning from state 0 at pattern_length - 1 bytes before the start of the shard, so a match
+ * that crosses into the shard from the one before is still seen whole, and reports only the matches that end
+ * inside the shard, so each match is reported exactly once.
+ * @param[in]  pool  thread pool to scan the shards on
+ * @param[in]  matcher  matcher compiled from a substring pattern P
+ * @param[in]  path  path of file to be scanned
+ * @param[in]  shard_count  number of shards to split the file into
+ * @param[in]  on_match  called with the shard index and position of each match
+ * @return  size of the file in bytes
+ * */
+long long scan_file_parallel(TaskPool &pool, CompiledMatcher const &matcher, std::string const &path, int shard_count,
+                             ShardMatchCallback const &on_match);
+
+#endif //STRINGS_MATCHER_HPP
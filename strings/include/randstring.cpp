@@ -1,31 +1,9 @@
-// Based on from: https://stackoverflow.com/a/444614
-
-#include <algorithm>
-#include <array>
-#include <cstring>
-#include <functional>
-#include <random>
+#include "../../include/randgen.hpp"
 #include "randstring.hpp"
 
-template <typename T = std::mt19937>
-T random_generator() {
-    auto constexpr seed_bytes = sizeof(typename T::result_type) * T::state_size;
-    auto constexpr seed_len = seed_bytes / sizeof(std::seed_seq::result_type);
-    auto seed = std::array<std::seed_seq::result_type, seed_len>();
-    auto dev = std::random_device();
-    std::generate_n(begin(seed), seed_len, std::ref(dev));
-    auto seed_seq = std::seed_seq(begin(seed), end(seed));
-    return T{seed_seq};
-}
-
 std::string generate_random_alphanumeric_string(std::size_t len) {
-    static constexpr auto chars =
-            "0123456789"
-            "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-            "abcdefghijklmnopqrstuvwxyz";
-    thread_local auto rng = random_generator<>();
-    auto dist = std::uniform_int_distribution{{}, std::strlen(chars) - 1};
-    auto result = std::string(len, '\0');
-    std::generate_n(begin(result), len, [&]() { return chars[dist(rng)]; });
-    return result;
+    // Each call on a thread draws from the next stream of the default seed, so successive strings differ but every
+    // run of a program generates the same ones
+    thread_local uint64_t stream = 0;
+    return generate_random_string(len, Alphabet::ALPHANUMERIC, derive_seed(DEFAULT_INPUT_SEED, stream++));
 }
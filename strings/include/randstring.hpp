@@ -1,10 +1,15 @@
-// Based on from: https://stackoverflow.com/a/444614
-
 #ifndef STRINGS_RANDSTRING_HPP
 #define STRINGS_RANDSTRING_HPP
 
 #include <string>
 
+/*
+ * @brief Generate a random alphanumeric string, from the shared generator of ../include/randgen.hpp
+ *
+ * Strings are reproducible from run to run: the nth call on a thread always returns the same string.
+ * @param[in]  len  length of the string
+ * @return  string of 0-9, A-Z and a-z
+ * */
 std::string generate_random_alphanumeric_string(std::size_t len);
 
 #endif //STRINGS_RANDSTRING_HPP
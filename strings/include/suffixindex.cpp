@@ -0,0 +1,423 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "suffixindex.hpp"
+
+// Identifies a file written by SuffixIndex::save, including the format version
+static const char SUFFIX_INDEX_MAGIC[8] = {'S', 'U', 'F', 'F', 'I', 'D', 'X', '1'};
+
+// Marks a slot of the suffix array that has not been filled yet
+static const int32_t EMPTY_SLOT = -1;
+
+/*
+ * @brief Supporting function for SA-IS, to find the start (or end, if end is true) of the bucket of each char
+ * */
+static void find_buckets(int32_t const *s, int32_t n, int32_t K, std::vector<int32_t> &buckets, bool end) {
+    std::fill(buckets.begin(), buckets.end(), 0);
+    for (int32_t i = 0; i < n; i++) {
+        buckets[s[i]]++;
+    }
+
+    int32_t sum = 0;
+    for (int32_t c = 0; c < K; c++) {
+        sum += buckets[c];
+        buckets[c] = end ? sum : sum - buckets[c];
+    }
+}
+
+/*
+ * @brief Supporting function for SA-IS, to induce the order of the L-type suffixes from the sorted LMS suffixes,
+ * then of the S-type suffixes from the L-type suffixes
+ * */
+static void induce_sort(int32_t const *s, int32_t *SA, int32_t n, int32_t K, std::vector<unsigned char> const &is_s,
+                        std::vector<int32_t> &buckets) {
+    find_buckets(s, n, K, buckets, false);
+    for (int32_t i = 0; i < n; i++) {
+        int32_t j = SA[i] - 1;
+        if (SA[i] > 0 && !is_s[j]) {
+            SA[buckets[s[j]]++] = j;
+        }
+    }
+
+    find_buckets(s, n, K, buckets, true);
+    for (int32_t i = n - 1; i >= 0; i--) {
+        int32_t j = SA[i] - 1;
+        if (SA[i] > 0 && is_s[j]) {
+            SA[--buckets[s[j]]] = j;
+        }
+    }
+}
+
+/*
+ * @brief Supporting recursive function to compute the suffix array by SA-IS
+ *
+ * Each suffix is S-type if it orders before the next suffix, else L-type, and LMS (leftmost S) if it is S-type
+ * following an L-type suffix. The LMS substrings (from one LMS position to the next) are sorted by one round of
+ * induced sorting, and named by rank, giving a reduced string of at most half the length whose suffix array, found
+ * recursively unless every name is unique, orders the LMS suffixes. A second round of induced sorting from the
+ * sorted LMS suffixes then orders every suffix.
+ * @param[in]  s  string, whose last char is a unique sentinel 0 that orders before every other char
+ * @param[out]  SA  suffix array of s, of n elements
+ * @param[in]  n  length of s
+ * @param[in]  K  size of the alphabet of s, whose chars are in [0, K)
+ * */
+static void sais(int32_t const *s, int32_t *SA, int32_t n, int32_t K) {
+    if (n == 1) {
+        SA[0] = 0;
+        return;
+    }
+
+    std::vector<unsigned char> is_s(n);
+    is_s[n - 1] = 1;
+    for (int32_t i = n - 2; i >= 0; i--) {
+        is_s[i] = s[i] < s[i + 1] || (s[i] == s[i + 1] && is_s[i + 1]);
+    }
+    auto is_lms = [&is_s](int32_t i) { return i > 0 && is_s[i] && !is_s[i - 1]; };
+
+    // Sort the LMS substrings, from the LMS positions placed at the ends of their buckets
+    std::vector<int32_t> buckets(K);
+    std::fill(SA, SA + n, EMPTY_SLOT);
+    find_buckets(s, n, K, buckets, true);
+    for (int32_t i = 1; i < n; i++) {
+        if (is_lms(i)) {
+            SA[--buckets[s[i]]] = i;
+        }
+    }
+    induce_sort(s, SA, n, K, is_s, buckets);
+
+    // Move the sorted LMS positions to the front, then name each LMS substring by its rank, with equal substrings
+    // sharing a name. LMS positions are at least two apart, so the name of position p fits at m + p / 2.
+    int32_t m = 0;
+    for (int32_t i = 0; i < n; i++) {
+        if (is_lms(SA[i])) {
+            SA[m++] = SA[i];
+        }
+    }
+    std::fill(SA + m, SA + n, EMPTY_SLOT);
+
+    int32_t names = 0;
+    int32_t previous = -1;
+    for (int32_t i = 0; i < m; i++) {
+        int32_t position = SA[i];
+        bool differs = false;
+        for (int32_t d = 0; d < n; d++) {
+            if (previous == -1 || s[position + d] != s[previous + d] || is_s[position + d] != is_s[previous + d]) {
+                differs = true;
+                break;
+            }
+            if (d > 0 && (is_lms(position + d) || is_lms(previous + d))) {
+                break;
+            }
+        }
+        if (differs) {
+            names++;
+            previous = position;
+        }
+        SA[m + position / 2] = names - 1;
+    }
+
+    // Gather the names in text order into the reduced string, at the end of SA
+    for (int32_t i = n - 1, j = n - 1; i >= m; i--) {
+        if (SA[i] >= 0) {
+            SA[j--] = SA[i];
+        }
+    }
+    int32_t *reduced = SA + n - m;
+
+    // Order the LMS suffixes by the suffix array of the reduced string, in the front of SA
+    if (names < m) {
+        sais(reduced, SA, m, names);
+    } else {
+        for (int32_t i = 0; i < m; i++) {
+            SA[reduced[i]] = i;
+        }
+    }
+
+    // Map the ranks of the reduced suffixes back to LMS positions, reusing the reduced string for the positions
+    for (int32_t i = 1, j = 0; i < n; i++) {
+        if (is_lms(i)) {
+            reduced[j++] = i;
+        }
+    }
+    for (int32_t i = 0; i < m; i++) {
+        SA[i] = reduced[SA[i]];
+    }
+    std::fill(SA + m, SA + n, EMPTY_SLOT);
+
+    // Place the sorted LMS suffixes at the ends of their buckets, from the last, and induce the rest
+    find_buckets(s, n, K, buckets, true);
+    for (int32_t i = m - 1; i >= 0; i--) {
+        int32_t j = SA[i];
+        SA[i] = EMPTY_SLOT;
+        SA[--buckets[s[j]]] = j;
+    }
+    induce_sort(s, SA, n, K, is_s, buckets);
+}
+
+std::vector<int32_t> build_suffix_array(std::string const &T) {
+    if (T.size() > SuffixIndex::MAX_TEXT_LENGTH) {
+        std::cerr << "Error: text must be <= " << SuffixIndex::MAX_TEXT_LENGTH << " chars to index" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // Shift each byte up by one, past the sentinel 0 appended to the end
+    int32_t n = T.size();
+    std::vector<int32_t> s(n + 1);
+    for (int32_t i = 0; i < n; i++) {
+        s[i] = (unsigned char) T[i] + 1;
+    }
+    s[n] = 0;
+
+    // The suffix of the sentinel alone is always first
+    std::vector<int32_t> SA(n + 1);
+    sais(s.data(), SA.data(), n + 1, 257);
+    SA.erase(SA.begin());
+    return SA;
+}
+
+std::vector<int32_t> build_lcp_array(std::string const &T, std::vector<int32_t> const &SA) {
+    int32_t n = T.size();
+    std::vector<int32_t> rank(n);
+    for (int32_t i = 0; i < n; i++) {
+        rank[SA[i]] = i;
+    }
+
+    // Going through the suffixes in text order, the common prefix with the suffix before in SA shrinks by at most one
+    // from each suffix to the next, so the comparisons add up to O(n)
+    std::vector<int32_t> lcp(n, 0);
+    int32_t h = 0;
+    for (int32_t i = 0; i < n; i++) {
+        if (rank[i] == 0) {
+            h = 0;
+            continue;
+        }
+        int32_t j = SA[rank[i] - 1];
+        while (i + h < n && j + h < n && T[i + h] == T[j + h]) {
+            h++;
+        }
+        lcp[rank[i]] = h;
+        if (h > 0) {
+            h--;
+        }
+    }
+    return lcp;
+}
+
+std::size_t SuffixIndex::block_size(std::size_t text_length) {
+    return sizeof(Header) + text_length * (2 * sizeof(int32_t) + 1);
+}
+
+void SuffixIndex::attach(unsigned char const *data) {
+    header = reinterpret_cast<Header const *>(data);
+    suffix_array = reinterpret_cast<int32_t const *>(data + sizeof(Header));
+    lcp = suffix_array + header->text_length;
+    text = reinterpret_cast<unsigned char const *>(lcp + header->text_length);
+}
+
+SuffixIndex SuffixIndex::build(std::string const &T) {
+    std::vector<int32_t> SA = build_suffix_array(T);
+    std::vector<int32_t> LCP = build_lcp_array(T, SA);
+    std::size_t n = T.size();
+
+    SuffixIndex index;
+    index.storage = std::vector<unsigned char>(block_size(n));
+    unsigned char *data = index.storage.data();
+
+    Header header{};
+    std::memcpy(header.magic, SUFFIX_INDEX_MAGIC, sizeof(SUFFIX_INDEX_MAGIC));
+    header.text_length = n;
+    std::memcpy(data, &header, sizeof(Header));
+    index.attach(data);
+
+    std::copy(SA.begin(), SA.end(), const_cast<int32_t *>(index.suffix_array));
+    std::copy(LCP.begin(), LCP.end(), const_cast<int32_t *>(index.lcp));
+    std::copy(T.begin(), T.end(), const_cast<unsigned char *>(index.text));
+
+    return index;
+}
+
+SuffixIndex SuffixIndex::load(std::string const &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        perror("open");
+        exit(EXIT_FAILURE);
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        perror("fstat");
+        exit(EXIT_FAILURE);
+    }
+
+    std::size_t size = st.st_size;
+    if (size < sizeof(Header)) {
+        std::cerr << "Error: " << path << " is not a suffix index" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        perror("mmap");
+        exit(EXIT_FAILURE);
+    }
+
+    Header const *header = static_cast<Header const *>(mapping);
+    if (std::memcmp(header->magic, SUFFIX_INDEX_MAGIC, sizeof(SUFFIX_INDEX_MAGIC)) != 0 ||
+        header->text_length > MAX_TEXT_LENGTH || block_size(header->text_length) != size) {
+        std::cerr << "Error: " << path << " is not a suffix index" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // Queries jump around the suffix array, so read ahead would only fetch pages that are not needed
+    madvise(mapping, size, MADV_RANDOM);
+
+    SuffixIndex index;
+    index.mapping = mapping;
+    index.mapping_size = size;
+    index.attach(static_cast<unsigned char const *>(mapping));
+    return index;
+}
+
+SuffixIndex::SuffixIndex(SuffixIndex &&other) noexcept {
+    *this = std::move(other);
+}
+
+SuffixIndex &SuffixIndex::operator=(SuffixIndex &&other) noexcept {
+    if (this != &other) {
+        if (mapping != nullptr) {
+            munmap(mapping, mapping_size);
+        }
+        storage = std::move(other.storage);
+        mapping = std::exchange(other.mapping, nullptr);
+        mapping_size = std::exchange(other.mapping_size, 0);
+        header = std::exchange(other.header, nullptr);
+        suffix_array = std::exchange(other.suffix_array, nullptr);
+        lcp = std::exchange(other.lcp, nullptr);
+        text = std::exchange(other.text, nullptr);
+    }
+    return *this;
+}
+
+SuffixIndex::~SuffixIndex() {
+    if (mapping != nullptr) {
+        munmap(mapping, mapping_size);
+    }
+}
+
+void SuffixIndex::save(std::string const &path) const {
+    std::FILE *file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        perror("fopen");
+        exit(EXIT_FAILURE);
+    }
+
+    std::size_t size = size_bytes();
+    if (std::fwrite(header, 1, size, file) != size || std::fclose(file) != 0) {
+        perror("fwrite");
+        exit(EXIT_FAILURE);
+    }
+}
+
+std::size_t SuffixIndex::text_length() const {
+    return header->text_length;
+}
+
+std::size_t SuffixIndex::size_bytes() const {
+    return block_size(header->text_length);
+}
+
+std::size_t SuffixIndex::common_prefix(std::string const &P, int32_t position, std::size_t skip) const {
+    std::size_t limit = std::min<std::size_t>(P.size(), header->text_length - position);
+    std::size_t l = skip;
+    while (l < limit && text[position + l] == (unsigned char) P[l]) {
+        l++;
+    }
+    return l;
+}
+
+std::size_t SuffixIndex::bound(std::string const &P, bool upper) const {
+    std::size_t n = header->text_length;
+    std::size_t m = P.size();
+
+    // Chars of P known to match the suffixes just outside each end of the range, and so every suffix between them
+    std::size_t lo = 0, hi = n;
+    std::size_t lo_match = 0, hi_match = 0;
+
+    while (lo < hi) {
+        std::size_t mid = lo + (hi - lo) / 2;
+        int32_t position = suffix_array[mid];
+        std::size_t l = common_prefix(P, position, std::min(lo_match, hi_match));
+
+        // Whether the suffix, cut to m chars, orders before P (or, for the upper bound, does not order after P)
+        bool before;
+        if (l == m) {
+            before = upper;
+        } else if (position + l == n) {
+            before = true; // the suffix is a proper prefix of P
+        } else {
+            before = text[position + l] < (unsigned char) P[l];
+        }
+
+        if (before) {
+            lo = mid + 1;
+            lo_match = l;
+        } else {
+            hi = mid;
+            hi_match = l;
+        }
+    }
+    return lo;
+}
+
+std::pair<std::size_t, std::size_t> SuffixIndex::find(std::string const &P) const {
+    if (P.empty()) {
+        return {0, 0};
+    }
+    return {bound(P, false), bound(P, true)};
+}
+
+std::size_t SuffixIndex::count(std::string const &P) const {
+    auto range = find(P);
+    return range.second - range.first;
+}
+
+std::vector<int> SuffixIndex::locate(std::string const &P) const {
+    std::vector<int> positions;
+    std::size_t n = header->text_length;
+    std::size_t m = P.size();
+    if (m == 0) {
+        return positions;
+    }
+
+    // The suffixes starting with P follow the first one, for as long as each shares at least m chars with the last
+    std::size_t first = bound(P, false);
+    if (first < n && common_prefix(P, suffix_array[first], 0) == m) {
+        positions.push_back(suffix_array[first]);
+        for (std::size_t i = first + 1; i < n && (std::size_t) lcp[i] >= m; i++) {
+            positions.push_back(suffix_array[i]);
+        }
+    }
+
+    // The occurrences are found in suffix order, so sorting them into text order is the O(occ log occ) part
+    std::sort(positions.begin(), positions.end());
+    return positions;
+}
+
+unsigned char const *SuffixIndex::text_data() const {
+    return text;
+}
+
+int32_t const *SuffixIndex::suffix_array_data() const {
+    return suffix_array;
+}
+
+int32_t const *SuffixIndex::lcp_array_data() const {
+    return lcp;
+}
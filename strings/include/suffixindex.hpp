@@ -0,0 +1,110 @@
+#ifndef STRINGS_SUFFIXINDEX_HPP
+#define STRINGS_SUFFIXINDEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+ * @brief Compute the suffix array of a text in linear time, by induced sorting (SA-IS, Nong, Zhang and Chan)
+ *
+ * @param[in]  T  text string, which may contain any bytes
+ * @return  vector of the start positions of the suffixes of T, in lexicographic order of the suffixes
+ * */
+std::vector<int32_t> build_suffix_array(std::string const &T);
+
+/*
+ * @brief Compute the LCP array of a text from its suffix array in linear time (Kasai et al.)
+ *
+ * @param[in]  T  text string
+ * @param[in]  SA  suffix array of T
+ * @return  vector where element i is the length of the longest common prefix of the suffixes SA[i - 1] and SA[i]
+ *          (0 for i = 0)
+ * */
+std::vector<int32_t> build_lcp_array(std::string const &T, std::vector<int32_t> const &SA);
+
+/*
+ * @brief Index of a fixed text for repeated substring queries, built once from a suffix array and LCP array.
+ *
+ * A count query binary searches the suffix array for the range of suffixes that start with the pattern, skipping
+ * the prefix already known to match both ends of the range (Manber and Myers), so it costs O(|P| log |T|) char
+ * comparisons at worst and close to O(|P| + log |T|) on typical text. A locate query finds the start of the range
+ * the same way, then walks the LCP array to its end, which costs O(1) per occurrence, and sorts the occurrences into
+ * text order, which costs O(occ log occ). The text, suffix array and LCP array live in one contiguous block of 9
+ * bytes per char, which save writes straight to a file and load maps read-only back into memory, as for
+ * CompiledMatcher. The file is in the native byte order. An index is never modified after it is built, so one
+ * instance can answer queries from any number of threads.
+ * */
+class SuffixIndex {
+public:
+    // Longest text that can be indexed, as positions are stored as int32_t
+    static const std::size_t MAX_TEXT_LENGTH = INT32_MAX - 1;
+
+    // Build the index of text T
+    static SuffixIndex build(std::string const &T);
+
+    // Map an index, written by save, read-only from a file
+    static SuffixIndex load(std::string const &path);
+
+    SuffixIndex(SuffixIndex &&other) noexcept;
+    SuffixIndex &operator=(SuffixIndex &&other) noexcept;
+    SuffixIndex(SuffixIndex const &) = delete;
+    SuffixIndex &operator=(SuffixIndex const &) = delete;
+    ~SuffixIndex();
+
+    // Write the index to a file
+    void save(std::string const &path) const;
+
+    std::size_t text_length() const;
+
+    // Size of the index in bytes, as held in memory and on disk
+    std::size_t size_bytes() const;
+
+    // Range [first, last) of the suffix array whose suffixes start with P
+    std::pair<std::size_t, std::size_t> find(std::string const &P) const;
+
+    // Number of occurrences of P in the text
+    std::size_t count(std::string const &P) const;
+
+    // Start positions of the occurrences of P in the text, in ascending order (as found by fa_string_matcher)
+    std::vector<int> locate(std::string const &P) const;
+
+    // Raw views of the arrays, each of text_length() elements
+    unsigned char const *text_data() const;
+    int32_t const *suffix_array_data() const;
+    int32_t const *lcp_array_data() const;
+
+private:
+    struct Header {
+        char magic[8];
+        uint64_t text_length;
+    };
+
+    SuffixIndex() = default;
+
+    // Point the array views into the block starting at data
+    void attach(unsigned char const *data);
+
+    // Size of the block for a text of the given length
+    static std::size_t block_size(std::size_t text_length);
+
+    // Length of the common prefix of P and the suffix at position, from a prefix of skip chars known to match
+    std::size_t common_prefix(std::string const &P, int32_t position, std::size_t skip) const;
+
+    // First index of the suffix array whose suffix, cut to |P| chars, does not order before P (or, if upper is
+    // true, orders after P)
+    std::size_t bound(std::string const &P, bool upper) const;
+
+    std::vector<unsigned char> storage; // block of a built index
+    void *mapping = nullptr; // block of a loaded index
+    std::size_t mapping_size = 0;
+
+    Header const *header = nullptr;
+    int32_t const *suffix_array = nullptr;
+    int32_t const *lcp = nullptr;
+    unsigned char const *text = nullptr;
+};
+
+#endif //STRINGS_SUFFIXINDEX_HPP
@@ -0,0 +1,47 @@
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include "wavefront.hpp"
+
+void wavefront(TaskPool &pool, int row_begin, int row_end, int col_begin, int col_end, int tile_size,
+               std::function<void(int, int, int, int)> const &fill_tile) {
+    if (row_begin >= row_end || col_begin >= col_end) {
+        return;
+    }
+
+    int tile_rows = (row_end - row_begin + tile_size - 1) / tile_size;
+    int tile_cols = (col_end - col_begin + tile_size - 1) / tile_size;
+
+    // Number of tiles above and to the left of each tile that are yet to be filled
+    std::vector<std::atomic<int>> waiting(tile_rows * tile_cols);
+    for (int bi = 0; bi < tile_rows; bi++) {
+        for (int bj = 0; bj < tile_cols; bj++) {
+            waiting[bi * tile_cols + bj].store((bi > 0) + (bj > 0), std::memory_order_relaxed);
+        }
+    }
+
+    TaskGroup group(pool);
+
+    // Fill a tile, then release the tiles below and to the right of it. Whichever of its two dependencies finishes
+    // last starts a tile. The tile below is queued for another thread, and the tile to the right is continued on
+    // this one, since the end of its left neighbour is still in cache.
+    std::function<void(int, int)> run_tile = [&](int bi, int bj) {
+        while (true) {
+            int i_lo = row_begin + bi * tile_size;
+            int j_lo = col_begin + bj * tile_size;
+            fill_tile(i_lo, std::min(i_lo + tile_size, row_end), j_lo, std::min(j_lo + tile_size, col_end));
+
+            if (bi + 1 < tile_rows && waiting[(bi + 1) * tile_cols + bj].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                group.run([&run_tile, bi, bj]() { run_tile(bi + 1, bj); });
+            }
+            if (bj + 1 < tile_cols && waiting[bi * tile_cols + bj + 1].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                bj++;
+            } else {
+                return;
+            }
+        }
+    };
+
+    run_tile(0, 0);
+    group.wait();
+}
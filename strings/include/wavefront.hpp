@@ -0,0 +1,27 @@
+#ifndef STRINGS_WAVEFRONT_HPP
+#define STRINGS_WAVEFRONT_HPP
+
+#include <functional>
+#include "../../include/taskpool.hpp"
+
+// Side length of the square tiles of cells filled by each wavefront task, so the rows of a tile stay in cache
+const int WAVEFRONT_TILE_SIZE = 256;
+
+/*
+ * @brief Fill a dynamic programming table in parallel, as a wavefront of tiles
+ *
+ * For tables where each cell (i, j) depends only on the cells above (i - 1, j), to the left (i, j - 1) and
+ * diagonally above (i - 1, j - 1). The cells are split into square tiles, and each tile only depends on the tiles
+ * above and to the left of it, so all of the tiles on an anti-diagonal of tiles can be filled at the same time. A
+ * tile is queued on the pool as soon as both of the tiles it depends on are complete, rather than waiting for the
+ * whole previous anti-diagonal. Any first row and column the table depends on must be filled in advance.
+ * @param[in]  pool  thread pool to fill the tiles on
+ * @param[in]  row_begin, row_end  range of rows to be filled (exclusive of row_end)
+ * @param[in]  col_begin, col_end  range of columns to be filled (exclusive of col_end)
+ * @param[in]  tile_size  side length of a tile
+ * @param[in]  fill_tile  called as fill_tile(i_lo, i_hi, j_lo, j_hi) to fill the cells [i_lo, i_hi) x [j_lo, j_hi)
+ * */
+void wavefront(TaskPool &pool, int row_begin, int row_end, int col_begin, int col_end, int tile_size,
+               std::function<void(int, int, int, int)> const &fill_tile);
+
+#endif //STRINGS_WAVEFRONT_HPP
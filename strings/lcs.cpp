@@ -1,18 +1,35 @@
-#include <chrono>
+#include <algorithm>
+#include <array>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <iomanip>
+#include <memory>
 #include <string>
+#include <thread>
 #include <vector>
-#include "include/randstring.hpp"
+#include "../include/benchmark.hpp"
+#include "../include/randgen.hpp"
+#include "include/wavefront.hpp"
+
+// Longest strings accepted by each mode: the full LCS table grows with the product of the string lengths (6.4 GB at
+// 40000), whereas Hirschberg's algorithm only keeps two rows.
+const long MAX_TABLE_STRING_LENGTH = 40000;
+const long MAX_HIRSCHBERG_STRING_LENGTH = 100000000;
+const long MAX_BIT_PARALLEL_STRING_LENGTH = 100000000;
+
+// Methods for computing the LCS, selected by the optional mode argument
+enum lcs_mode { TABLE, HIRSCHBERG, BIT_PARALLEL };
 
 /*
  * @brief Parse argument to extract user string length
  *
  * @param[in]  param  argv element corresponding to string length
+ * @param[in]  max_length  largest string length accepted
  * @return  (int)string_length  parsed size of array, casted to int
  * */
-int get_string_length(char *param) {
+int get_string_length(char *param, long max_length) {
     char *endptr;
     long string_length;
 
@@ -29,8 +46,8 @@ int get_string_length(char *param) {
         exit(EXIT_FAILURE);
     }
 
-    if (string_length > 40000) {
-        std::cerr << "string_length parameter must be <= 40000" << std::endl;
+    if (string_length > max_length) {
+        std::cerr << "string_length parameter must be <= " << max_length << std::endl;
         exit(EXIT_FAILURE);
     }
 
@@ -63,6 +80,58 @@ int get_repeat_count(char *param) {
     return (int) repeat_count;
 }
 
+/*
+ * @brief Parse argument to extract user number of threads
+ *
+ * @param[in]  param  argv element corresponding to thread count
+ * @return  (int)thread_count  parsed thread count, casted to int
+ * */
+int get_thread_count(char *param) {
+    char *endptr;
+    long thread_count;
+
+    errno = 0;
+    thread_count = std::strtol(param, &endptr, 10);
+
+    if (errno != 0) {
+        perror("strtol");
+        exit(EXIT_FAILURE);
+    }
+
+    if (endptr == param) {
+        std::cerr << "could not parse thread_count as an integer" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    if (thread_count < 1) {
+        std::cerr << "thread_count parameter must be >= 1" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    return (int) thread_count;
+}
+
+/*
+ * @brief Parse argument to extract user LCS mode
+ *
+ * @param[in]  param  argv element corresponding to mode ("table", "hirschberg" or "bitparallel")
+ * @return  (lcs_mode)mode  parsed LCS mode
+ * */
+lcs_mode get_mode(char *param) {
+    if (std::strcmp(param, "table") == 0) {
+        return TABLE;
+    }
+    if (std::strcmp(param, "hirschberg") == 0) {
+        return HIRSCHBERG;
+    }
+    if (std::strcmp(param, "bitparallel") == 0) {
+        return BIT_PARALLEL;
+    }
+
+    std::cerr << "mode parameter must be one of: table, hirschberg, bitparallel" << std::endl;
+    exit(EXIT_FAILURE);
+}
+
 /*
  * @brief Class to encapsulate an LCS table computed for two strings.
  *
@@ -95,12 +164,25 @@ struct LCSTable {
     // Constructor makes a copy of the input strings, computes the height and width, and initialises the table vector.
     LCSTable(std::string const &str_x, std::string const &str_y);
 
+    // As above, but computes the table in parallel on the thread pool.
+    LCSTable(std::string const &str_x, std::string const &str_y, TaskPool &pool);
+
     // Convert between 2-dim (row,column) index and the internal 1-dim vector index.
     int coord(int i, int j) const;
 
     // Construct the LCS table. The 1-dim "table" vector represents the 2-dim LCS table[0..m,0..n], for two strings X of
     // length m and Y of length n. The value of table[m,n] is the length of a longest common subsequence of X and Y.
     void compute_lcs_table();
+
+    // Construct the LCS table as a wavefront of tiles, in parallel on the thread pool.
+    void compute_lcs_table(TaskPool &pool);
+
+    // Create the zero first row and column of the LCS table.
+    void compute_lcs_borders();
+
+    // Compute the values of the inner table for rows [i_lo, i_hi) and columns [j_lo, j_hi), where the row above and
+    // the column to the left of the tile have already been computed.
+    void compute_lcs_tile(int i_lo, int i_hi, int j_lo, int j_hi);
 };
 
 LCSTable::LCSTable(std::string const &str_x, std::string const &str_y) {
@@ -119,11 +201,37 @@ LCSTable::LCSTable(std::string const &str_x, std::string const &str_y) {
     LCSTable::compute_lcs_table();
 }
 
+LCSTable::LCSTable(std::string const &str_x, std::string const &str_y, TaskPool &pool) {
+    X = str_x;
+    Y = str_y;
+    height = X.size() + 1;
+    width = Y.size() + 1;
+    table = std::vector<int>(height * width);
+
+    // Populate LCS table for the provided strings, in parallel
+    LCSTable::compute_lcs_table(pool);
+}
+
 int LCSTable::coord(int i, int j) const {
     return j + i * width;
 }
 
 void LCSTable::compute_lcs_table() {
+    compute_lcs_borders();
+
+    // Compute values for inner table
+    compute_lcs_tile(1, height, 1, width);
+}
+
+void LCSTable::compute_lcs_table(TaskPool &pool) {
+    compute_lcs_borders();
+
+    // Compute values for inner table, a tile at a time
+    wavefront(pool, 1, height, 1, width, WAVEFRONT_TILE_SIZE,
+              [this](int i_lo, int i_hi, int j_lo, int j_hi) { compute_lcs_tile(i_lo, i_hi, j_lo, j_hi); });
+}
+
+void LCSTable::compute_lcs_borders() {
     // Create zero left column
     for (int i = 0; i < height; i++) {
         table[coord(i, 0)] = 0;
@@ -133,10 +241,11 @@ void LCSTable::compute_lcs_table() {
     for (int j = 0; j < width; j++) {
         table[coord(0, j)] = 0;
     }
+}
 
-    // Compute values for inner table
-    for (int i = 1; i < height; i++) {
-        for (int j = 1; j < width; j++) {
+void LCSTable::compute_lcs_tile(int i_lo, int i_hi, int j_lo, int j_hi) {
+    for (int i = i_lo; i < i_hi; i++) {
+        for (int j = j_lo; j < j_hi; j++) {
             if (X[i - 1] == Y[j - 1]) {
                 table[coord(i, j)] = table[coord(i - 1, j - 1)] + 1;
             } else {
@@ -158,85 +267,451 @@ std::ostream &operator<<(std::ostream &out, LCSTable const &t) {
 }
 
 /*
- * @brief Recursively assemble an LCS string from a pre-computed LCS table
+ * @brief Assemble an LCS string from a pre-computed LCS table
  *
+ * Walks back through the table from (i, j), taking the diagonal on a match and otherwise the neighbour with the
+ * longer LCS, and writes each matching char straight into its final position. The length of the LCS is table[i,j],
+ * so the buffer is sized once up front and filled from the back.
  * @param[in]  t  instance of an LCSTable precomputed from two strings
  * @param[in]  i  row index into t (and the original X, Y strings)
  * @param[in]  j  column index into t (and the original X, Y strings)
- * @return  string representing the LCS, for the given i,j indices
+ * @param[out]  lcs  string resized to hold the LCS, for the given i,j indices (reusing its existing capacity)
  * */
-std::string assemble_lcs(LCSTable const &t, int i, int j) {
-    // Base case, where no common substring -- return empty string
-    if (t.table[t.coord(i, j)] == 0) {
-        return "";
-    // Common substring, where char X[i] and Y[j] match -- recursively return substring and append matching char
-    } else if (t.X[i - 1] == t.Y[j - 1]) {
-        return assemble_lcs(t, i - 1, j - 1) + t.X[i - 1];
-    // Common substring, where char X[i] and Y[j] do not match -- recursively work back along row
-    } else if (t.table[t.coord(i, j - 1)] > t.table[t.coord(i - 1, j)]) {
-        return assemble_lcs(t, i, j - 1);
-    // Common substring, where char X[i] and Y[j] do not match -- recursively work back up column
-    } else {
-        return assemble_lcs(t, i - 1, j);
+void traceback_lcs(LCSTable const &t, int i, int j, std::string &lcs) {
+    int k = t.table[t.coord(i, j)];
+    lcs.resize(k);
+
+    // The table value at (i, j) is always the number of LCS chars still to be found
+    while (k > 0) {
+        if (t.X[i - 1] == t.Y[j - 1]) {
+            lcs[--k] = t.X[i - 1];
+            i--;
+            j--;
+        } else if (t.table[t.coord(i, j - 1)] > t.table[t.coord(i - 1, j)]) {
+            j--;
+        } else {
+            i--;
+        }
     }
 }
 
-int main(int argc, char *argv[]) {
-    // Check correct usage (e.g. 'strings 1000 5')
-    if (argc != 3) {
-        std::cerr << "Usage: " << argv[0] << " [string_length] [repeat_count]" << std::endl;
-        exit(EXIT_FAILURE);
+/*
+ * @brief Supporting function for Hirschberg's algorithm, to compute the last row of an LCS table
+ *
+ * Computes the LCS lengths for X[x_lo..x_hi) against every prefix of Y[y_lo..y_hi), keeping only a single row of
+ * the table (and the value diagonally above the current cell), so the rest of the table is never stored.
+ * @param[in]  X  first string
+ * @param[in]  x_lo, x_hi  range of X (exclusive of x_hi)
+ * @param[in]  Y  second string
+ * @param[in]  y_lo, y_hi  range of Y (exclusive of y_hi)
+ * @param[out]  row  row[j] is set to the LCS length of X[x_lo..x_hi) and Y[y_lo..y_lo+j), for j in [0, y_hi-y_lo]
+ * */
+void lcs_last_row(std::string const &X, int x_lo, int x_hi, std::string const &Y, int y_lo, int y_hi,
+                  std::vector<int> &row) {
+    int n = y_hi - y_lo;
+    std::fill(row.begin(), row.begin() + n + 1, 0);
+
+    for (int i = x_lo; i < x_hi; i++) {
+        int diagonal = 0;
+        for (int j = 1; j <= n; j++) {
+            int above = row[j];
+            if (X[i] == Y[y_lo + j - 1]) {
+                row[j] = diagonal + 1;
+            } else {
+                row[j] = std::max(above, row[j - 1]);
+            }
+            diagonal = above;
+        }
     }
+}
 
-    std::chrono::time_point <std::chrono::steady_clock> t1, t2, t3;
-    long dt1, dt2;
-    std::string lcs, X, Y;
-    int dummy_val = 0; // Use for accumulation to prevent compiler optimising away ops
+/*
+ * @brief Supporting function for Hirschberg's algorithm, to compute the last row of an LCS table of the reversed strings
+ *
+ * Mirror image of lcs_last_row, working back from the ends of both ranges.
+ * @param[in]  X  first string
+ * @param[in]  x_lo, x_hi  range of X (exclusive of x_hi)
+ * @param[in]  Y  second string
+ * @param[in]  y_lo, y_hi  range of Y (exclusive of y_hi)
+ * @param[out]  row  row[j] is set to the LCS length of X[x_lo..x_hi) and Y[y_hi-j..y_hi), for j in [0, y_hi-y_lo]
+ * */
+void lcs_last_row_reverse(std::string const &X, int x_lo, int x_hi, std::string const &Y, int y_lo, int y_hi,
+                          std::vector<int> &row) {
+    int n = y_hi - y_lo;
+    std::fill(row.begin(), row.begin() + n + 1, 0);
+
+    for (int i = x_hi - 1; i >= x_lo; i--) {
+        int diagonal = 0;
+        for (int j = 1; j <= n; j++) {
+            int above = row[j];
+            if (X[i] == Y[y_hi - j]) {
+                row[j] = diagonal + 1;
+            } else {
+                row[j] = std::max(above, row[j - 1]);
+            }
+            diagonal = above;
+        }
+    }
+}
 
-    int string_length = get_string_length(argv[1]);
-    int repeats = get_repeat_count(argv[2]);
+/*
+ * @brief Supporting recursive function for Hirschberg's algorithm
+ *
+ * Split X[x_lo..x_hi) in half at x_mid. An LCS of the two ranges is an LCS of the top half of X with Y[y_lo..k),
+ * followed by an LCS of the bottom half of X with Y[k..y_hi), for the split point k that maximises the sum of their
+ * lengths. The lengths for every k come from the last row of the forward table for the top half, and of the reverse
+ * table for the bottom half, then both halves are solved recursively. The rows are reused by each recursive call.
+ * @param[in]  X  first string
+ * @param[in]  x_lo, x_hi  range of X (exclusive of x_hi)
+ * @param[in]  Y  second string
+ * @param[in]  y_lo, y_hi  range of Y (exclusive of y_hi)
+ * @param[in]  forward, backward  scratch rows, each of at least |Y| + 1 elements
+ * @param[out]  lcs  string that the LCS of the two ranges is appended to
+ * */
+void hirschberg_lcs(std::string const &X, int x_lo, int x_hi, std::string const &Y, int y_lo, int y_hi,
+                    std::vector<int> &forward, std::vector<int> &backward, std::string &lcs) {
+    // Base case, where either range is empty -- nothing in common
+    if (x_lo == x_hi || y_lo == y_hi) {
+        return;
+    }
+
+    // Base case, where X range is a single char -- the LCS is that char, if it appears anywhere in the Y range
+    if (x_hi - x_lo == 1) {
+        if (std::find(Y.begin() + y_lo, Y.begin() + y_hi, X[x_lo]) != Y.begin() + y_hi) {
+            lcs += X[x_lo];
+        }
+        return;
+    }
+
+    int x_mid = x_lo + (x_hi - x_lo) / 2;
+    int n = y_hi - y_lo;
+
+    lcs_last_row(X, x_lo, x_mid, Y, y_lo, y_hi, forward);
+    lcs_last_row_reverse(X, x_mid, x_hi, Y, y_lo, y_hi, backward);
+
+    // Find split point of Y range that gives the longest combined LCS
+    int split = 0;
+    int best = -1;
+    for (int k = 0; k <= n; k++) {
+        if (forward[k] + backward[n - k] > best) {
+            best = forward[k] + backward[n - k];
+            split = k;
+        }
+    }
+
+    hirschberg_lcs(X, x_lo, x_mid, Y, y_lo, y_lo + split, forward, backward, lcs);
+    hirschberg_lcs(X, x_mid, x_hi, Y, y_lo + split, y_hi, forward, backward, lcs);
+}
+
+/*
+ * @brief Compute an LCS string with Hirschberg's linear space algorithm
+ *
+ * Takes about twice the time of building the full LCS table, but only O(|X| + |Y|) space, so it can be used on
+ * strings far too long for an LCSTable.
+ * @param[in]  X  first string
+ * @param[in]  Y  second string
+ * @return  string representing an LCS of X and Y
+ * */
+std::string hirschberg_lcs(std::string const &X, std::string const &Y) {
+    std::vector<int> forward(Y.size() + 1);
+    std::vector<int> backward(Y.size() + 1);
+    std::string lcs;
+    lcs.reserve(std::min(X.size(), Y.size()));
+
+    hirschberg_lcs(X, 0, X.size(), Y, 0, Y.size(), forward, backward, lcs);
+
+    return lcs;
+}
+
+/*
+ * @brief Match masks of a string, for the bit-parallel LCS length computation.
+ *
+ * For each distinct char c of X, a bit vector of |X| bits (packed into 64-bit words) with bit i set where X[i] == c.
+ * Chars that do not appear in X have no mask, as they can never be part of a match.
+ * */
+struct LCSMatchMasks {
+    int length;
+    int words;
+    std::array<int, 256> index;  // index[c] is the mask number of char c, or -1 if c is not in X
+    std::vector<uint64_t> masks; // masks[index[c] * words + w] holds bits [64w, 64w + 64) of the mask for char c
+
+    // Constructor assigns a mask number to each distinct char in X, then sets the bit of each char in its mask.
+    explicit LCSMatchMasks(std::string const &X);
+
+    // Pointer to the first word of the mask for char c, or nullptr if c does not appear in X
+    uint64_t const *mask(char c) const;
+};
+
+LCSMatchMasks::LCSMatchMasks(std::string const &X) {
+    length = X.size();
+    words = (length + 63) / 64;
+
+    index.fill(-1);
+    int mask_count = 0;
+    for (unsigned char c: X) {
+        if (index[c] < 0) {
+            index[c] = mask_count++;
+        }
+    }
+
+    masks = std::vector<uint64_t>((std::size_t) mask_count * words, 0);
+    for (int i = 0; i < length; i++) {
+        masks[(std::size_t) index[(unsigned char) X[i]] * words + i / 64] |= uint64_t(1) << (i % 64);
+    }
+}
+
+uint64_t const *LCSMatchMasks::mask(char c) const {
+    int k = index[(unsigned char) c];
+    return (k < 0) ? nullptr : masks.data() + (std::size_t) k * words;
+}
+
+/*
+ * @brief Compute the length of an LCS with the bit-parallel algorithm of Allison-Dix and Hyyro
+ *
+ * Rather than the full table, a bit vector V over the positions of X is kept, where the zero bits of V mark the
+ * positions at which the LCS length of X[0..i] steps up, against the prefix of Y processed so far. Each char of Y
+ * updates all |X| columns at once, 64 per word, as V = (V + (V & M)) | (V & ~M) for the match mask M of the char.
+ * The addition carries from each word into the next, so the words of a row are processed in order.
+ * @param[in]  masks  match masks precomputed for the first string X
+ * @param[in]  Y  second string
+ * @return  length of an LCS of X and Y
+ * */
+int bit_parallel_lcs_length(LCSMatchMasks const &masks, std::string const &Y) {
+    int words = masks.words;
+    std::vector<uint64_t> V(words, ~uint64_t(0));
+
+    for (char c: Y) {
+        uint64_t const *M = masks.mask(c);
+
+        // Chars with no match in X leave V unchanged
+        if (M == nullptr) {
+            continue;
+        }
+
+        unsigned char carry = 0;
+        for (int w = 0; w < words; w++) {
+            uint64_t v = V[w];
+            uint64_t u = v & M[w];
+            unsigned long long sum;
+            carry = __builtin_add_overflow(v, carry, &sum) | __builtin_add_overflow(sum, u, &sum);
+            V[w] = sum | (v & ~M[w]);
+        }
+    }
+
+    // Count the zero bits of V, ignoring the padding bits past the end of X in the last word
+    int lcs_length = 0;
+    for (int w = 0; w < words; w++) {
+        uint64_t v = V[w];
+        int bits = std::min(64, masks.length - 64 * w);
+        if (bits < 64) {
+            v |= ~uint64_t(0) << bits;
+        }
+        lcs_length += __builtin_popcountll(~v);
+    }
+
+    return lcs_length;
+}
+
+/*
+ * @brief Compute the length of an LCS with the bit-parallel algorithm, including building the match masks of X
+ *
+ * @param[in]  X  first string
+ * @param[in]  Y  second string
+ * @return  length of an LCS of X and Y
+ * */
+int bit_parallel_lcs_length(std::string const &X, std::string const &Y) {
+    return bit_parallel_lcs_length(LCSMatchMasks(X), Y);
+}
+
+/*
+ * @brief Check whether a string is a subsequence of another, for checking an LCS string
+ *
+ * @param[in]  S  candidate subsequence
+ * @param[in]  X  string that S is searched for, in order
+ * @return  true if the chars of S appear in X in the same order
+ * */
+bool is_subsequence(std::string const &S, std::string const &X) {
+    std::size_t k = 0;
+    for (std::size_t i = 0; i < X.size() && k < S.size(); i++) {
+        if (X[i] == S[k]) {
+            k++;
+        }
+    }
+    return k == S.size();
+}
+
+/*
+ * @brief Check an LCS string of two strings, exiting on failure
+ *
+ * LCS strings of the same strings can differ by method, so the check is that it has the expected length and is a
+ * common subsequence.
+ * @param[in]  method  name of the method that computed the LCS string, for the error message
+ * @param[in]  lcs  LCS string to be checked
+ * @param[in]  length  length of an LCS of X and Y, computed by another method
+ * @param[in]  X  first string
+ * @param[in]  Y  second string
+ * */
+void check_lcs(std::string const &method, std::string const &lcs, int length, std::string const &X,
+               std::string const &Y) {
+    if ((int) lcs.size() != length || !is_subsequence(lcs, X) || !is_subsequence(lcs, Y)) {
+        std::cerr << method << " LCS string is not a common subsequence of length " << length << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+/*
+ * @brief Benchmark the LCS computations of the mode, on two random strings over an alphabet
+ *
+ * @param[in]  bench  benchmark harness
+ * @param[in]  pool  thread pool for the wavefront LCS table
+ * @param[in]  mode  computation to be benchmarked
+ * @param[in]  string_length  length of each string
+ * @param[in]  alphabet  alphabet of the strings
+ * @param[in]  seed  seed of the strings
+ * */
+void run_lcs_benchmarks(Benchmark &bench, TaskPool &pool, lcs_mode mode, int string_length, Alphabet alphabet,
+                        uint64_t seed) {
+    std::string lcs;
 
     // Example strings X and Y from the book
     //X = "CATCGA";
     //Y = "GTACCGTCA";
 
-    // Create random alphanumeric strings of user specified length
-    X = generate_random_alphanumeric_string(string_length);
-    Y = generate_random_alphanumeric_string(string_length);
+    // Create random strings of user specified length, from independent streams of the seed
+    std::string X = generate_random_string(string_length, alphabet, derive_seed(seed, 0), pool);
+    std::string Y = generate_random_string(string_length, alphabet, derive_seed(seed, 1), pool);
 
-    dt1 = 0;
-    dt2 = 0;
+    // Hardware counters are reported per cell of the LCS table, computed or not, and per char for the linear steps
+    double cells = (double) string_length * string_length;
+    bench.set_counter_unit("cell", cells);
 
-    for (int i = 0; i < repeats; i++) {
+    if (mode == HIRSCHBERG) {
+        // Calculate LCS string in linear space, checking its length against the bit-parallel computation
+        int lcs_length = bit_parallel_lcs_length(X, Y);
+        bench.run("LCS string (Hirschberg)", string_length, []() {}, [&]() { lcs = hirschberg_lcs(X, Y); },
+                  [&]() { check_lcs("Hirschberg", lcs, lcs_length, X, Y); });
+        return;
+    }
 
-        t1 = std::chrono::steady_clock::now();
+    if (mode == BIT_PARALLEL) {
+        // Precompute match masks of X, which are freed before each run so only one set is held
+        std::unique_ptr<LCSMatchMasks> masks;
+        bench.set_counter_unit("char", string_length);
+        bench.run("Match masks", string_length, [&]() { masks.reset(); },
+                  [&]() { masks = std::make_unique<LCSMatchMasks>(X); });
+        if (!masks) {
+            masks = std::make_unique<LCSMatchMasks>(X);
+        }
 
-        // Construct LCS table
-        auto lcs_table = LCSTable(X, Y);
-        t2 = std::chrono::steady_clock::now();
+        // Calculate LCS length only
+        bench.set_counter_unit("cell", cells);
+        bench.run("LCS length (bit-parallel)", string_length,
+                  [&]() { do_not_optimize(bit_parallel_lcs_length(*masks, Y)); });
+        return;
+    }
 
-        // Calculate LCS string
-        lcs = assemble_lcs(lcs_table, X.size(), Y.size());
-        t3 = std::chrono::steady_clock::now();
+    // Construct LCS table, which is freed before each run as it can take gigabytes
+    std::unique_ptr<LCSTable> lcs_table;
+    double table_median = bench.run("LCS table", string_length, [&]() { lcs_table.reset(); },
+                                    [&]() { lcs_table = std::make_unique<LCSTable>(X, Y); });
+    if (!lcs_table) {
+        lcs_table = std::make_unique<LCSTable>(X, Y);
+    }
 
-        // Accumulate measurement time
-        dt1 += std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
-        dt2 += std::chrono::duration_cast<std::chrono::microseconds>(t3 - t2).count();
+    // Print intermediate LCS table for debugging
+    //std::cout << *lcs_table << std::endl;
+
+    // Calculate LCS string
+    bench.set_counter_unit("char", string_length);
+    bench.run("LCS string (traceback)", string_length, [&]() {
+        traceback_lcs(*lcs_table, X.size(), Y.size(), lcs);
+        do_not_optimize(lcs);
+    });
+    bench.set_counter_unit("cell", cells);
+    traceback_lcs(*lcs_table, X.size(), Y.size(), lcs);
+    lcs_table.reset();
+    check_lcs("Traceback", lcs, lcs.size(), X, Y);
+
+    // Compare with the LCS string calculated in linear space, which may be a different LCS of the same length
+    std::string hirschberg;
+    bench.run("LCS string (Hirschberg)", string_length, []() {}, [&]() { hirschberg = hirschberg_lcs(X, Y); },
+              [&]() { check_lcs("Hirschberg", hirschberg, lcs.size(), X, Y); });
 
-        // Print intermediate LCS table for debugging
-        //std::cout << lcs_table << std::endl;
+    // Print final LCS string
+    //std::cout << "Longest common subsequence: " << lcs << std::endl;
 
-        // Use values in the sorted array to prevent the compiler optimising away ops
-        dummy_val += lcs[(100 * i) % string_length];
+    // Compare with the LCS table computed as a parallel wavefront of tiles
+    std::unique_ptr<LCSTable> wavefront_table;
+    std::string wavefront_lcs;
+
+    bench.set_threads(pool.size());
+    double median = bench.run("LCS table (wavefront, " + std::to_string(pool.size()) + " threads)", string_length,
+                              [&]() { wavefront_table.reset(); },
+                              [&]() { wavefront_table = std::make_unique<LCSTable>(X, Y, pool); }, [&]() {
+        // Check the wavefront gives the same table, by assembling the same LCS string from it
+        traceback_lcs(*wavefront_table, X.size(), Y.size(), wavefront_lcs);
+        if (wavefront_lcs != lcs) {
+            std::cerr << "Wavefront LCS table does not match LCS table" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    });
+    if (median > 0 && table_median > 0) {
+        bench.metric("x speedup vs LCS table", table_median / median);
+    }
+    bench.set_threads(1);
+    wavefront_table.reset();
+
+    // Compare with the length only bit-parallel computation, including building the match masks
+    int lcs_length = 0;
+    median = bench.run("LCS length (bit-parallel, with match masks)", string_length, []() {},
+                       [&]() { lcs_length = bit_parallel_lcs_length(X, Y); }, [&]() {
+        if (lcs_length != (int) lcs.size()) {
+            std::cerr << "Bit-parallel LCS length " << lcs_length << " does not match LCS table length "
+                      << lcs.size() << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    });
+    if (median > 0 && table_median > 0) {
+        bench.metric("x speedup vs LCS table", table_median / median);
     }
+}
 
-    // Print final LCS string
-    //std::cout << "Longest common subsequence: " << lcs << std::endl;
-    std::cout << "Time to compute LCS table: " << ((float) dt1 / (1e6 * repeats)) << " s (average per op)" << std::endl;
-    std::cout << "Time to compute LCS string: " << ((float) dt2 / (1e6 * repeats)) << " s (average per op)" << std::endl;
+int main(int argc, char *argv[]) {
+    BenchmarkOptions options = parse_benchmark_options(argc, argv);
 
-    // Dump final accumulated value to prevent compiler optimising away ops
-    std::cout << dummy_val << std::endl;
+    // Check correct usage (e.g. 'strings 1000 5')
+    if (argc < 3 || argc > 5) {
+        std::cerr << "Usage: " << argv[0] << " [string_length] [repeat_count]"
+                  << " [mode (optional): table|hirschberg|bitparallel] [thread_count (optional)] [--warmup=N]"
+                  << " [--samples=N] [--format=text|csv|json] [--output=path] [--filter=name] [--sweep=sizes]"
+                  << " [--seed=N] [--input=alphanumeric|dna|text] [--counters]" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    Alphabet alphabet = parse_alphabet(options.input.empty() ? "alphanumeric" : options.input);
+
+    lcs_mode mode = (argc >= 4) ? get_mode(argv[3]) : TABLE;
+    long max_length = MAX_TABLE_STRING_LENGTH;
+    if (mode == HIRSCHBERG) {
+        max_length = MAX_HIRSCHBERG_STRING_LENGTH;
+    } else if (mode == BIT_PARALLEL) {
+        max_length = MAX_BIT_PARALLEL_STRING_LENGTH;
+    }
+    int string_length = get_string_length(argv[1], max_length);
+    int repeats = get_repeat_count(argv[2]);
+    int threads = (argc == 5) ? get_thread_count(argv[4]) : std::max((int) std::thread::hardware_concurrency(), 1);
+
+    Benchmark bench("lcs", options, repeats);
+    TaskPool pool(threads);
+
+    for (long long size: bench.sizes(string_length)) {
+        if (size < 0 || size > max_length) {
+            std::cerr << "sweep sizes must be >= 0 and <= " << max_length << " for this mode" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        run_lcs_benchmarks(bench, pool, mode, size, alphabet, options.seed);
+    }
 
+    bench.report();
     exit(EXIT_SUCCESS);
 }
@@ -1,12 +1,31 @@
-#include <chrono>
+#include <algorithm>
+#include <array>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <iomanip>
+#include <limits>
+#include <memory>
 #include <random>
+#include <queue>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
-#include "include/randstring.hpp"
+#include "../include/benchmark.hpp"
+#include "include/matcher.hpp"
+#include "include/suffixindex.hpp"
+#include "../include/randgen.hpp"
+#include "../include/taskpool.hpp"
+
+// Longest pattern whose state table is also built by the naive method of the book, for comparison
+const int NAIVE_STATE_TABLE_MAX_PATTERN_LENGTH = 100;
+
+// Number of patterns in the dictionary searched for by the Aho-Corasick automaton
+const int DICTIONARY_SIZE = 100;
 
 /*
  * @brief Parse argument to extract user string length
@@ -65,6 +84,37 @@ int get_repeat_count(char *param) {
     return (int) repeat_count;
 }
 
+/*
+ * @brief Parse argument to extract user number of threads
+ *
+ * @param[in]  param  argv element corresponding to thread count
+ * @return  (int)thread_count  parsed thread count, casted to int
+ * */
+int get_thread_count(char *param) {
+    char *endptr;
+    long thread_count;
+
+    errno = 0;
+    thread_count = std::strtol(param, &endptr, 10);
+
+    if (errno != 0) {
+        perror("strtol");
+        exit(EXIT_FAILURE);
+    }
+
+    if (endptr == param) {
+        std::cerr << "could not parse thread_count as an integer" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    if (thread_count < 1) {
+        std::cerr << "thread_count parameter must be >= 1" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    return (int) thread_count;
+}
+
 /*
  * @brief Class to encapsulate transform tables computed for two strings.
  *
@@ -104,8 +154,13 @@ struct StateTable {
     int get_next_state(int prev_state, char prev_char);
 
     // Construct the next_state table. The 1-dim vector represents the 2-dim table of height (pattern states) and width
-    // (unique characters of the input text T).
+    // (unique characters of the input text T). Each row is copied from the row of the state for the longest proper
+    // prefix of the pattern that is also a suffix of the current state (the prefix function), in O(m |Sigma|) time.
     void compute_state_table();
+
+    // Construct the next_state table as in the book, by comparing the pattern with each candidate suffix, in
+    // O(m^3 |Sigma|) time.
+    void compute_state_table_naive();
 };
 
 StateTable::StateTable(std::string const &T, std::string const &P) {
@@ -139,6 +194,18 @@ int StateTable::coord(int i, int j) const {
 }
 
 void StateTable::compute_state_table() {
+    if (width == 0) {
+        return;
+    }
+
+    // Chars of the pattern that are not in the text have no column
+    fill_state_table(pattern, width, [this](char c) {
+        auto match = char_index.find(c);
+        return (match != char_index.end()) ? match->second : -1;
+    }, next_state.data());
+}
+
+void StateTable::compute_state_table_naive() {
     int i;
     int pka_length;
 
@@ -207,80 +274,775 @@ std::vector<int> fa_string_matcher(std::string const &T, StateTable &t) {
     return shifts;
 }
 
-int get_random_index(int index_max) {
-    std::random_device rd;
-    std::mt19937 generator(rd());
-    return generator() % index_max;
-}
+/*
+ * @brief Class to encapsulate a dense next state table computed for a pattern.
+ *
+ * The same automaton as a StateTable, laid out for scanning speed. Each byte is remapped to a column through a
+ * 256-entry array rather than a hash map, with column 0 shared by every byte that does not appear in the pattern
+ * (all of which return the automaton to state 0), and states are stored in the narrowest type State that holds
+ * pattern_length + 1 states (uint8_t for patterns shorter than 255 chars, else uint16_t).
+ * */
+template <typename State>
+struct DenseStateTable {
+    int height; // number of states
+    int width; // number of unique chars in the pattern, plus one for all other chars
+    std::string pattern;
+    int pattern_length;
+    std::array<uint16_t, 256> char_index; // column of each byte
+    std::vector<State> next_state;
 
-int main(int argc, char *argv[]) {
-    // Check correct usage (e.g. 'strings 1000 5')
-    if (argc != 4) {
-        std::cerr << "Usage: " << argv[0] << " [string_length] [pattern_length] [repeat_count]" << std::endl;
+    // Constructor makes a copy of the pattern string, computes the height and width, and initialises the next_state
+    // vector.
+    explicit DenseStateTable(std::string const &P);
+
+    // Convert between 2-dim (row,column) index and the internal 1-dim vector index.
+    int coord(int i, int j) const;
+
+    // Look up the next state from a state, on reading a char.
+    State get_next_state(State prev_state, char prev_char) const;
+
+    // Construct the next_state table from the prefix function of the pattern, as StateTable::compute_state_table.
+    void compute_state_table();
+};
+
+template <typename State>
+DenseStateTable<State>::DenseStateTable(std::string const &P) {
+    pattern = P;
+    pattern_length = P.size();
+
+    if (pattern_length > std::numeric_limits<State>::max()) {
+        std::cerr << "Error: pattern is too long for the state type of DenseStateTable" << std::endl;
         exit(EXIT_FAILURE);
     }
 
-    std::chrono::time_point <std::chrono::steady_clock> t1, t2, t3;
-    long dt1, dt2;
-    std::string T, P;
+    // Assign a column to each unique char in the pattern, after column 0 for all other chars
+    char_index.fill(0);
+    width = 1;
+    for (unsigned char c: pattern) {
+        if (char_index[c] == 0) {
+            char_index[c] = width++;
+        }
+    }
+
+    height = pattern_length + 1;
+    next_state = std::vector<State>(height * width);
+
+    DenseStateTable::compute_state_table();
+}
+
+template <typename State>
+int DenseStateTable<State>::coord(int i, int j) const {
+    return j + i * width;
+}
+
+template <typename State>
+State DenseStateTable<State>::get_next_state(State prev_state, char prev_char) const {
+    return next_state[coord(prev_state, char_index[(unsigned char) prev_char])];
+}
+
+template <typename State>
+void DenseStateTable<State>::compute_state_table() {
+    fill_state_table(pattern, width, [this](char c) { return (int) char_index[(unsigned char) c]; },
+                     next_state.data());
+}
+
+/*
+ * @brief Find all occurrences of the substring pattern in the full text T, using a pre-computed DenseStateTable
+ *
+ * Each char of the text costs one array lookup to find its column, and one to find the next state. In state 0,
+ * every char other than the first char of the pattern stays in state 0, so the scan skips straight to the next
+ * occurrence of that char with memchr. An empty pattern never matches.
+ * @param[in]  T  full text string T
+ * @param[in]  t  instance of a DenseStateTable precomputed from a substring pattern P
+ * @return  vector of integer shifts to representing the relative position of the substring from the start of T
+ * */
+template <typename State>
+std::vector<int> dense_string_matcher(std::string const &T, DenseStateTable<State> const &t) {
+    std::vector<int> shifts;
+    if (t.pattern_length == 0) {
+        return shifts;
+    }
+
+    auto const *text = reinterpret_cast<unsigned char const *>(T.data());
+    State const *next_state = t.next_state.data();
+    uint16_t const *char_index = t.char_index.data();
+    int width = t.width;
+    int pattern_length = t.pattern_length;
+    char first_char = t.pattern[0];
+    int n = T.size();
+    int state = 0;
+
+    for (int i = 0; i < n; ) {
+        if (state == 0) {
+            auto const *next = static_cast<unsigned char const *>(std::memchr(text + i, first_char, n - i));
+            if (next == nullptr) {
+                break;
+            }
+            i = next - text;
+        }
+
+        state = next_state[state * width + char_index[text[i++]]];
+        if (state == pattern_length) {
+            shifts.push_back(i - pattern_length);
+        }
+    }
+    return shifts;
+}
+
+/*
+ * @brief Benchmark building a DenseStateTable and matching with it, checking the matches against expected shifts
+ *
+ * @param[in]  bench  benchmark harness
+ * @param[in]  T  full text string T
+ * @param[in]  P  substring pattern P
+ * @param[in]  expected  shifts of P in T
+ * @param[in]  fa_median  median time to find the matches with the State table, for the speedup
+ * */
+template <typename State>
+void run_dense_benchmarks(Benchmark &bench, std::string const &T, std::string const &P,
+                          std::vector<int> const &expected, double fa_median) {
+    // The dense table is built from the pattern alone
+    std::unique_ptr<DenseStateTable<State>> state_table;
+    bench.set_counter_unit("op", 1);
+    bench.run("State table (dense)", T.size(), [&]() { state_table.reset(); },
+              [&]() { state_table = std::make_unique<DenseStateTable<State>>(P); });
+    bench.set_counter_unit("char", T.size());
+    if (!state_table) {
+        state_table = std::make_unique<DenseStateTable<State>>(P);
+    }
+
     std::vector<int> shifts;
-    int dummy_val = 0; // Use for accumulation to prevent compiler optimising away ops
+    double median = bench.run("Substring matches (dense)", T.size(), []() {},
+                              [&]() { shifts = dense_string_matcher(T, *state_table); }, [&]() {
+        if (shifts != expected) {
+            std::cerr << "Dense state table matches do not match State table matches" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    });
+    if (median > 0 && fa_median > 0) {
+        bench.metric("x speedup vs State table", fa_median / median);
+    }
+}
 
-    int string_length = get_string_length(argv[1]);
-    int pattern_length = get_string_length(argv[2]);
-    int repeats = get_repeat_count(argv[3]);
+// Number of different inputs scanned in parallel with one compiled matcher
+const int COMPILED_MATCHER_INPUT_COUNT = 64;
+
+// Match of a pattern from a dictionary, reported by ac_string_matcher
+struct PatternMatch {
+    int pattern; // index of the pattern in the dictionary
+    int shift; // position of the pattern from the start of T
+};
+
+/*
+ * @brief Class to encapsulate an Aho-Corasick automaton computed for a dictionary of patterns.
+ *
+ * The patterns are stored in a trie, whose nodes are the states of the automaton, and the trie edges are completed
+ * into a full next_state table with the failure links, in breadth first order, so that every text char takes
+ * exactly one table lookup. Chars are remapped to a dense column index, with column 0 for every char that does
+ * not appear in any pattern. Each state also links to the nearest states for its suffixes that end a pattern, so
+ * all of the patterns ending at a position of the text can be reported without walking the failure links.
+ * */
+struct AhoCorasickAutomaton {
+    int height; // number of states
+    int width; // number of unique chars in the patterns, plus one for all other chars
+    std::vector<std::string> patterns;
+    std::array<int, 256> char_index; // column of each char
+    std::vector<int> next_state;
+    std::vector<int> terminal; // index of a pattern ending at each state, or -1
+    std::vector<int> duplicate; // index of the next pattern identical to each pattern, or -1
+    std::vector<int> output; // nearest state to each state (itself, or by failure links) where a pattern ends, or -1
+    std::vector<int> dictionary_link; // nearest state by failure links (excluding itself) where a pattern ends, or -1
+
+    // Constructor makes a copy of the patterns, and computes the automaton. Empty patterns never match.
+    explicit AhoCorasickAutomaton(std::vector<std::string> const &dictionary);
+
+    // Convert between 2-dim (row,column) index and the internal 1-dim vector index.
+    int coord(int i, int j) const;
+
+    // Look up the next state from a state, on reading a char.
+    int get_next_state(int prev_state, char prev_char) const;
+
+    // Construct the trie of the patterns, then complete the next_state table and output links.
+    void compute_automaton();
+};
+
+AhoCorasickAutomaton::AhoCorasickAutomaton(std::vector<std::string> const &dictionary) {
+    patterns = dictionary;
+
+    // Assign a column to each unique char in the patterns
+    char_index.fill(0);
+    width = 1;
+    for (auto const &pattern: patterns) {
+        for (unsigned char c: pattern) {
+            if (char_index[c] == 0) {
+                char_index[c] = width++;
+            }
+        }
+    }
+
+    AhoCorasickAutomaton::compute_automaton();
+}
+
+int AhoCorasickAutomaton::coord(int i, int j) const {
+    return j + i * width;
+}
+
+int AhoCorasickAutomaton::get_next_state(int prev_state, char prev_char) const {
+    return next_state[coord(prev_state, char_index[(unsigned char) prev_char])];
+}
+
+void AhoCorasickAutomaton::compute_automaton() {
+    // Build the trie, where a missing edge is -1
+    height = 1;
+    next_state = std::vector<int>(width, -1);
+    terminal = std::vector<int>(1, -1);
+    duplicate = std::vector<int>(patterns.size(), -1);
+
+    for (int p = 0; p < (int) patterns.size(); p++) {
+        if (patterns[p].empty()) {
+            continue;
+        }
+
+        int state = 0;
+        for (unsigned char c: patterns[p]) {
+            int col = char_index[c];
+            if (next_state[coord(state, col)] < 0) {
+                next_state[coord(state, col)] = height++;
+                next_state.resize(height * width, -1);
+                terminal.push_back(-1);
+            }
+            state = next_state[coord(state, col)];
+        }
+
+        duplicate[p] = terminal[state];
+        terminal[state] = p;
+    }
+
+    // Complete the table in breadth first order, so that the failure state of each state (which is shallower) has
+    // been completed first. A missing edge from a state follows the same edge from its failure state.
+    std::vector<int> failure(height, 0);
+    output = std::vector<int>(height, -1);
+    dictionary_link = std::vector<int>(height, -1);
+    std::queue<int> queue;
+
+    for (int c = 0; c < width; c++) {
+        int child = next_state[coord(0, c)];
+        if (child < 0) {
+            next_state[coord(0, c)] = 0;
+        } else {
+            failure[child] = 0;
+            queue.push(child);
+        }
+    }
+
+    while (!queue.empty()) {
+        int state = queue.front();
+        queue.pop();
+
+        output[state] = (terminal[state] >= 0) ? state : output[failure[state]];
+        dictionary_link[state] = output[failure[state]];
+
+        for (int c = 0; c < width; c++) {
+            int child = next_state[coord(state, c)];
+            if (child < 0) {
+                next_state[coord(state, c)] = next_state[coord(failure[state], c)];
+            } else {
+                failure[child] = next_state[coord(failure[state], c)];
+                queue.push(child);
+            }
+        }
+    }
+
+}
+
+/*
+ * @brief Find all occurrences of every pattern of a dictionary in the full text T, in a single pass
+ *
+ * @param[in]  T  full text string T
+ * @param[in]  t  instance of an AhoCorasickAutomaton precomputed from the dictionary of patterns
+ * @return  vector of matches, in order of the end position of each match in T
+ * */
+std::vector<PatternMatch> ac_string_matcher(std::string const &T, AhoCorasickAutomaton const &t) {
+    std::vector<PatternMatch> matches;
+    int state = 0;
+
+    for (int i = 0; i < (int) T.size(); i++) {
+        state = t.get_next_state(state, T[i]);
+
+        // Report every pattern ending at T[i], from the longest down
+        for (int s = t.output[state]; s >= 0; s = t.dictionary_link[s]) {
+            for (int p = t.terminal[s]; p >= 0; p = t.duplicate[p]) {
+                matches.push_back(PatternMatch{p, (i + 1) - (int) t.patterns[p].size()});
+            }
+        }
+    }
+    return matches;
+}
 
-    // Make sure that pattern length <= string length
-    if (pattern_length > string_length) {
-        std::cerr << "Error: pattern_length must be shorter or equal to string_length" << std::endl;
+int get_random_index(std::mt19937 &generator, int index_max) {
+    return generator() % index_max;
+}
+
+// Number of queries timed together against the suffix index, half of them substrings of the text
+const int SUFFIX_INDEX_QUERY_COUNT = 1000;
+
+// Number of the queries whose occurrences are also checked against a search of the full text
+const int SUFFIX_INDEX_CHECKED_QUERY_COUNT = 16;
+
+/*
+ * @brief Parse argument to extract the name of a file to be read into memory, usually ending with .txt
+ *
+ * @param[in]  path  argv element corresponding to the file path
+ * @return  contents of the file
+ * */
+std::string read_text_file(char const *path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "could not open " << path << std::endl;
         exit(EXIT_FAILURE);
     }
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+/*
+ * @brief Benchmark building, saving and loading a suffix index of a text, and the latency of its queries
+ *
+ * The queries are substrings of T at random positions, which occur at least once, and the same substrings
+ * reversed, which mostly do not occur, so both the found and the missing cases of the binary search are timed.
+ * Every occurrence located is checked to hold its query, and the first queries are also checked against a search of
+ * the full text.
+ * @param[in]  bench  benchmark harness
+ * @param[in]  T  full text string T
+ * @param[in]  pattern_length  length of the queries
+ * @param[in]  generator  random generator for the positions of the queries
+ * @param[in]  fa_median  median time to find the matches of one pattern with the State table, for the speedup, or 0
+ * */
+void run_index_benchmarks(Benchmark &bench, std::string const &T, int pattern_length, std::mt19937 &generator,
+                          double fa_median) {
+    std::vector<std::string> queries;
+    for (int q = 0; q < SUFFIX_INDEX_QUERY_COUNT / 2; q++) {
+        std::string query = T.substr(get_random_index(generator, T.size() - pattern_length + 1), pattern_length);
+        queries.push_back(query);
+        std::reverse(query.begin(), query.end());
+        queries.push_back(query);
+    }
+
+    // Construct the index, with hardware counters per char of the text
+    std::unique_ptr<SuffixIndex> index;
+    bench.set_counter_unit("char", T.size());
+    bench.run("Suffix index", T.size(), [&]() { index.reset(); },
+              [&]() { index = std::make_unique<SuffixIndex>(SuffixIndex::build(T)); });
+    if (!index) {
+        index = std::make_unique<SuffixIndex>(SuffixIndex::build(T));
+    }
+    bench.metric("bytes", index->size_bytes());
+    bench.metric("bytes/char", (double) index->size_bytes() / std::max<std::size_t>(T.size(), 1));
+
+    // Save the index to a file and map it back in, as a separate process would at startup
+    std::string index_path = (std::filesystem::temp_directory_path() / "match_suffix_index.bin").string();
+    bench.set_counter_unit("op", 1);
+    bench.run("Save suffix index", T.size(), [&]() { index->save(index_path); });
+    index->save(index_path);
+
+    std::unique_ptr<SuffixIndex> loaded_index;
+    bench.run("Load suffix index (mmap)", T.size(), [&]() { loaded_index.reset(); },
+              [&]() { loaded_index = std::make_unique<SuffixIndex>(SuffixIndex::load(index_path)); });
+    if (!loaded_index) {
+        loaded_index = std::make_unique<SuffixIndex>(SuffixIndex::load(index_path));
+    }
+    std::remove(index_path.c_str());
+    SuffixIndex const &suffix_index = *loaded_index;
+
+    // Times are per query
+    std::vector<std::size_t> counts(queries.size());
+    std::vector<std::vector<int>> positions(queries.size());
+    std::string suffix = " (" + std::to_string(queries.size()) + " queries)";
+    bench.set_ops(queries.size());
+
+    double median = bench.run("Suffix index count" + suffix, T.size(), []() {}, [&]() {
+        for (std::size_t q = 0; q < queries.size(); q++) {
+            counts[q] = suffix_index.count(queries[q]);
+        }
+    });
+    if (median > 0 && fa_median > 0) {
+        bench.metric("x speedup vs State table", fa_median / median);
+    }
+
+    median = bench.run("Suffix index locate" + suffix, T.size(), []() {}, [&]() {
+        for (std::size_t q = 0; q < queries.size(); q++) {
+            positions[q] = suffix_index.locate(queries[q]);
+        }
+    }, [&]() {
+        for (std::size_t q = 0; q < queries.size(); q++) {
+            // counts is only filled by the count benchmark, which the filter may skip, so count again here
+            bool valid = positions[q].size() == suffix_index.count(queries[q]) && (q % 2 == 1 || !positions[q].empty());
+            for (std::size_t k = 0; valid && k < positions[q].size(); k++) {
+                valid = (k == 0 || positions[q][k - 1] < positions[q][k]) &&
+                        T.compare(positions[q][k], queries[q].size(), queries[q]) == 0;
+            }
+
+            if (valid && q < SUFFIX_INDEX_CHECKED_QUERY_COUNT) {
+                std::vector<int> expected;
+                for (auto pos = T.find(queries[q]); pos != std::string::npos; pos = T.find(queries[q], pos + 1)) {
+                    expected.push_back(pos);
+                }
+                valid = positions[q] == expected;
+            }
+
+            if (!valid) {
+                std::cerr << "Suffix index matches do not match a search of the text" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+        }
+    });
+    if (median > 0 && fa_median > 0) {
+        bench.metric("x speedup vs State table", fa_median / median);
+    }
+    bench.set_ops(1);
+}
+
+// Size of the chunks read by the streaming file scan
+const std::size_t SCAN_CHUNK_SIZE = 1 << 20;
+
+// Number of shards per thread scanned by the parallel file scan
+const int SCAN_SHARDS_PER_THREAD = 4;
+
+/*
+ * @brief Benchmark the streaming (chunked read), mapped and parallel sharded scans of a file for a pattern
+ *
+ * The matches from the three scans are checked against each other, so a file of any size can be scanned without
+ * building the State table for the full text.
+ * @param[in]  bench  benchmark harness
+ * @param[in]  pool  thread pool for the parallel scan
+ * @param[in]  path  path of file to be scanned
+ * @param[in]  P  substring pattern string
+ * */
+void run_file_scan_benchmarks(Benchmark &bench, TaskPool &pool, std::string const &path, std::string const &P) {
+    long long file_size = std::filesystem::file_size(path);
+    std::vector<long long> chunked_matches, mapped_matches, parallel_matches;
+
+    auto const matcher = CompiledMatcher::compile(P);
+    int shard_count = SCAN_SHARDS_PER_THREAD * pool.size();
+    std::vector<std::vector<long long>> shard_matches(shard_count);
+
+    // The chunked scan gives the matches the other scans are checked against
+    scan_file(matcher, path, SCAN_CHUNK_SIZE,
+              [&chunked_matches](long long position) { chunked_matches.push_back(position); });
+    bench.log() << "The pattern occurs " << chunked_matches.size() << " times in " << file_size << " bytes"
+                << std::endl;
+
+    double megabytes = file_size / 1e6;
+    bench.set_counter_unit("byte", file_size);
+
+    auto throughput = [&](double median) {
+        if (median > 0) {
+            bench.metric("MB/s", megabytes / median);
+        }
+    };
+    auto check = [](std::vector<long long> const &matches, std::vector<long long> const &expected) {
+        if (matches != expected) {
+            std::cerr << "File scan matches do not match between the chunked, mapped and parallel scans" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    };
+
+    std::vector<long long> matches;
+    throughput(bench.run("Scan file (chunked)", file_size, [&]() { matches.clear(); }, [&]() {
+        scan_file(matcher, path, SCAN_CHUNK_SIZE, [&matches](long long position) { matches.push_back(position); });
+    }, [&]() { check(matches, chunked_matches); }));
+
+    throughput(bench.run("Scan file (mapped)", file_size, [&]() { mapped_matches.clear(); }, [&]() {
+        scan_file_mapped(matcher, path, [&mapped_matches](long long position) { mapped_matches.push_back(position); });
+    }, [&]() { check(mapped_matches, chunked_matches); }));
+
+    // Each shard appends to its own buffer, so no locking is needed, and the shards are in file order
+    bench.set_threads(pool.size());
+    throughput(bench.run("Scan file (parallel, " + std::to_string(pool.size()) + " threads)", file_size, [&]() {
+        for (auto &shard: shard_matches) {
+            shard.clear();
+        }
+    }, [&]() {
+        scan_file_parallel(pool, matcher, path, shard_count, [&shard_matches](int shard, long long position) {
+            shard_matches[shard].push_back(position);
+        });
+    }, [&]() {
+        parallel_matches.clear();
+        for (auto const &shard: shard_matches) {
+            parallel_matches.insert(parallel_matches.end(), shard.begin(), shard.end());
+        }
+        check(parallel_matches, chunked_matches);
+    }));
+    bench.set_threads(1);
+    bench.set_counter_unit("op", 1);
+}
 
+/*
+ * @brief Benchmark the string matchers, for a pattern taken from a random text
+ *
+ * @param[in]  bench  benchmark harness
+ * @param[in]  pool  thread pool for the compiled matcher
+ * @param[in]  string_length  length of the text
+ * @param[in]  pattern_length  length of the pattern
+ * @param[in]  alphabet  alphabet of the text
+ * @param[in]  seed  seed of the text, the other inputs and the positions of the patterns
+ * */
+void run_match_benchmarks(Benchmark &bench, TaskPool &pool, int string_length, int pattern_length,
+                          Alphabet alphabet, uint64_t seed) {
     // Example strings T and P from the book
     //T = "GTAACAGTAAACG";
     //P = "AAC";
 
-    // Create random alphanumeric text string T of user specified length
-    T = generate_random_alphanumeric_string(string_length);
+    // Create random text string T of user specified length, from the first stream of the seed
+    std::string T = generate_random_string(string_length, alphabet, derive_seed(seed, 0), pool);
+    std::mt19937 generator(seed);
 
     // Set P to be a substring of T of a user defined length with a random start position to guarantee a match
-    int start_index = get_random_index(T.size() - 1 - pattern_length);
-    P = T.substr(start_index, pattern_length);
+    int start_index = get_random_index(generator, T.size() - 1 - pattern_length);
+    std::string P = T.substr(start_index, pattern_length);
+
+    // Hardware counters are reported per char of the text, apart from the pattern-only steps
+    bench.set_counter_unit("char", string_length);
+
+    // Construct next_state table
+    std::unique_ptr<StateTable> state_table;
+    bench.run("State table", string_length, [&]() { state_table.reset(); },
+              [&]() { state_table = std::make_unique<StateTable>(T, P); });
+    if (!state_table) {
+        state_table = std::make_unique<StateTable>(T, P);
+    }
+
+    // Print intermediate State table for debugging
+    //std::cout << *state_table << std::endl;
+
+    // Find and report substring matches
+    std::vector<int> shifts = fa_string_matcher(T, *state_table);
+    std::vector<int> fa_shifts;
+    double fa_median = bench.run("Substring matches", string_length, []() {},
+                                 [&]() { fa_shifts = fa_string_matcher(T, *state_table); }, [&]() {
+        if (fa_shifts != shifts) {
+            std::cerr << "State table matches differ between runs" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    });
+
+    bench.log() << "The pattern occurs with shifts: [";
+    for (const auto& i: shifts) {bench.log() << " " << i;}
+    bench.log() << "]" << std::endl;
+
+    // Compare with the dense state table, using the narrowest state type for the pattern
+    if (pattern_length < std::numeric_limits<uint8_t>::max()) {
+        run_dense_benchmarks<uint8_t>(bench, T, P, shifts, fa_median);
+    } else {
+        run_dense_benchmarks<uint16_t>(bench, T, P, shifts, fa_median);
+    }
+
+    // Compare the latency of queries against an index of the text with the scan of the State table
+    run_index_benchmarks(bench, T, pattern_length, generator, fa_median);
+    bench.set_counter_unit("char", string_length);
+
+    // Compile a pattern-only matcher, save it to a file and map it back in, as a separate process would at startup,
+    // then share the mapped matcher across threads scanning many different inputs
+    std::string matcher_path = (std::filesystem::temp_directory_path() / "match_automaton.bin").string();
+
+    std::unique_ptr<CompiledMatcher> compiled_matcher;
+    bench.set_counter_unit("op", 1);
+    bench.run("Compile matcher", pattern_length, [&]() { compiled_matcher.reset(); },
+              [&]() { compiled_matcher = std::make_unique<CompiledMatcher>(CompiledMatcher::compile(P)); });
+    if (!compiled_matcher) {
+        compiled_matcher = std::make_unique<CompiledMatcher>(CompiledMatcher::compile(P));
+    }
+    bench.run("Save matcher", pattern_length, [&]() { compiled_matcher->save(matcher_path); });
+    compiled_matcher->save(matcher_path);
+
+    std::unique_ptr<CompiledMatcher> loaded_matcher;
+    bench.run("Load matcher (mmap)", pattern_length, [&]() { loaded_matcher.reset(); },
+              [&]() { loaded_matcher = std::make_unique<CompiledMatcher>(CompiledMatcher::load(matcher_path)); });
+    if (!loaded_matcher) {
+        loaded_matcher = std::make_unique<CompiledMatcher>(CompiledMatcher::load(matcher_path));
+    }
+    std::remove(matcher_path.c_str());
+    CompiledMatcher const &matcher = *loaded_matcher;
+
+    if (compiled_string_matcher(T, matcher) != shifts) {
+        std::cerr << "Compiled matcher matches do not match State table matches" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // Inputs of the same length as T, each with P spliced in at a random position
+    std::vector<std::string> inputs(COMPILED_MATCHER_INPUT_COUNT);
+    for (int k = 0; k < COMPILED_MATCHER_INPUT_COUNT; k++) {
+        inputs[k] = generate_random_string(string_length, alphabet, derive_seed(seed, k + 1));
+        inputs[k].replace(get_random_index(generator, string_length - pattern_length + 1), pattern_length, P);
+    }
+
+    std::vector<std::vector<int>> input_shifts(COMPILED_MATCHER_INPUT_COUNT);
+
+    bench.set_counter_unit("char", (double) COMPILED_MATCHER_INPUT_COUNT * string_length);
+    bench.set_threads(pool.size());
+    double median = bench.run("Substring matches (compiled, " + std::to_string(COMPILED_MATCHER_INPUT_COUNT)
+                              + " inputs, " + std::to_string(pool.size()) + " threads)", string_length, []() {}, [&]() {
+        pool.parallel_for(0, COMPILED_MATCHER_INPUT_COUNT, 1, [&](int lo, int hi) {
+            for (int k = lo; k < hi; k++) {
+                input_shifts[k] = compiled_string_matcher(inputs[k], matcher);
+            }
+        });
+    }, [&]() {
+        for (int k = 0; k < COMPILED_MATCHER_INPUT_COUNT; k++) {
+            std::vector<int> expected;
+            for (auto pos = inputs[k].find(P); pos != std::string::npos; pos = inputs[k].find(P, pos + 1)) {
+                expected.push_back(pos);
+            }
+            if (input_shifts[k] != expected) {
+                std::cerr << "Compiled matcher matches do not match a search of each input" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+        }
+    });
+    if (median > 0) {
+        bench.metric("MB/s", (double) COMPILED_MATCHER_INPUT_COUNT * string_length / 1e6 / median);
+    }
+    bench.set_threads(1);
+    bench.set_counter_unit("char", string_length);
+
+    // Compare with the state table built by the naive method, for short patterns
+    if (pattern_length <= NAIVE_STATE_TABLE_MAX_PATTERN_LENGTH) {
+        auto naive_table = *state_table;
 
-    dt1 = 0;
-    dt2 = 0;
+        bench.run("State table (naive)", string_length, []() {}, [&]() { naive_table.compute_state_table_naive(); },
+                  [&]() {
+            if (naive_table.next_state != state_table->next_state) {
+                std::cerr << "State table does not match naive state table" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+        });
+    }
 
-    for (int i = 0; i < repeats; i++) {
+    // Search for a dictionary of patterns at once, including P and other substrings of T of the same length
+    std::vector<std::string> dictionary{P};
+    for (int d = 1; d < DICTIONARY_SIZE; d++) {
+        dictionary.push_back(T.substr(get_random_index(generator, T.size() - pattern_length + 1), pattern_length));
+    }
 
-        t1 = std::chrono::steady_clock::now();
+    std::string patterns = " (" + std::to_string(DICTIONARY_SIZE) + " patterns)";
 
-        // Construct next_state table
-        auto state_table = StateTable(T, P);
-        t2 = std::chrono::steady_clock::now();
+    // Construct Aho-Corasick automaton
+    std::unique_ptr<AhoCorasickAutomaton> automaton;
+    bench.run("Aho-Corasick automaton" + patterns, string_length, [&]() { automaton.reset(); },
+              [&]() { automaton = std::make_unique<AhoCorasickAutomaton>(dictionary); });
+    if (!automaton) {
+        automaton = std::make_unique<AhoCorasickAutomaton>(dictionary);
+    }
 
-        // Find and report substring matches
-        shifts = fa_string_matcher(T, state_table);
+    // Find and report matches of every pattern, checking the matches of each pattern against a search for that
+    // pattern alone
+    std::vector<PatternMatch> matches;
+    bench.run("Dictionary matches" + patterns, string_length, []() {},
+              [&]() { matches = ac_string_matcher(T, *automaton); }, [&]() {
+        std::vector<std::vector<int>> pattern_shifts(DICTIONARY_SIZE);
+        for (auto const &match: matches) {
+            pattern_shifts[match.pattern].push_back(match.shift);
+        }
+        for (int d = 0; d < DICTIONARY_SIZE; d++) {
+            std::vector<int> expected;
+            for (auto pos = T.find(dictionary[d]); pos != std::string::npos; pos = T.find(dictionary[d], pos + 1)) {
+                expected.push_back(pos);
+            }
+            std::sort(pattern_shifts[d].begin(), pattern_shifts[d].end());
+            if (pattern_shifts[d] != expected || (d == 0 && expected != shifts)) {
+                std::cerr << "Aho-Corasick matches do not match a search for each pattern" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+        }
+    });
+    bench.set_counter_unit("op", 1);
+}
 
-        t3 = std::chrono::steady_clock::now();
+int main(int argc, char *argv[]) {
+    BenchmarkOptions options = parse_benchmark_options(argc, argv);
+    std::string flags = " [--warmup=N] [--samples=N] [--format=text|csv|json] [--output=path] [--filter=name]"
+                        " [--counters]";
+
+    // Scan a file of any size for a pattern (e.g. 'match scan text.txt GATTACA 5')
+    if (argc >= 2 && std::strcmp(argv[1], "scan") == 0) {
+        if (argc != 5 && argc != 6) {
+            std::cerr << "Usage: " << argv[0] << " scan [file_path] [pattern] [repeat_count] [thread_count (optional)]"
+                      << flags << std::endl;
+            exit(EXIT_FAILURE);
+        }
 
-        // Accumulate measurement time
-        dt1 += std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
-        dt2 += std::chrono::duration_cast<std::chrono::microseconds>(t3 - t2).count();
+        int repeats = get_repeat_count(argv[4]);
+        int threads = (argc == 6) ? get_thread_count(argv[5]) : std::max((int) std::thread::hardware_concurrency(), 1);
 
-        // Print intermediate Transform table and Transformed string Z for debugging
-        //std::cout << state_table << std::endl;
-        std::cout << "The pattern occurs with shifts: [";
-        for (const auto& i: shifts) {std::cout << " " << i;}
-        std::cout << "]" << std::endl;
+        Benchmark bench("match", options, repeats);
+        TaskPool pool(threads);
+        run_file_scan_benchmarks(bench, pool, argv[2], argv[3]);
 
-        // Use values in the sorted array to prevent the compiler optimising away ops
-        dummy_val += shifts.size();
+        bench.report();
+        exit(EXIT_SUCCESS);
     }
-    std::cout << "Time to compute State table: " << ((float) dt1 / (1e6 * repeats)) << " s (average per op)" << std::endl;
-    std::cout << "Time to find substring matches: " << ((float) dt2 / (1e6 * repeats)) << " s (average per op)" << std::endl;
 
-    // Dump final accumulated value to prevent compiler optimising away ops
-    std::cout << dummy_val << std::endl;
+    // Index a file of any size up to SuffixIndex::MAX_TEXT_LENGTH and query it (e.g. 'match index text.txt 8 5')
+    if (argc >= 2 && std::strcmp(argv[1], "index") == 0) {
+        if (argc != 5) {
+            std::cerr << "Usage: " << argv[0] << " index [file_path] [pattern_length] [repeat_count]" << flags
+                      << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        std::string T = read_text_file(argv[2]);
+        int pattern_length = get_repeat_count(argv[3]);
+        int repeats = get_repeat_count(argv[4]);
+        if (pattern_length < 1 || (std::size_t) pattern_length > T.size()) {
+            std::cerr << "Error: pattern_length must be >= 1 and <= the length of the file" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        Benchmark bench("match", options, repeats);
+        std::mt19937 generator(options.seed);
+        bench.log() << "Indexing " << T.size() << " bytes of " << argv[2] << std::endl;
+        run_index_benchmarks(bench, T, pattern_length, generator, 0);
+
+        bench.report();
+        exit(EXIT_SUCCESS);
+    }
+
+    // Check correct usage (e.g. 'strings 1000 5')
+    if (argc != 4 && argc != 5) {
+        std::cerr << "Usage: " << argv[0] << " [string_length] [pattern_length] [repeat_count] [thread_count (optional)]"
+                  << flags << " [--sweep=sizes] [--seed=N] [--input=alphanumeric|dna|text]" << std::endl;
+        std::cerr << "       " << argv[0] << " scan [file_path] [pattern] [repeat_count] [thread_count (optional)]"
+                  << flags << std::endl;
+        std::cerr << "       " << argv[0] << " index [file_path] [pattern_length] [repeat_count]" << flags
+                  << " [--seed=N]" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    Alphabet alphabet = parse_alphabet(options.input.empty() ? "alphanumeric" : options.input);
+    int string_length = get_string_length(argv[1]);
+    int pattern_length = get_string_length(argv[2]);
+    int repeats = get_repeat_count(argv[3]);
+    int threads = (argc == 5) ? get_thread_count(argv[4]) : std::max((int) std::thread::hardware_concurrency(), 1);
+
+    // The dense matchers never match an empty pattern, whereas the other matchers match it at every shift
+    if (pattern_length < 1) {
+        std::cerr << "Error: pattern_length must be >= 1" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    Benchmark bench("match", options, repeats);
+    TaskPool pool(threads);
+
+    // The sweep sizes are string lengths, for the same pattern length
+    for (long long size: bench.sizes(string_length)) {
+        // Make sure that pattern length <= string length
+        if (size > 40000 || pattern_length > size) {
+            std::cerr << "Error: pattern_length must be shorter or equal to string_length, which must be <= 40000"
+                      << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        run_match_benchmarks(bench, pool, size, pattern_length, alphabet, options.seed);
+    }
 
+    bench.report();
     exit(EXIT_SUCCESS);
 }
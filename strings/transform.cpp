@@ -1,10 +1,18 @@
-#include <chrono>
+#include <algorithm>
+#include <climits>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <iomanip>
+#include <memory>
+#include <random>
 #include <string>
+#include <thread>
 #include <vector>
-#include "include/randstring.hpp"
+#include "../include/benchmark.hpp"
+#include "../include/randgen.hpp"
+#include "include/wavefront.hpp"
 
 /*
  * @brief Parse argument to extract user string length
@@ -63,6 +71,61 @@ int get_repeat_count(char *param) {
     return (int) repeat_count;
 }
 
+/*
+ * @brief Parse argument to extract user number of threads
+ *
+ * @param[in]  param  argv element corresponding to thread count
+ * @return  (int)thread_count  parsed thread count, casted to int
+ * */
+int get_thread_count(char *param) {
+    char *endptr;
+    long thread_count;
+
+    errno = 0;
+    thread_count = std::strtol(param, &endptr, 10);
+
+    if (errno != 0) {
+        perror("strtol");
+        exit(EXIT_FAILURE);
+    }
+
+    if (endptr == param) {
+        std::cerr << "could not parse thread_count as an integer" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    if (thread_count < 1) {
+        std::cerr << "thread_count parameter must be >= 1" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    return (int) thread_count;
+}
+
+// Benchmarks run by the transform binary, selected by the optional mode argument
+enum transform_mode { TABLE, THROUGHPUT };
+
+// Number of candidate strings compared with the query string in throughput mode
+const int BATCH_CANDIDATE_COUNT = 1000;
+
+/*
+ * @brief Parse argument to extract user benchmark mode
+ *
+ * @param[in]  param  argv element corresponding to mode ("table" or "throughput")
+ * @return  (transform_mode)mode  parsed benchmark mode
+ * */
+transform_mode get_mode(char *param) {
+    if (std::strcmp(param, "table") == 0) {
+        return TABLE;
+    }
+    if (std::strcmp(param, "throughput") == 0) {
+        return THROUGHPUT;
+    }
+
+    std::cerr << "mode parameter must be one of: table, throughput" << std::endl;
+    exit(EXIT_FAILURE);
+}
+
 // Enum for string transformation operations
 enum op_type { COPY, REPLACE, INSERT, DELETE, NOOP };
 
@@ -71,6 +134,10 @@ struct Operation {
     char apply_on;
 };
 
+bool operator==(Operation const &a, Operation const &b) {
+    return a.type == b.type && a.apply_on == b.apply_on;
+}
+
 /*
  * @brief Class to encapsulate transform tables computed for two strings.
  *
@@ -102,6 +169,9 @@ struct TransformTable {
     // Constructor makes a copy of the input strings, computes the height and width, and initialises the cost/op vectors.
     TransformTable(std::string const &str_x, std::string const &str_y, int cC, int cR, int cD, int cI);
 
+    // As above, but computes the tables in parallel on the thread pool.
+    TransformTable(std::string const &str_x, std::string const &str_y, int cC, int cR, int cD, int cI, TaskPool &pool);
+
     // Convert between 2-dim (row,column) index and the internal 1-dim vector index.
     int coord(int i, int j) const;
 
@@ -109,6 +179,16 @@ struct TransformTable {
     // length m and Y of length n. The value of cost[i,j] is the minimum cost of transforming the prefix Xi into the
     // prefix Yj. The operation in op[i,j] is the last operation performed when transforming Xi into Yj.
     void compute_transform_tables();
+
+    // Construct the cost and op tables as a wavefront of tiles, in parallel on the thread pool.
+    void compute_transform_tables(TaskPool &pool);
+
+    // Create the first row of insert operations and column of delete operations.
+    void compute_transform_borders();
+
+    // Compute the values of the inner tables for rows [i_lo, i_hi) and columns [j_lo, j_hi), where the row above and
+    // the column to the left of the tile have already been computed.
+    void compute_transform_tile(int i_lo, int i_hi, int j_lo, int j_hi);
 };
 
 TransformTable::TransformTable(std::string const &str_x, std::string const &str_y, int cC, int cR, int cD, int cI) {
@@ -132,12 +212,44 @@ TransformTable::TransformTable(std::string const &str_x, std::string const &str_
     TransformTable::compute_transform_tables();
 }
 
+TransformTable::TransformTable(std::string const &str_x, std::string const &str_y, int cC, int cR, int cD, int cI,
+                               TaskPool &pool) {
+    X = str_x;
+    Y = str_y;
+    cc = cC;
+    cr = cR;
+    cd = cD;
+    ci = cI;
+    height = X.size() + 1;
+    width = Y.size() + 1;
+    cost = std::vector<int>(height * width);
+    op = std::vector<Operation>(height * width);
+
+    // Populate cost and op tables for the provided strings, in parallel
+    TransformTable::compute_transform_tables(pool);
+}
+
 
 int TransformTable::coord(int i, int j) const {
     return j + i * width;
 }
 
 void TransformTable::compute_transform_tables() {
+    compute_transform_borders();
+
+    // Compute values for inner cost and op tables
+    compute_transform_tile(1, height, 1, width);
+}
+
+void TransformTable::compute_transform_tables(TaskPool &pool) {
+    compute_transform_borders();
+
+    // Compute values for inner cost and op tables, a tile at a time
+    wavefront(pool, 1, height, 1, width, WAVEFRONT_TILE_SIZE,
+              [this](int i_lo, int i_hi, int j_lo, int j_hi) { compute_transform_tile(i_lo, i_hi, j_lo, j_hi); });
+}
+
+void TransformTable::compute_transform_borders() {
     cost[coord(0,0)] = 0;
     op[coord(0,0)] = Operation{op_type::NOOP, '-'};
 
@@ -152,10 +264,12 @@ void TransformTable::compute_transform_tables() {
         cost[coord(0, j)] = j * ci;
         op[coord(0, j)] = Operation{op_type::INSERT, Y[j - 1]};
     }
+}
 
+void TransformTable::compute_transform_tile(int i_lo, int i_hi, int j_lo, int j_hi) {
     // Compute values for inner cost and op tables by determining which operation applies to minimise cost
-    for (int i = 1; i < height; i++) {
-        for (int j = 1; j < width; j++) {
+    for (int i = i_lo; i < i_hi; i++) {
+        for (int j = j_lo; j < j_hi; j++) {
             // Possible operation i
             if (X[i - 1] == Y[j - 1]) {
                 cost[coord(i, j)] = cost[coord(i - 1, j - 1)] + cc;
@@ -212,43 +326,547 @@ std::ostream &operator<<(std::ostream &out, TransformTable const &t) {
 }
 
 /*
- * @brief Recursively assemble a set of instructions to transform the string X to Y using a pre-computed TransformTable
+ * @brief Assemble a set of instructions to transform the string X to Y using a pre-computed TransformTable
  *
+ * Walks back through the op table from (i, j), following each op to the cell it was derived from, and appends each
+ * op as it is found. The instructions are therefore in reverse order, ending with the no-op at (0, 0). A
+ * transformation takes at most i + j + 1 ops, so the buffer is reserved once up front.
  * @param[in]  t  instance of an TransformTable precomputed from two strings
  * @param[in]  i  row index into t (and the original X, Y strings)
  * @param[in]  j  column index into t (and the original X, Y strings)
- * @return  vector of instructions to transform the string X to Y
+ * @param[out]  op_vector  vector cleared and filled with the instructions to transform X to Y, in reverse order
+ * */
+void traceback_transformation(TransformTable const &t, int i, int j, std::vector<Operation> &op_vector) {
+    op_vector.clear();
+    op_vector.reserve(i + j + 1);
+
+    while (true) {
+        Operation const &op = t.op[t.coord(i, j)];
+        op_vector.push_back(op);
+
+        switch (op.type) {
+            case op_type::COPY:
+            case op_type::REPLACE:
+                i--;
+                j--;
+                break;
+            case op_type::DELETE:
+                i--;
+                break;
+            case op_type::INSERT:
+                j--;
+                break;
+            case op_type::NOOP:
+                return;
+        }
+    }
+}
+
+// Enum for the 2-bit op codes packed in a CompactTransformTable. A diagonal op is a copy when X[i - 1] == Y[j - 1],
+// and a replace otherwise, so the two do not need separate codes.
+enum packed_op_type : uint8_t { PACKED_NOOP, PACKED_DIAGONAL, PACKED_DELETE, PACKED_INSERT };
+
+/*
+ * @brief Expand a packed op code into a full Operation, deriving the char it applies on from X and Y
+ *
+ * @param[in]  type  packed op code of cell (i, j)
+ * @param[in]  X, Y  strings the table was computed for
+ * @param[in]  i, j  row and column index of the cell
+ * @return  operation of the cell
+ * */
+Operation unpack_operation(packed_op_type type, std::string const &X, std::string const &Y, int i, int j) {
+    switch (type) {
+        case PACKED_DIAGONAL:
+            return Operation{(X[i - 1] == Y[j - 1]) ? op_type::COPY : op_type::REPLACE, Y[j - 1]};
+        case PACKED_DELETE:
+            return Operation{op_type::DELETE, X[i - 1]};
+        case PACKED_INSERT:
+            return Operation{op_type::INSERT, Y[j - 1]};
+        default:
+            return Operation{op_type::NOOP, '-'};
+    }
+}
+
+/*
+ * @brief Class to encapsulate a compact op table computed for two strings.
+ *
+ * Holds the same ops as a TransformTable, in 2 bits per cell rather than the 12 bytes per cell of a full int cost
+ * and Operation. The char an op applies on is derived from X and Y when the op is read back, and only two rows of
+ * costs are kept while the table is computed, as traceback only needs the ops. The cost of the whole
+ * transformation, cost[m,n], is kept once the table is complete.
+ * */
+struct CompactTransformTable {
+    int height;
+    int width;
+    int row_bytes; // Bytes per row of packed ops, holding 4 cells per byte
+    std::string X;
+    std::string Y;
+    int cc, cr, cd, ci; // Costs for copy, replace, delete and insert operations
+    int final_cost;
+    std::vector<uint8_t> op;
+    std::vector<int> above, row; // Costs of the previous and current rows, while the table is computed
+
+    // Constructor makes a copy of the input strings, computes the height and width, and initialises the op vector.
+    CompactTransformTable(std::string const &str_x, std::string const &str_y, int cC, int cR, int cD, int cI);
+
+    // Constructor for an empty table, to be filled by assign.
+    CompactTransformTable(int cC, int cR, int cD, int cI);
+
+    // Recompute the table for a new pair of strings, reusing the memory of the previous strings and tables.
+    void assign(std::string const &str_x, std::string const &str_y);
+
+    // Read and write the packed op code of cell (i, j).
+    packed_op_type get_op(int i, int j) const;
+    void set_op(int i, int j, packed_op_type type);
+
+    // Expand the packed op code of cell (i, j) into a full Operation.
+    Operation operation(int i, int j) const;
+
+    // Construct the packed op table, row by row, with two rolling rows of costs.
+    void compute_transform_tables();
+};
+
+CompactTransformTable::CompactTransformTable(std::string const &str_x, std::string const &str_y, int cC, int cR,
+                                             int cD, int cI) : CompactTransformTable(cC, cR, cD, cI) {
+    assign(str_x, str_y);
+}
+
+CompactTransformTable::CompactTransformTable(int cC, int cR, int cD, int cI) {
+    cc = cC;
+    cr = cR;
+    cd = cD;
+    ci = cI;
+    height = 1;
+    width = 1;
+    row_bytes = 1;
+    final_cost = 0;
+}
+
+void CompactTransformTable::assign(std::string const &str_x, std::string const &str_y) {
+    X = str_x;
+    Y = str_y;
+
+    height = X.size() + 1;
+    width = Y.size() + 1;
+    row_bytes = (width + 3) / 4;
+
+    // Resizing keeps the existing capacity, so a table reused for strings no longer than before does not allocate
+    op.resize((std::size_t) height * row_bytes);
+    above.resize(width);
+    row.resize(width);
+
+    CompactTransformTable::compute_transform_tables();
+}
+
+packed_op_type CompactTransformTable::get_op(int i, int j) const {
+    return (packed_op_type) ((op[(std::size_t) i * row_bytes + j / 4] >> (2 * (j % 4))) & 3);
+}
+
+void CompactTransformTable::set_op(int i, int j, packed_op_type type) {
+    uint8_t &cell = op[(std::size_t) i * row_bytes + j / 4];
+    cell = (cell & ~(3 << (2 * (j % 4)))) | (type << (2 * (j % 4)));
+}
+
+Operation CompactTransformTable::operation(int i, int j) const {
+    return unpack_operation(get_op(i, j), X, Y, i, j);
+}
+
+void CompactTransformTable::compute_transform_tables() {
+    // Create top row of insert operations
+    set_op(0, 0, PACKED_NOOP);
+    row[0] = 0;
+    for (int j = 1; j < width; j++) {
+        row[j] = j * ci;
+        set_op(0, j, PACKED_INSERT);
+    }
+
+    // Compute each following row, starting with a delete operation in the left column, choosing between the
+    // operations in the same order as TransformTable so ties resolve to the same op
+    for (int i = 1; i < height; i++) {
+        std::swap(above, row);
+        row[0] = i * cd;
+        set_op(i, 0, PACKED_DELETE);
+
+        for (int j = 1; j < width; j++) {
+            int best = above[j - 1] + ((X[i - 1] == Y[j - 1]) ? cc : cr);
+            packed_op_type type = PACKED_DIAGONAL;
+
+            if (above[j] + cd < best) {
+                best = above[j] + cd;
+                type = PACKED_DELETE;
+            }
+            if (row[j - 1] + ci < best) {
+                best = row[j - 1] + ci;
+                type = PACKED_INSERT;
+            }
+
+            row[j] = best;
+            set_op(i, j, type);
+        }
+    }
+
+    final_cost = row[width - 1];
+}
+
+/*
+ * @brief Iteratively assemble a set of instructions to transform the string X to Y using a table of packed op codes
+ *
+ * @param[in]  t  instance of a CompactTransformTable or BandedTransformTable precomputed from two strings
+ * @param[in]  i  row index into t (and the original X, Y strings)
+ * @param[in]  j  column index into t (and the original X, Y strings)
+ * @param[out]  op_vector  vector cleared and filled with the instructions to transform X to Y, in reverse order
+ * */
+template <typename PackedTable>
+void traceback_transformation(PackedTable const &t, int i, int j, std::vector<Operation> &op_vector) {
+    op_vector.clear();
+    op_vector.reserve(i + j + 1);
+
+    while (true) {
+        switch (t.get_op(i, j)) {
+            case PACKED_DIAGONAL:
+                op_vector.push_back(t.operation(i--, j--));
+                break;
+            case PACKED_DELETE:
+                op_vector.push_back(t.operation(i--, j));
+                break;
+            case PACKED_INSERT:
+                op_vector.push_back(t.operation(i, j--));
+                break;
+            case PACKED_NOOP:
+                op_vector.push_back(t.operation(i, j));
+                return;
+        }
+    }
+}
+
+/*
+ * @brief Class to encapsulate a threshold bounded (banded) op table computed for two strings, after Ukkonen.
+ *
+ * Only answers whether X can be transformed into Y with a cost of at most the threshold k, and if so how. A path
+ * through the table with S diagonal ops, D deletes and I inserts has S = m - D and I = D + (n - m), so its cost is
+ * at least m * c_diag + (n - m) * ci + D * g, where c_diag = min(cc, cr) and g = cd + ci - c_diag is the extra cost
+ * of a delete and insert pair over one diagonal op. When g > 0, a path that strays onto diagonal d = j - i needs
+ * at least max(0, -d) + max(0, d - (n - m)) deletes, so only the band of diagonals where that lower bound is within
+ * k can be on a path costing at most k. Costs are kept for the band of two rolling rows, and the ops for the band
+ * of every row, so the work and space are O(k * n) rather than O(m * n). The rows stop early as soon as no cell of
+ * a row can complete within k.
+ * */
+struct BandedTransformTable {
+    int height;
+    int width;
+    std::string X;
+    std::string Y;
+    int cc, cr, cd, ci; // Costs for copy, replace, delete and insert operations
+    int threshold;
+    int band_lo, band_hi; // Range of diagonals d = j - i in the band
+    int band_width;
+    bool found; // True if X can be transformed into Y with a cost of at most threshold
+    int final_cost; // Cost of the transformation, if found
+    std::vector<uint8_t> op; // op[i * band_width + (j - i - band_lo)] is the packed_op_type of cell (i, j)
+
+    // Constructor makes a copy of the input strings, computes the band for the threshold k, and initialises the op
+    // vector for the band.
+    BandedTransformTable(std::string const &str_x, std::string const &str_y, int cC, int cR, int cD, int cI, int k);
+
+    // Lower bound of the cost of completing a transformation from cell (i, j) to (m, n)
+    long remaining_cost_bound(int i, int j) const;
+
+    // Read the packed op code of cell (i, j), which must be in the band.
+    packed_op_type get_op(int i, int j) const;
+
+    // Expand the packed op code of cell (i, j) into a full Operation.
+    Operation operation(int i, int j) const;
+
+    // Construct the band of the op table, row by row, until a row has no cell within the threshold.
+    void compute_transform_tables();
+};
+
+BandedTransformTable::BandedTransformTable(std::string const &str_x, std::string const &str_y, int cC, int cR, int cD,
+                                           int cI, int k) {
+    X = str_x;
+    Y = str_y;
+    cc = cC;
+    cr = cR;
+    cd = cD;
+    ci = cI;
+    threshold = k;
+    found = false;
+    final_cost = 0;
+
+    height = X.size() + 1;
+    width = Y.size() + 1;
+
+    int m = X.size();
+    int n = Y.size();
+    band_lo = -m;
+    band_hi = n;
+
+    // Narrow the band to the diagonals whose lower bound on the number of deletes is affordable within k
+    long c_diag = std::min(cc, cr);
+    long g = (long) cd + ci - c_diag;
+    if (g > 0) {
+        long deletes = std::max(0, m - n);
+        long spare = threshold - (m * c_diag + (long) (n - m) * ci + deletes * g);
+        if (spare < 0) {
+            // No transformation can cost at most k
+            band_width = 0;
+            return;
+        }
+        long slack = spare / g;
+        band_lo = (int) std::max<long>(band_lo, std::min(0, n - m) - slack);
+        band_hi = (int) std::min<long>(band_hi, std::max(0, n - m) + slack);
+    }
+    band_width = band_hi - band_lo + 1;
+
+    op = std::vector<uint8_t>((std::size_t) height * band_width, PACKED_NOOP);
+
+    BandedTransformTable::compute_transform_tables();
+}
+
+long BandedTransformTable::remaining_cost_bound(int i, int j) const {
+    long m = height - 1 - i;
+    long delta = (width - 1 - j) - m;
+    long c_diag = std::min(cc, cr);
+    long g = (long) cd + ci - c_diag;
+
+    // The remaining ops take between max(0, -delta) and m deletes, which is cheapest at one end or the other
+    long deletes = (g > 0) ? std::max(0L, -delta) : m;
+    return m * c_diag + delta * ci + deletes * g;
+}
+
+packed_op_type BandedTransformTable::get_op(int i, int j) const {
+    return (packed_op_type) op[(std::size_t) i * band_width + (j - i - band_lo)];
+}
+
+Operation BandedTransformTable::operation(int i, int j) const {
+    return unpack_operation(get_op(i, j), X, Y, i, j);
+}
+
+void BandedTransformTable::compute_transform_tables() {
+    // Cells outside the band are treated as unreachable
+    const int unreachable = INT_MAX / 2;
+
+    // Costs of the band of the previous and current rows, indexed by offset o = j - i - band_lo, with an extra
+    // unreachable cell at each end so the neighbours of the end cells can always be read
+    std::vector<int> above(band_width + 2, unreachable);
+    std::vector<int> row(band_width + 2, unreachable);
+
+    for (int i = 0; i < height; i++) {
+        std::swap(above, row);
+        std::fill(row.begin(), row.end(), unreachable);
+
+        // Columns of row i inside the band
+        int j_lo = std::max(0, i + band_lo);
+        int j_hi = std::min(width - 1, i + band_hi);
+        bool within_threshold = false;
+
+        for (int j = j_lo; j <= j_hi; j++) {
+            int o = j - i - band_lo + 1;
+            int best;
+            packed_op_type type;
+
+            if (i == 0 && j == 0) {
+                best = 0;
+                type = PACKED_NOOP;
+            } else if (i == 0) {
+                best = row[o - 1] + ci;
+                type = PACKED_INSERT;
+            } else if (j == 0) {
+                best = above[o + 1] + cd;
+                type = PACKED_DELETE;
+            } else {
+                // Choose between the operations in the same order as TransformTable so ties resolve to the same op
+                best = above[o] + ((X[i - 1] == Y[j - 1]) ? cc : cr);
+                type = PACKED_DIAGONAL;
+
+                if (above[o + 1] + cd < best) {
+                    best = above[o + 1] + cd;
+                    type = PACKED_DELETE;
+                }
+                if (row[o - 1] + ci < best) {
+                    best = row[o - 1] + ci;
+                    type = PACKED_INSERT;
+                }
+            }
+
+            // Leave cells that are reachable only from outside the band as unreachable
+            if (best >= unreachable / 2) {
+                continue;
+            }
+
+            row[o] = best;
+            op[(std::size_t) i * band_width + (o - 1)] = type;
+
+            if (best + remaining_cost_bound(i, j) <= threshold) {
+                within_threshold = true;
+            }
+        }
+
+        // Every transformation passes through row i, so if no cell of the row can finish within k, none can
+        if (!within_threshold) {
+            return;
+        }
+    }
+
+    final_cost = row[width - 1 - (height - 1) - band_lo + 1];
+    found = (final_cost <= threshold);
+}
+
+/*
+ * @brief Engine to transform one query string into each of a batch of candidate strings.
+ *
+ * Keeps its workspace buffers between calls, so that after the first batch no memory is allocated for candidates
+ * that are no longer than those seen before. The candidates are split into chunks that are processed in parallel
+ * on a thread pool, and each chunk has its own workspace. The costs can be computed without any op table, using a
+ * single row of costs per chunk, or with compact op tables for the full transformations.
  * */
-std::vector<Operation> assemble_transformation(TransformTable const &t, int i, int j) {
-    std::vector<Operation> op_vector;
-
-    // Base case where op is a no-op, return empty string
-    if (t.op[t.coord(i, j)].type == op_type::NOOP) {
-        op_vector.push_back(Operation{op_type::NOOP, '-'});
-        return op_vector;
-    // If current op is a copy or replace -- recursively return substring and append matching char
-    } else if ((t.op[t.coord(i, j)].type == op_type::COPY) || (t.op[t.coord(i, j)].type == op_type::REPLACE)) {
-        op_vector = assemble_transformation(t, i - 1, j - 1);
-        op_vector.push_back(t.op[t.coord(i, j)]);
-        return op_vector;
-    // If op is delete -- recursively work back up column
-    } else if (t.op[t.coord(i, j)].type == op_type::DELETE) {
-        op_vector = assemble_transformation(t, i - 1, j);
-        op_vector.push_back(t.op[t.coord(i, j)]);
-        return op_vector;
-    // Op must be an insert -- recursively work back along row
-    } else {
-        op_vector = assemble_transformation(t, i, j - 1);
-        op_vector.push_back(t.op[t.coord(i, j)]);
-        return op_vector;
+struct BatchTransformEngine {
+    int cc, cr, cd, ci; // Costs for copy, replace, delete and insert operations
+    std::vector<std::vector<int>> rows; // Cost row of each chunk, for costs only
+    std::vector<CompactTransformTable> tables; // Op table of each chunk, for transformations
+
+    // Constructor records the operation costs, with the workspaces created on first use.
+    BatchTransformEngine(int cC, int cR, int cD, int cI);
+
+    // Number of chunks the candidates are split into on the pool (enough to balance candidates of uneven length).
+    int chunk_count(TaskPool &pool, int candidate_count) const;
+
+    // Minimum cost of transforming X into Y, using a single row of costs.
+    int cost(std::string const &X, std::string const &Y, std::vector<int> &row) const;
+
+    // Set costs[c] to the minimum cost of transforming the query into candidates[c], in parallel on the pool.
+    void compute_costs(TaskPool &pool, std::string const &query, std::vector<std::string> const &candidates,
+                       std::vector<int> &costs);
+
+    // Set costs[c] and transformations[c] to the minimum cost and the instructions (in reverse order) to transform
+    // the query into candidates[c], in parallel on the pool.
+    void compute_transformations(TaskPool &pool, std::string const &query, std::vector<std::string> const &candidates,
+                                 std::vector<int> &costs, std::vector<std::vector<Operation>> &transformations);
+};
+
+BatchTransformEngine::BatchTransformEngine(int cC, int cR, int cD, int cI) {
+    cc = cC;
+    cr = cR;
+    cd = cD;
+    ci = cI;
+}
+
+int BatchTransformEngine::chunk_count(TaskPool &pool, int candidate_count) const {
+    return std::max(std::min(4 * pool.size(), candidate_count), 1);
+}
+
+int BatchTransformEngine::cost(std::string const &X, std::string const &Y, std::vector<int> &row) const {
+    int m = X.size();
+    int n = Y.size();
+    row.resize(n + 1);
+
+    // Create top row of insert costs
+    for (int j = 0; j <= n; j++) {
+        row[j] = j * ci;
+    }
+
+    // Compute each following row in place, keeping the cost diagonally above the current cell
+    for (int i = 1; i <= m; i++) {
+        int diagonal = row[0];
+        row[0] = i * cd;
+        char x = X[i - 1];
+
+        for (int j = 1; j <= n; j++) {
+            int above = row[j];
+            int best = diagonal + ((x == Y[j - 1]) ? cc : cr);
+            best = std::min(best, above + cd);
+            best = std::min(best, row[j - 1] + ci);
+            row[j] = best;
+            diagonal = above;
+        }
+    }
+
+    return row[n];
+}
+
+void BatchTransformEngine::compute_costs(TaskPool &pool, std::string const &query,
+                                         std::vector<std::string> const &candidates, std::vector<int> &costs) {
+    int candidate_count = candidates.size();
+    int chunks = chunk_count(pool, candidate_count);
+    costs.resize(candidate_count);
+    if ((int) rows.size() < chunks) {
+        rows.resize(chunks);
     }
+
+    pool.parallel_for(0, chunks, 1, [&](int lo, int hi) {
+        for (int chunk = lo; chunk < hi; chunk++) {
+            for (int c = chunk; c < candidate_count; c += chunks) {
+                costs[c] = cost(query, candidates[c], rows[chunk]);
+            }
+        }
+    });
+}
+
+void BatchTransformEngine::compute_transformations(TaskPool &pool, std::string const &query,
+                                                   std::vector<std::string> const &candidates, std::vector<int> &costs,
+                                                   std::vector<std::vector<Operation>> &transformations) {
+    int candidate_count = candidates.size();
+    int chunks = chunk_count(pool, candidate_count);
+    costs.resize(candidate_count);
+    transformations.resize(candidate_count);
+    while ((int) tables.size() < chunks) {
+        tables.emplace_back(cc, cr, cd, ci);
+    }
+
+    pool.parallel_for(0, chunks, 1, [&](int lo, int hi) {
+        for (int chunk = lo; chunk < hi; chunk++) {
+            CompactTransformTable &table = tables[chunk];
+            for (int c = chunk; c < candidate_count; c += chunks) {
+                table.assign(query, candidates[c]);
+                traceback_transformation(table, query.size(), candidates[c].size(), transformations[c]);
+                costs[c] = table.final_cost;
+            }
+        }
+    });
+}
+
+/*
+ * @brief Generate a near duplicate of a string, by applying random edits
+ *
+ * @param[in]  X  string to be copied
+ * @param[in]  edits  number of random single char replacements, insertions or deletions to apply
+ * @param[in]  alphabet  alphabet of the inserted and replacement chars
+ * @param[in]  seed  seed of the positions, kinds and chars of the edits
+ * @return  copy of X with the edits applied
+ * */
+std::string generate_near_duplicate_string(std::string const &X, int edits, Alphabet alphabet, uint64_t seed) {
+    std::mt19937 rng(derive_seed(seed, 0));
+    std::string Y = X;
+    std::string chars = generate_random_string(edits, alphabet, derive_seed(seed, 1));
+
+    for (int e = 0; e < edits; e++) {
+        int pos = std::uniform_int_distribution<int>(0, std::max((int) Y.size() - 1, 0))(rng);
+        switch (rng() % 3) {
+            case 0:
+                if (!Y.empty()) {
+                    Y[pos] = chars[e];
+                }
+                break;
+            case 1:
+                Y.insert(Y.begin() + pos, chars[e]);
+                break;
+            default:
+                if (!Y.empty()) {
+                    Y.erase(Y.begin() + pos);
+                }
+                break;
+        }
+    }
+
+    return Y;
 }
 
 /*
  * @brief Apply transformation instructions to derive Y from X
  *
  * @param[in]  str_x  string X to be transformed
- * @param[in]  op_vector  vector of instructions to transform the string X to Y
+ * @param[in]  op_vector  vector of instructions to transform the string X to Y, in reverse order (as assembled by
+ *                        traceback_transformation)
  * @return  string Y transformed from X
  * */
 std::string apply_transformation(std::string const &str_x, std::vector<Operation> const &op_vector) {
@@ -277,78 +895,287 @@ std::string apply_transformation(std::string const &str_x, std::vector<Operation
     return Z;
 }
 
-int main(int argc, char *argv[]) {
-    // Check correct usage (e.g. 'strings 1000 5')
-    if (argc != 3) {
-        std::cerr << "Usage: " << argv[0] << " [string_length] [repeat_count]" << std::endl;
-        exit(EXIT_FAILURE);
+// Operation costs as provided in the book
+const int cost_copy = -1;
+const int cost_replace = 1;
+const int cost_delete = 2;
+const int cost_insert = 2;
+
+/*
+ * @brief Benchmark the batch transform engine, comparing X with a batch of candidates
+ *
+ * Half of the candidates are near duplicates of X and half unrelated strings. Times are reported per pair.
+ * @param[in]  bench  benchmark harness
+ * @param[in]  pool  thread pool for the batch
+ * @param[in]  X  string compared with each candidate
+ * @param[in]  alphabet  alphabet of the unrelated candidates
+ * @param[in]  seed  seed of the inputs, of which candidate c is generated from stream c + 2
+ * */
+void run_throughput_benchmarks(Benchmark &bench, TaskPool &pool, std::string const &X, Alphabet alphabet,
+                               uint64_t seed) {
+    std::vector<std::string> candidates(BATCH_CANDIDATE_COUNT);
+    for (int c = 0; c < BATCH_CANDIDATE_COUNT; c++) {
+        uint64_t candidate_seed = derive_seed(seed, c + 2);
+        candidates[c] = (c % 2 == 0) ? generate_near_duplicate_string(X, c % 20 + 1, alphabet, candidate_seed)
+                                     : generate_random_string(X.size(), alphabet, candidate_seed);
     }
 
-    std::chrono::time_point <std::chrono::steady_clock> t1, t2, t3;
-    long dt1, dt2;
-    std::string X, Y, Z;
-    int dummy_val = 0; // Use for accumulation to prevent compiler optimising away ops
+    BatchTransformEngine engine(cost_copy, cost_replace, cost_delete, cost_insert);
+    std::vector<int> costs, traceback_costs;
+    std::vector<std::vector<Operation>> transformations;
 
-    int string_length = get_string_length(argv[1]);
-    int repeats = get_repeat_count(argv[2]);
+    // Check both batch paths against a compact transform table computed for each candidate individually
+    auto check = [&]() {
+        for (int c = 0; c < BATCH_CANDIDATE_COUNT; c++) {
+            auto transform_table = CompactTransformTable(X, candidates[c], cost_copy, cost_replace, cost_delete,
+                                                         cost_insert);
+            if ((!costs.empty() && costs[c] != transform_table.final_cost) ||
+                (!traceback_costs.empty() && (traceback_costs[c] != transform_table.final_cost ||
+                                              apply_transformation(X, transformations[c]) != candidates[c]))) {
+                std::cerr << "Batch transform engine does not match compact transform table" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+        }
+    };
+
+    std::string batch = " (" + std::to_string(BATCH_CANDIDATE_COUNT) + " candidates, " + std::to_string(pool.size())
+                        + " threads)";
+    bench.set_threads(pool.size());
+    bench.set_ops(BATCH_CANDIDATE_COUNT);
+    bench.set_counter_unit("cell", (double) X.size() * X.size());
+
+    // Calculate costs only
+    double median = bench.run("Batch transform costs" + batch, X.size(), []() {},
+                              [&]() { engine.compute_costs(pool, X, candidates, costs); }, check);
+    if (median > 0) {
+        bench.metric("pairs/s", 1 / median);
+    }
 
-    // Example strings X and Y from the book
-    //X = "ACAAGC";
-    //Y = "CCGT";
+    // Calculate costs and transformations
+    median = bench.run("Batch transformations" + batch, X.size(), []() {},
+                       [&]() { engine.compute_transformations(pool, X, candidates, traceback_costs, transformations); },
+                       check);
+    if (median > 0) {
+        bench.metric("pairs/s", 1 / median);
+    }
 
-    // Create random alphanumeric strings of user specified length
-    X = generate_random_alphanumeric_string(string_length);
-    Y = generate_random_alphanumeric_string(string_length);
+    bench.set_ops(1);
+    bench.set_threads(1);
+    bench.set_counter_unit("op", 1);
+}
 
-    dt1 = 0;
-    dt2 = 0;
+/*
+ * @brief Benchmark the transform tables, from X to the random string Y and to a near duplicate of X
+ *
+ * @param[in]  bench  benchmark harness
+ * @param[in]  pool  thread pool for the wavefront transform tables
+ * @param[in]  X  string to be transformed
+ * @param[in]  Y  target string
+ * @param[in]  alphabet  alphabet of the strings
+ * @param[in]  seed  seed of the inputs, of which the near duplicate of X is generated from stream 2
+ * */
+void run_table_benchmarks(Benchmark &bench, TaskPool &pool, std::string const &X, std::string const &Y,
+                          Alphabet alphabet, uint64_t seed) {
+    int string_length = X.size();
+    std::vector<Operation> transform_operations;
+    std::string Z;
 
-    // Define operation costs as provided in the book
-    const int cost_copy = -1;
-    const int cost_replace = 1;
-    const int cost_delete = 2;
-    const int cost_insert = 2;
+    // Hardware counters are reported per cell of the tables, computed or not, and per char for the tracebacks
+    double cells = (double) string_length * string_length;
+    bench.set_counter_unit("cell", cells);
 
-    for (int i = 0; i < repeats; i++) {
+    // Construct transform table, which is freed before each run as it can take gigabytes
+    std::unique_ptr<TransformTable> transform_table;
+    double tables_median = bench.run("Transform tables", string_length, [&]() { transform_table.reset(); }, [&]() {
+        transform_table = std::make_unique<TransformTable>(X, Y, cost_copy, cost_replace, cost_delete, cost_insert);
+    });
+    if (!transform_table) {
+        transform_table = std::make_unique<TransformTable>(X, Y, cost_copy, cost_replace, cost_delete, cost_insert);
+    }
+    int final_cost = transform_table->cost[transform_table->coord(X.size(), Y.size())];
 
-        t1 = std::chrono::steady_clock::now();
+    // Print intermediate Transform table for debugging
+    //std::cout << *transform_table << std::endl;
 
-        // Construct transform table
-        auto transform_table = TransformTable(X, Y, cost_copy, cost_replace, cost_delete, cost_insert);
-        t2 = std::chrono::steady_clock::now();
+    // Check that transformed string Z from X, matches the target Y
+    auto check_transformed = [&]() {
+        if (Z.compare(Y) != 0) {
+            std::cerr << "Error: transformed string Z does not match target Y:" << std::endl <<
+                "X: " << X << std::endl << "Y: " << Y << std::endl << "Z: " << Z << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    };
 
-        // Calculate Transformed string
-        auto transform_operations = assemble_transformation(transform_table, X.size(), Y.size());
+    // Calculate Transformed string
+    bench.set_counter_unit("char", string_length);
+    bench.run("Transformed string", string_length, []() {}, [&]() {
+        traceback_transformation(*transform_table, X.size(), Y.size(), transform_operations);
         Z = apply_transformation(X, transform_operations);
+    }, check_transformed);
+    traceback_transformation(*transform_table, X.size(), Y.size(), transform_operations);
+    Z = apply_transformation(X, transform_operations);
+    check_transformed();
+    transform_table.reset();
 
-        t3 = std::chrono::steady_clock::now();
+    // Print final Transformed string
+    //std::cout << "Transformed string (Z): " << Z << std::endl;
+
+    // Compare with the transform tables computed as a parallel wavefront of tiles
+    std::unique_ptr<TransformTable> wavefront_table;
+    std::vector<Operation> wavefront_operations;
 
-        // Accumulate measurement time
-        dt1 += std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
-        dt2 += std::chrono::duration_cast<std::chrono::microseconds>(t3 - t2).count();
+    bench.set_counter_unit("cell", cells);
+    bench.set_threads(pool.size());
+    double median = bench.run("Transform tables (wavefront, " + std::to_string(pool.size()) + " threads)",
+                              string_length, [&]() { wavefront_table.reset(); }, [&]() {
+        wavefront_table = std::make_unique<TransformTable>(X, Y, cost_copy, cost_replace, cost_delete, cost_insert,
+                                                           pool);
+    }, [&]() {
+        // Check the wavefront gives the same tables, by deriving the same transformed string from them
+        traceback_transformation(*wavefront_table, X.size(), Y.size(), wavefront_operations);
+        if (apply_transformation(X, wavefront_operations) != Z) {
+            std::cerr << "Wavefront transform tables do not match transform tables" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    });
+    if (median > 0 && tables_median > 0) {
+        bench.metric("x speedup vs Transform tables", tables_median / median);
+    }
+    bench.set_threads(1);
+    wavefront_table.reset();
 
-        // Print intermediate Transform table and Transformed string Z for debugging
-        //std::cout << transform_table << std::endl;
-        //std::cout << Z << std::endl;
+    // Compare with the compact packed op table
+    std::unique_ptr<CompactTransformTable> compact_table;
+    std::vector<Operation> compact_operations;
+    std::string compact_Z;
 
-        // Check that transformed string Z from X, matches the target Y
-        if (!Z.compare(Y)) {
-            std::cerr << "Error: transformed string Z does not match target Y:" << std::endl <<
-                "X: " << X << std::endl << "Y: " << Y << std::endl << "Z: " << Z << std::endl;
+    median = bench.run("Transform tables (compact)", string_length, [&]() { compact_table.reset(); }, [&]() {
+        compact_table = std::make_unique<CompactTransformTable>(X, Y, cost_copy, cost_replace, cost_delete,
+                                                                cost_insert);
+    });
+    if (median > 0 && tables_median > 0) {
+        bench.metric("x speedup vs Transform tables", tables_median / median);
+    }
+    if (!compact_table) {
+        compact_table = std::make_unique<CompactTransformTable>(X, Y, cost_copy, cost_replace, cost_delete,
+                                                                cost_insert);
+    }
+
+    bench.set_counter_unit("char", string_length);
+    bench.run("Transformed string (compact)", string_length, []() {}, [&]() {
+        traceback_transformation(*compact_table, X.size(), Y.size(), compact_operations);
+        compact_Z = apply_transformation(X, compact_operations);
+    }, [&]() {
+        // Check the compact table gives the same transformation as the full tables
+        if (compact_operations != transform_operations || compact_table->final_cost != final_cost || compact_Z != Y) {
+            std::cerr << "Compact transform table does not match transform tables" << std::endl;
             exit(EXIT_FAILURE);
         }
+    });
+    compact_table.reset();
+
+    bench.log() << "Transform table memory: " << (sizeof(int) + sizeof(Operation)) << " bytes per cell (full), 0.25 "
+                << "bytes per cell (compact)" << std::endl;
+
+    // Compare the compact table with the banded table, for a near duplicate of X (1% of chars edited, and at least
+    // one), with the threshold set to the cost of the transformation, and for the unrelated string Y, which is
+    // usually rejected early
+    std::string X_near = generate_near_duplicate_string(X, std::max(string_length / 100, 1), alphabet,
+                                                        derive_seed(seed, 2));
+    int threshold = 0;
+
+    auto compact_near = [&]() {
+        auto near_compact = CompactTransformTable(X, X_near, cost_copy, cost_replace, cost_delete, cost_insert);
+        traceback_transformation(near_compact, X.size(), X_near.size(), compact_operations);
+        threshold = near_compact.final_cost;
+    };
+    compact_near();
+    bench.set_counter_unit("cell", cells);
+    double compact_median = bench.run("Transformed string (compact, near duplicate)", string_length, compact_near);
+
+    std::string k = "k = " + std::to_string(threshold);
+    int band_width = 0;
+    bool near_found = false;
 
-        // Use values in the sorted array to prevent the compiler optimising away ops
-        dummy_val += Z[(100 * i) % string_length];
+    // Construct banded transform table for the near duplicate, and calculate the transformation
+    median = bench.run("Transformed string (banded, " + k + ", near duplicate)", string_length, []() {}, [&]() {
+        auto near_table = BandedTransformTable(X, X_near, cost_copy, cost_replace, cost_delete, cost_insert, threshold);
+        near_found = near_table.found && near_table.final_cost == threshold;
+        if (near_table.found) {
+            traceback_transformation(near_table, X.size(), X_near.size(), transform_operations);
+        }
+        band_width = near_table.band_width;
+    }, [&]() {
+        // Check the banded table finds the same transformation as the compact table
+        if (!near_found || transform_operations != compact_operations ||
+            apply_transformation(X, transform_operations) != X_near) {
+            std::cerr << "Banded transform table does not match compact transform table" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    });
+    if (median > 0 && compact_median > 0) {
+        bench.metric("x speedup vs compact", compact_median / median);
     }
+    do_not_optimize(band_width);
 
-    // Print final Transformed string
-    //std::cout << "Transformed string (Z): " << Z << std::endl;
-    std::cout << "Time to compute Transform tables: " << ((float) dt1 / (1e6 * repeats)) << " s (average per op)" << std::endl;
-    std::cout << "Time to compute Transformed string: " << ((float) dt2 / (1e6 * repeats)) << " s (average per op)" << std::endl;
+    // Construct banded transform table for the unrelated string, which short strings can be within the threshold of
+    bool far_expected = CompactTransformTable(X, Y, cost_copy, cost_replace, cost_delete, cost_insert).final_cost <=
+                        threshold;
+    bool far_found = false;
+    bench.run("Reject unrelated string (banded, " + k + ")", string_length, []() {}, [&]() {
+        far_found = BandedTransformTable(X, Y, cost_copy, cost_replace, cost_delete, cost_insert, threshold).found;
+    }, [&]() {
+        // Check the banded table rejects the unrelated string, unless the compact table finds it within the threshold
+        if (far_found != far_expected) {
+            std::cerr << "Banded transform table does not match compact transform table" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    });
+    bench.set_counter_unit("op", 1);
+}
+
+int main(int argc, char *argv[]) {
+    BenchmarkOptions options = parse_benchmark_options(argc, argv);
+
+    // Check correct usage (e.g. 'strings 1000 5')
+    if (argc < 3 || argc > 5) {
+        std::cerr << "Usage: " << argv[0] << " [string_length] [repeat_count] [mode (optional): table|throughput]"
+                  << " [thread_count (optional)] [--warmup=N] [--samples=N] [--format=text|csv|json]"
+                  << " [--output=path] [--filter=name] [--sweep=sizes] [--seed=N] [--input=alphanumeric|dna|text]"
+                  << " [--counters]" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    Alphabet alphabet = parse_alphabet(options.input.empty() ? "alphanumeric" : options.input);
+    int string_length = get_string_length(argv[1]);
+    int repeats = get_repeat_count(argv[2]);
+    transform_mode mode = (argc >= 4) ? get_mode(argv[3]) : TABLE;
+    int threads = (argc == 5) ? get_thread_count(argv[4]) : std::max((int) std::thread::hardware_concurrency(), 1);
+
+    Benchmark bench("transform", options, repeats);
+    TaskPool pool(threads);
+
+    for (long long size: bench.sizes(string_length)) {
+        if (size < 0 || size > 40000) {
+            std::cerr << "sweep sizes must be >= 0 and <= 40000" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        // Example strings X and Y from the book
+        //X = "ACAAGC";
+        //Y = "CCGT";
+
+        // Create random strings of user specified length, from independent streams of the seed
+        std::string X = generate_random_string(size, alphabet, derive_seed(options.seed, 0), pool);
+        std::string Y = generate_random_string(size, alphabet, derive_seed(options.seed, 1), pool);
 
-    // Dump final accumulated value to prevent compiler optimising away ops
-    std::cout << dummy_val << std::endl;
+        if (mode == THROUGHPUT) {
+            run_throughput_benchmarks(bench, pool, X, alphabet, options.seed);
+        } else {
+            run_table_benchmarks(bench, pool, X, Y, alphabet, options.seed);
+        }
+    }
 
+    bench.report();
     exit(EXIT_SUCCESS);
 }